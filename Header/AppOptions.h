@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include "FramePacer.h"
+
+// Command line options. With no arguments the app runs interactively in a
+// fullscreen window, exactly as before.
+struct AppOptions {
+    bool headless;
+    bool useEGL;
+    int width, height;
+    int frames;
+    int warmupFrames;
+    double fixedDeltaTime;
+    bool idle;              // headless runs without a replay run unless this is set
+    std::string recordPath;
+    std::string replayPath;
+    std::string tracePath;
+    std::string sensorLogPath;
+
+    // Interactive frame pacing; latencyMs < 0 starts frames right after the previous deadline
+    int targetFps;
+    VsyncMode vsync;
+    double latencyMs;
+
+    // Job system threads including the caller, 0 for one per hardware thread
+    int threads;
+    bool bench;
+
+    // How far ahead the city is generated, in meters
+    int viewDistance;
+
+    // Samples per second of the watch's synthetic ECG
+    int ecgSampleRate;
+
+    // Relink shaders when their files change (interactive runs only)
+    bool shaderDev;
+
+    AppOptions()
+        : headless(false), useEGL(false),
+          width(1280), height(720),
+          frames(600), warmupFrames(30),
+          fixedDeltaTime(1.0 / 60.0), idle(false),
+          targetFps(75), vsync(VSYNC_OFF), latencyMs(-1.0),
+          threads(0), bench(false),
+          viewDistance(160),
+          ecgSampleRate(500),
+          shaderDev(false) {}
+};
+
+// Returns false (after printing usage) on unknown or malformed arguments
+bool parseAppOptions(int argc, char** argv, AppOptions& out);
+void printAppUsage(const char* program);
@@ -0,0 +1,6 @@
+#pragma once
+
+// CPU microbenchmarks, run with --bench instead of starting the app. They
+// need no window or GL context. Each one prints a table with the median
+// time for 1..maxThreads threads so scaling problems show up directly.
+int runBenchmarks(int maxThreads);
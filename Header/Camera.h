@@ -2,12 +2,34 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+// Per-frame camera data laid out like this std140 uniform block, so it can
+// be copied into a uniform buffer as is:
+//
+//   layout(std140) uniform CameraBlock {
+//       mat4 view;
+//       mat4 projection;
+//       mat4 viewProjection;
+//       mat4 inverseViewProjection;
+//       vec4 position;
+//       vec4 frustumPlanes[6];
+//   };
+struct CameraBlock {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::mat4 inverseViewProjection;
+    glm::vec4 position;           // render position, w = 1
+    glm::vec4 frustumPlanes[6];   // left, right, bottom, top, near, far; normals point inside
+};
+static_assert(sizeof(CameraBlock) == 4 * 64 + 16 + 6 * 16, "CameraBlock must match the std140 layout");
+
 class Camera {
 private:
     glm::vec3 position;
-    glm::vec3 front;
-    glm::vec3 up;
-    glm::vec3 right;
+    // Derived from yaw and pitch on first use after a rotation
+    mutable glm::vec3 front;
+    mutable glm::vec3 up;
+    mutable glm::vec3 right;
     glm::vec3 worldUp;
     
     float yaw;
@@ -21,14 +43,38 @@ private:
     float bobbingOffset;
     float bobbingSpeed;
     float bobbingAmount;
-    
-    void updateCameraVectors();
+    float bobbingTime;
+
+    // State at the start of the last simulation step, and the blend used for rendering
+    glm::vec3 prevPosition;
+    float prevBobbingOffset;
+    glm::vec3 renderPosition;
+
+    // Matrices are rebuilt on first use after whatever they depend on changed
+    mutable CameraBlock block;
+    mutable bool vectorsDirty;
+    mutable bool viewDirty;
+    mutable bool projectionDirty;
+
+    void updateCameraVectors() const;
+    void setRenderPosition(const glm::vec3& value);
+    void refresh() const;
     
 public:
     Camera(glm::vec3 startPosition, float aspectRatio);
     
-    glm::mat4 getViewMatrix() const;
-    glm::mat4 getProjectionMatrix() const;
+    const glm::mat4& getViewMatrix() const;
+    const glm::mat4& getProjectionMatrix() const;
+    const glm::mat4& getViewProjectionMatrix() const;
+    const glm::mat4& getInverseViewProjectionMatrix() const;
+    // Normalized planes of the render frustum, order as in CameraBlock
+    const glm::vec4* getFrustumPlanes() const;
+    // Everything above in one block for the frame
+    const CameraBlock& getCameraBlock() const;
+
+    // World-space ray through a window pixel (origin top left) at the render position;
+    // starts on the near plane, direction normalized
+    void getPickRay(float x, float y, int width, int height, glm::vec3& origin, glm::vec3& direction) const;
     
     void moveVertical(float offset);
 
@@ -39,11 +85,18 @@ public:
 
     void updateBobbing(double deltaTime, bool isRunning);
     float getBobbingOffset() const { return bobbingOffset; }
-    
+
+    // Fixed-step interpolation: beginStep before each simulation step,
+    // setRenderAlpha once per frame before rendering
+    void beginStep();
+    void setRenderAlpha(float alpha);
+
+    // Simulation position; the view matrix and getRenderPosition use the interpolated one
     glm::vec3 getPosition() const { return position + glm::vec3(0.0f, bobbingOffset, 0.0f); }
-    glm::vec3 getFront() const { return front; }
-    glm::vec3 getUp() const { return up; }
-    glm::vec3 getRight() const { return right; }
+    glm::vec3 getRenderPosition() const { return renderPosition; }
+    glm::vec3 getFront() const;
+    glm::vec3 getUp() const;
+    glm::vec3 getRight() const;
     
-    void setAspectRatio(float ratio) { aspectRatio = ratio; }
+    void setAspectRatio(float ratio);
 };
@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Street length covered by one generated chunk
+const float CITY_CHUNK_LENGTH = 32.0f;
+
+// Read-only window onto BuildingArrays, indexed from its first element
+struct BuildingView {
+    const float* x;
+    const float* y;
+    const float* z;
+    const float* scale;
+    const float* rotation;
+    const int* type;
+    int count;
+
+    int size() const { return count; }
+    glm::vec3 position(int i) const { return glm::vec3(x[i], y[i], z[i]); }
+};
+
+// Buildings in structure-of-arrays form. Only z changes per step, so the
+// update streams through one float array.
+struct BuildingArrays {
+    std::vector<float> x, y, z;
+    std::vector<float> scale;
+    std::vector<float> rotation;   // radians around +y
+    std::vector<int> type;
+
+    int size() const { return (int)z.size(); }
+    glm::vec3 position(int i) const { return glm::vec3(x[i], y[i], z[i]); }
+
+    void clear();
+    // Appends every building of other with zOffset added to its z
+    void append(const BuildingArrays& other, float zOffset);
+    void eraseFront(int count);
+    // Elements from first to the end
+    BuildingView view(int first) const;
+};
+
+// Cross street branching off the main road
+struct SideStreet {
+    float z;    // center
+    int side;   // -1 left, 1 right, 0 both
+};
+
+// One chunk of city. Positions are relative to the chunk start, which is
+// at z = 0 with the chunk extending towards -z like the street ahead.
+struct CityChunk {
+    int64_t index;
+    BuildingArrays buildings;
+    std::vector<SideStreet> sideStreets;
+};
+
+// Lays out chunks of city along the street. A chunk depends only on the
+// seed and its index, so chunks can be generated in any order, on any
+// thread, and regenerated identically after being thrown away.
+class CityGenerator {
+public:
+    CityGenerator(uint32_t seed = 0, float roadHalfWidth = 4.0f);
+
+    void generate(int64_t index, CityChunk& out) const;
+    uint32_t getSeed() const { return seed; }
+
+private:
+    uint32_t seed;
+    float roadHalfWidth;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+// Widest vector kernels the CPU can run. The SIMD code paths are compiled
+// regardless of the build's /arch or -m flags and picked from this at run
+// time, so one x64 build runs everywhere and uses AVX2 where it exists.
+enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2
+};
+
+// Detected once, on first use
+SimdLevel getSupportedSimdLevel();
+// What the kernels use: the supported level unless lowered by setSimdLevel
+SimdLevel getSimdLevel();
+// Clamped to the supported level. For benchmarks that check every path;
+// not safe while kernels run on other threads.
+void setSimdLevel(SimdLevel level);
+const char* getSimdLevelName(SimdLevel level);
+
+// Marks a function whose body may use AVX2 instructions. MSVC accepts the
+// intrinsics anywhere; GCC and Clang need the target per function.
+#if defined(_M_X64) || defined(__x86_64__)
+#define SIMD_HAS_AVX2 1
+#if defined(_MSC_VER)
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+// Kernel templates are forced inline into each per-level loop, so their
+// vector operations compile with that loop's target
+#if defined(_MSC_VER)
+#define SIMD_INLINE __forceinline
+#else
+#define SIMD_INLINE inline __attribute__((always_inline))
+#endif
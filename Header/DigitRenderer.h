@@ -14,10 +14,25 @@ public:
     void drawColon(float x, float y, float scale, const glm::vec3& color, unsigned int shader, const glm::mat4& parentModel = glm::mat4(1.0f));
     void drawPercent(float x, float y, float scale, const glm::vec3& color, unsigned int shader, const glm::mat4& parentModel = glm::mat4(1.0f));
     void drawText(const char* text, float x, float y, float scale, const glm::vec3& color, unsigned int shader, const glm::mat4& parentModel = glm::mat4(1.0f));
+    void drawRect(float x, float y, float w, float h, const glm::vec3& color, unsigned int shader, const glm::mat4& parentModel = glm::mat4(1.0f));
+
+    // Between beginBatch and flushBatch segments are collected on the CPU and
+    // drawn with one call per colour instead of one call per segment
+    void beginBatch();
+    void flushBatch(unsigned int shader);
 
 private:
     unsigned int VAO, VBO;
 
+    struct Batch {
+        glm::vec3 color;
+        std::vector<float> vertices;
+    };
+    bool batching;
+    std::vector<Batch> batches;
+    std::vector<float> uploadBuffer;
+    unsigned int batchVAO, batchVBO;
+
     void drawDigit(int digit, float x, float y, float scale, const glm::vec3& color, unsigned int shader, const glm::mat4& parentModel);
     void drawChar(char c, float x, float y, float scale, const glm::vec3& color, unsigned int shader, const glm::mat4& parentModel);
     void drawSegment(float x, float y, float w, float h, const glm::vec3& color, unsigned int shader, const glm::mat4& parentModel);
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// One heartbeat as a sum of five Gaussian waves (P, Q, R, S, T) over the
+// beat phase in [0, 1). Amplitudes are in millivolts.
+struct EcgWaveform {
+    static const int WAVES = 5;
+    float center[WAVES];
+    float falloff[WAVES];     // log2(e) / (2 width^2), so a wave is amplitude * 2^(-falloff * d^2)
+    float amplitude[WAVES];
+};
+
+// Beat shape at a heart rate: the QRS keeps its duration in seconds while P
+// and T move in with the shorter interval, as the QT interval does
+EcgWaveform makeEcgWaveform(int heartRate);
+
+// Fills count samples starting at beat phase phase, phaseStep apart, eight
+// at a time on CPUs with AVX2, four with SSE2, one at a time otherwise. Returns the
+// phase of the sample after the last one.
+float synthesizeEcg(const EcgWaveform& wave, float phase, float phaseStep, int count, float* out);
+
+// Synthetic ECG of one wearer. The simulation thread appends samples to a
+// ring as time passes; the render thread copies a window back out without
+// locking and finds out afterwards if the writer overtook it.
+//
+// A simulation step covers only a few samples, so they are synthesized a
+// whole BLOCK at a time and published as time reaches them. The ring runs
+// up to a block ahead of getWritten(), and a new heart rate shows up in the
+// signal at most that many samples late.
+class EcgSignal {
+public:
+    static const int CAPACITY = 8192;          // samples, a power of two
+    static const int MAX_BATCH = CAPACITY / 4; // most samples one advance publishes
+    static const int BLOCK = 32;               // samples synthesized at once, divides CAPACITY
+
+    EcgSignal();
+
+    // Clamped to 250..1000 Hz; set before the first advance
+    void setSampleRate(int hz);
+    int getSampleRate() const { return sampleRate; }
+
+    // Writer side: generates the samples deltaTime covers at heartRate
+    void advance(double deltaTime, int heartRate);
+    // Samples published so far; a window ends at one of these
+    uint64_t getWritten() const { return written.load(std::memory_order_acquire); }
+    // Beat phase of the next sample to be synthesized
+    float getPhase() const { return phase; }
+
+    // Reader side: copies the count samples before end, oldest first. Returns
+    // how many were copied (fewer at the start of a run), 0 if the writer has
+    // since reused their slots.
+    int copyWindow(uint64_t end, int count, float* out) const;
+
+private:
+    alignas(32) float ring[CAPACITY];
+    std::atomic<uint64_t> written;
+    uint64_t generated;      // samples in the ring, a multiple of BLOCK
+
+    int sampleRate;
+    double pendingSamples;   // fraction of a sample carried between advances
+    float phase;             // beat phase of the next sample
+
+    // Rebuilt only when the heart rate changes
+    int waveHeartRate;
+    EcgWaveform wave;
+};
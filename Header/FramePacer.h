@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+enum VsyncMode {
+    VSYNC_OFF,
+    VSYNC_ON,
+    VSYNC_ADAPTIVE
+};
+
+// Paces the main loop to a frame period. Waits use an absolute-deadline
+// sleep (clock_nanosleep on POSIX) that wakes early by a running estimate of
+// the scheduler's overshoot, then spin-wait the last fraction of a
+// millisecond. Frame deadlines advance by whole periods from a fixed origin,
+// so errors don't accumulate.
+//
+// The latency target is how long before a frame's deadline its work starts.
+// Starting later samples input later: with vsync, a target just above the
+// frame cost gives the lowest input-to-photon latency.
+class FramePacer {
+public:
+    FramePacer();
+
+    // period in seconds; 0 disables pacing
+    void setPeriod(double seconds);
+    void setVsync(VsyncMode mode) { vsync = mode; }
+    void setLatencyTarget(double seconds) { latencyTarget = seconds; }
+
+    // Call at the top of the frame, before input is sampled
+    void waitForFrameStart();
+    // Call right after SwapBuffers returns
+    void endFrame();
+
+    double getPeriod() const { return period; }
+    double getOvershootEstimate() const { return overshootEstimate; }
+
+    // Jitter of the present interval over the recorded frames, in seconds
+    double getJitterStdDev() const;
+    double getMaxDeviation() const;
+    void printStats() const;
+
+    static double now();
+
+private:
+    double period;
+    double latencyTarget;
+    VsyncMode vsync;
+
+    double nextDeadline;
+    double lastPresent;
+    double overshootEstimate;
+
+    std::vector<float> intervals;
+    int intervalHead;
+    int intervalCount;
+
+    void sleepUntil(double deadline);
+};
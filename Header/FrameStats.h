@@ -0,0 +1,23 @@
+#pragma once
+#include <vector>
+
+// Collects per-frame times and summarizes them with percentiles
+class FrameStats {
+public:
+    struct Summary {
+        int count;
+        double mean, min, max;
+        double p50, p95, p99;
+    };
+
+    void reserve(int frames) { samples.reserve(frames); }
+    void addSample(double milliseconds) { samples.push_back(milliseconds); }
+    void clear() { samples.clear(); }
+    int getCount() const { return (int)samples.size(); }
+
+    Summary summarize() const;
+    void print(const char* label) const;
+
+private:
+    std::vector<double> samples;
+};
@@ -3,25 +3,45 @@
 #include "Models.h"
 #include "ShaderUniforms.h"
 #include "HandController.h"
+#include "ResourceManager.h"
+#include "TriangleBvh.h"
+#include "TransformHierarchy.h"
 
 class Hand {
 public:
     Hand();
     ~Hand();
 
-    void init(const char* armModelPath);
+    void init(ResourceManager& resources, const char* armModelPath);
     void update(double deltaTime, const glm::vec3& cameraPos);
-    void render(const ShaderUniforms& uniforms) const;
+    // Draws the arm with world matrices taken from a scene snapshot
+    void render(const ShaderUniforms& uniforms, const std::vector<glm::mat4>& transforms) const;
+
+    // Adds the hand and arm nodes; the hand node is a root
+    void attachTransforms(TransformHierarchy& transforms);
+    // Moves the hand node to the interpolated pose, if it changed
+    void updateTransforms(TransformHierarchy& transforms);
+    int getHandNode() const { return handNode; }
+    int getArmNode() const { return armNode; }
 
     void toggleViewingMode();
     bool isInViewingMode() const;
     bool isInTransition() const;
 
+    // Interpolated between the last two simulation steps, for rendering
     glm::mat4 getTransformMatrix() const;
-    glm::mat4 getArmTransformMatrix() const;
+    // Latest simulation step
+    glm::mat4 getStateTransformMatrix() const;
+
+    // Arm triangles for picking, placed by the arm node
+    const TriangleBvh& getArmBvh() const { return armBvh; }
+
+    void beginStep();
+    void setRenderAlpha(float alpha) { renderAlpha = alpha; }
 
 private:
-    Model* armModel;
+    ResourceHandle armModel;
+    TriangleBvh armBvh;
     HandController controller;
 
     glm::vec3 skinKD, skinKA, skinKS;
@@ -30,4 +50,9 @@ private:
     glm::vec3 armOffset;
     glm::vec3 armRotation;
     float armScale;
+    float renderAlpha;
+
+    int handNode, armNode;
+    glm::vec3 nodePosition;   // pose the hand node was last built from
+    float nodeRotation;
 };
@@ -22,6 +22,12 @@ private:
 
     bool isTransitioning;
 
+    // Previous-step state for render interpolation
+    glm::vec3 prevPosition;
+    float prevRotation;
+
+    float getRotationAmount() const;
+
 public:
     HandController();
 
@@ -30,6 +36,12 @@ public:
     void toggleState();
 
     glm::mat4 getTransformMatrix() const;
+    glm::mat4 getInterpolatedTransformMatrix(float alpha) const;
+    // What getInterpolatedTransformMatrix builds its matrix from
+    void getInterpolatedPose(float alpha, glm::vec3& position, float& rotation) const;
+    static glm::mat4 buildTransform(const glm::vec3& position, float rotation);
+
+    void beginStep();
 
     glm::vec3 getPosition() const { return cameraPosition + currentOffset; }
 
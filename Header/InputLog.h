@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "MappedFile.h"
+
+// Compact binary log of everything that drives the simulation: the RNG seed,
+// starting watch clock and screen, then one record per frame (deltaTime and held
+// movement keys) followed by the input events delivered during that frame.
+// Replaying a log reproduces the recorded run bit for bit.
+
+enum InputEventType : uint8_t {
+    INPUT_EVENT_KEY = 1,
+    INPUT_EVENT_CURSOR = 2,
+    INPUT_EVENT_BUTTON = 3
+};
+
+struct InputEvent {
+    InputEventType type;
+    int code;       // key or mouse button
+    int action;
+    int mods;
+    double x, y;    // cursor position (cursor and button events)
+};
+
+struct InputLogHeader {
+    uint32_t seed;
+    int32_t width, height;
+    int32_t hours, minutes, seconds;
+    int32_t screen;     // WatchScreen; version 1 logs lack it and start on the clock
+};
+
+struct InputFrame {
+    double deltaTime;
+    uint8_t heldKeys;
+    std::vector<InputEvent> events;
+};
+
+class InputLogWriter {
+public:
+    InputLogWriter();
+    ~InputLogWriter();
+
+    bool open(const char* path, const InputLogHeader& header);
+    void close();
+
+    void addFrame(double deltaTime, uint8_t heldKeys);
+    void addKey(int key, int action, int mods);
+    void addCursor(double x, double y);
+    void addButton(int button, int action, int mods, double x, double y);
+
+    int getFrameCount() const { return frameCount; }
+
+private:
+    FILE* file;
+    int frameCount;
+    std::vector<unsigned char> buffer;
+
+    void put(const void* data, size_t size);
+    void flush();
+};
+
+class InputLogReader {
+public:
+    InputLogReader();
+
+    bool open(const char* path);
+    const InputLogHeader& getHeader() const { return header; }
+
+    // Fills the next frame and its events; false at the end of the log
+    bool nextFrame(InputFrame& out);
+
+private:
+    MappedFile file;
+    InputLogHeader header;
+    size_t cursor;
+
+    bool get(void* data, size_t size);
+};
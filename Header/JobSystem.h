@@ -0,0 +1,140 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef void (*JobFunction)(void* data, int begin, int end);
+
+class JobCounter;
+
+struct Job {
+    JobFunction function;
+    void* data;
+    int begin, end;
+    JobCounter* counter;
+};
+
+// Number of unfinished jobs in a batch. Waiting on it, or chaining jobs
+// after it with runAfter, is how jobs depend on each other. Must outlive
+// every job counted on it.
+class JobCounter {
+public:
+    JobCounter() : pending(0) {}
+    bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+    std::atomic<int> pending;
+};
+
+// Work-stealing job scheduler. Every thread that submits work gets its own
+// deque: the owner pushes and pops at the bottom, idle threads steal from
+// the top of the others. Threads that wait on a counter run jobs meanwhile,
+// so waiting never blocks a core. Jobs are plain function pointers over an
+// index range, which is all parallelFor needs.
+//
+// Long jobs that nothing waits on within a frame (file decoding) go through
+// runBackground instead. Only idle workers take them; wait() never does, so
+// a short parallelFor on the simulation thread cannot end up running a
+// multi-millisecond decode before it returns. Started without workers, the
+// system keeps one thread just for background jobs, so they still never
+// run on the thread that submits them.
+class JobSystem {
+public:
+    static JobSystem& get();
+
+    // workerCount < 0 uses one worker per hardware thread besides the caller
+    void start(int workerCount = -1);
+    void stop();
+    int getThreadCount() const { return workerCount + 1; }
+
+    void run(JobFunction function, void* data, int begin, int end, JobCounter* counter);
+    // Runs the job on a worker once no other work is queued; never from wait().
+    // Runs inline only before start or after stop.
+    void runBackground(JobFunction function, void* data, int begin, int end, JobCounter* counter);
+    // Queues the job once every job counted on dependency has finished
+    void runAfter(JobCounter& dependency, JobFunction function, void* data, int begin, int end, JobCounter* counter);
+    // Splits [0, count) into ranges of at least grain items
+    void parallelFor(int count, int grain, JobFunction function, void* data, JobCounter& counter);
+    // Runs queued jobs until the counter reaches zero
+    void wait(JobCounter& counter);
+
+    // Blocking parallelFor; body(begin, end) is called for each range
+    template<typename F>
+    void parallelFor(int count, int grain, const F& body) {
+        if (count <= grain || workerCount == 0) {
+            if (count > 0) body(0, count);
+            return;
+        }
+        JobCounter counter;
+        parallelFor(count, grain, [](void* data, int begin, int end) { (*(const F*)data)(begin, end); }, (void*)&body, counter);
+        wait(counter);
+    }
+
+private:
+    JobSystem();
+    ~JobSystem();
+
+    // Chase-Lev deque with a fixed capacity. Slot fields are relaxed atomics
+    // so a thief reading a slot the owner is reusing is not a data race; the
+    // thief's CAS on top then fails and the value is discarded.
+    struct WorkQueue {
+        static const int CAPACITY = 1024;
+
+        struct Slot {
+            std::atomic<JobFunction> function;
+            std::atomic<void*> data;
+            std::atomic<int> begin, end;
+            std::atomic<JobCounter*> counter;
+        };
+
+        Slot slots[CAPACITY];
+        alignas(64) std::atomic<int64_t> top;
+        alignas(64) std::atomic<int64_t> bottom;
+
+        WorkQueue() : top(0), bottom(0) {}
+        bool push(const Job& job);
+        bool pop(Job& out);
+        bool steal(Job& out);
+    };
+
+    // Queue 0 belongs to the thread that called start, then the workers;
+    // other threads that submit work take one of the external queues
+    static const int MAX_WORKERS = 63;
+    static const int MAX_EXTERNAL = 16;
+    static const int MAX_QUEUES = 1 + MAX_WORKERS + MAX_EXTERNAL;
+
+    std::atomic<WorkQueue*> queues[MAX_QUEUES];
+    std::atomic<int> externalCount;
+    std::vector<std::thread> workers;
+    std::thread backgroundWorker;   // only while there are no workers
+    int workerCount;
+    std::atomic<bool> running;
+    std::atomic<uint32_t> wakeSignal;
+
+    // Jobs waiting on a counter; only touched when runAfter is used
+    struct Continuation {
+        JobCounter* dependency;
+        Job job;
+    };
+    std::mutex continuationMutex;
+    std::vector<Continuation> continuations;
+    std::atomic<int> continuationCount;
+
+    // Background jobs, taken first in first out by idle workers
+    std::mutex backgroundMutex;
+    std::deque<Job> backgroundJobs;
+    std::atomic<int> backgroundCount;
+
+    int getQueueIndex();
+    void submit(const Job& job);
+    bool findJob(int self, Job& out);
+    bool findBackgroundJob(Job& out);
+    void execute(const Job& job);
+    void finish(JobCounter* counter);
+    void workerLoop(int index);
+    void backgroundLoop();
+};
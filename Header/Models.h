@@ -15,7 +15,7 @@ struct Vertex {
 struct Mesh {
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
-    unsigned int VAO, VBO, EBO;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;   // 0 when never uploaded
     glm::vec3 color = glm::vec3(0.8f);
 
     void setupMesh();
@@ -27,15 +27,24 @@ class Model {
 private:
     std::vector<Mesh> meshes;
     std::string directory;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
     
-    void loadModel(const std::string& path);
+    void loadModel(const std::string& path, bool upload);
     
 public:
-    Model(const std::string& path);
+    // Without upload the meshes stay CPU-only, for tools and picking
+    Model(const std::string& path, bool upload = true);
     ~Model();
     
     void draw() const;
     void drawWithMaterials(const ShaderUniforms& uniforms) const;
+
+    size_t getMemoryBytes() const;
+    const std::vector<Mesh>& getMeshes() const { return meshes; }
+
+    glm::vec3 getBoundsMin() const { return boundsMin; }
+    glm::vec3 getBoundsMax() const { return boundsMax; }
 };
 
 namespace Geometry {
@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+// CPU hierarchical-Z occlusion culler. Low-poly occluder boxes are rasterized
+// into a small depth buffer, a max-depth pyramid is built from it and bounding
+// boxes are then tested against the pyramid. Uses no GL state.
+class OcclusionCuller {
+public:
+    OcclusionCuller(int width = 256, int height = 128);
+
+    void beginFrame(const glm::mat4& viewProj);
+    void addOccluder(const glm::vec3& boxMin, const glm::vec3& boxMax);
+    void buildHierarchy();
+
+    bool isVisible(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    const std::vector<float>& getDepthBuffer() const { return depth; }
+    int getOccluderTriangleCount() const { return occluderTriangles; }
+
+private:
+    int width, height;
+    glm::mat4 viewProj;
+    std::vector<float> depth;
+
+    // Max-depth mip chain, level 0 is a copy of the depth buffer
+    std::vector<std::vector<float>> hiz;
+    std::vector<glm::ivec2> hizSize;
+
+    int occluderTriangles;
+
+    void rasterizeTriangle(const glm::vec4& c0, const glm::vec4& c1, const glm::vec4& c2);
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+// Framebuffer object with color and depth renderbuffers, used as the render
+// target when there is no visible window
+class OffscreenTarget {
+public:
+    OffscreenTarget();
+    ~OffscreenTarget();
+
+    bool init(int width, int height);
+    void bind() const;
+    void unbind() const;
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    unsigned int fbo;
+    unsigned int colorBuffer, depthBuffer;
+    int width, height;
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "DigitRenderer.h"
+#include "RenderStats.h"
+
+// Live frame diagnostics drawn in screen space on top of the overlay pass:
+// FPS, CPU/GPU frame time, p50/p99 over the last frames, draw counters and
+// a scrolling frame-time graph. Everything goes through one DigitRenderer
+// batch, so the HUD costs a handful of draw calls.
+class PerformanceHud {
+public:
+    PerformanceHud(int historySize = 120);
+
+    void toggle() { visible = !visible; }
+    bool isVisible() const { return visible; }
+
+    void addFrame(double frameMs, double cpuMs, double gpuMs, const RenderStats::Counters& counters);
+
+    // Expects an orthographic projection in pixels to be set already
+    void render(DigitRenderer& digits, unsigned int shader, int screenWidth, int screenHeight);
+
+private:
+    bool visible;
+    int historySize;
+    int head, count;
+    std::vector<float> frameHistory;
+    std::vector<float> cpuHistory;
+    std::vector<float> sorted;
+
+    double lastGpuMs;
+    RenderStats::Counters lastCounters;
+};
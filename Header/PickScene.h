@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "TriangleBvh.h"
+
+struct PickHit {
+    int object;           // id given to PickScene::add
+    int triangle;
+    float distance;       // world units along the normalized ray
+    glm::vec3 position;   // world space
+    glm::vec2 uv;         // texture coordinates on the hit mesh
+};
+
+// Instances of triangle hierarchies placed in the world for ray picking.
+// Rebuilt whenever it is needed; adding a target is only a matrix inverse.
+class PickScene {
+public:
+    void clear() { targets.clear(); }
+    // The hierarchy must outlive the scene
+    void add(int object, const TriangleBvh* bvh, const glm::mat4& model);
+
+    // Nearest hit along a world-space ray
+    bool pick(const glm::vec3& origin, const glm::vec3& direction, PickHit& hit) const;
+
+    int size() const { return (int)targets.size(); }
+
+private:
+    struct Target {
+        int object;
+        const TriangleBvh* bvh;
+        glm::mat4 inverseModel;
+        glm::vec3 boxMin, boxMax;   // world bounds, rejects most targets early
+    };
+
+    std::vector<Target> targets;
+};
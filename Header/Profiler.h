@@ -0,0 +1,121 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Frame profiler. CPU scopes from any thread go into a fixed-size lock-free
+// ring buffer; GPU passes are timed with GL_TIME_ELAPSED queries that are
+// read back two frames later so the CPU never waits on the GPU. The ring
+// holds the last few seconds of events and can be written out as Chrome
+// trace-event JSON (chrome://tracing, Perfetto).
+//
+// Scope and counter names must be string literals, only the pointer is stored.
+class Profiler {
+public:
+    static Profiler& get();
+
+    void setEnabled(bool value) { enabled.store(value, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // Nanoseconds since the profiler was created
+    uint64_t now() const;
+
+    // Frame boundaries on the GL thread; beginFrame collects finished GPU timings
+    void beginFrame();
+    void endFrame();
+
+    void recordCpu(const char* name, uint64_t start, uint64_t end);
+    void counter(const char* name, double value);
+    void setThreadName(const char* name);
+
+    // GPU passes cannot nest (one GL_TIME_ELAPSED query at a time)
+    void beginGpuPass(const char* name);
+    void endGpuPass();
+    double getLastGpuFrameMs() const { return lastGpuFrameMs; }
+
+    bool exportChromeTrace(const char* path) const;
+
+    // Releases the GL query objects, call while the context is still current
+    void shutdownGpu();
+
+private:
+    Profiler();
+
+    enum EventType : uint8_t {
+        EVENT_CPU,
+        EVENT_GPU,
+        EVENT_COUNTER
+    };
+
+    struct Event {
+        const char* name;
+        uint64_t start;
+        uint64_t duration;
+        double value;
+        uint32_t thread;
+        EventType type;
+    };
+
+    // sequence is 0 while the slot is being written, index + 1 once published
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        Event event;
+    };
+
+    static const uint32_t RING_SIZE = 1 << 16;
+    static const uint32_t GPU_THREAD = 0xFFFF;
+
+    struct GpuPass {
+        const char* name;
+        unsigned int queries[2];
+        uint64_t cpuStart[2];
+        bool pending[2];
+    };
+
+    std::atomic<bool> enabled;
+    std::atomic<uint64_t> writeIndex;
+    std::vector<Slot> slots;
+    uint64_t epoch;
+
+    std::vector<GpuPass> gpuPasses;
+    int activeGpuPass;
+    uint64_t frameIndex;
+    double gpuFrameAccumMs;
+    double lastGpuFrameMs;
+    int droppedGpuQueries;
+
+    mutable std::mutex threadNameMutex;
+    std::vector<std::pair<uint32_t, std::string>> threadNames;
+
+    void push(const Event& e);
+    uint32_t currentThread();
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name)
+        : name(name), start(Profiler::get().isEnabled() ? Profiler::get().now() : 0) {}
+    ~ProfileScope() {
+        if (start) Profiler::get().recordCpu(name, start, Profiler::get().now());
+    }
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+class GpuProfileScope {
+public:
+    explicit GpuProfileScope(const char* name) : cpu(name) { Profiler::get().beginGpuPass(name); }
+    ~GpuProfileScope() { Profiler::get().endGpuPass(); }
+
+private:
+    ProfileScope cpu;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILE_CONCAT(gpuProfileScope_, __LINE__)(name)
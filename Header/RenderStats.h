@@ -0,0 +1,36 @@
+#pragma once
+
+// Per-frame draw counters for the performance HUD. Only the GL thread
+// touches them, so plain integers are enough.
+class RenderStats {
+public:
+    struct Counters {
+        int drawCalls;
+        long long triangles;
+        int uniformUploads;
+    };
+
+    static RenderStats& get() {
+        static RenderStats stats;
+        return stats;
+    }
+
+    void countDraw(long long triangleCount) {
+        current.drawCalls++;
+        current.triangles += triangleCount;
+    }
+    void countUniforms(int count = 1) { current.uniformUploads += count; }
+
+    // Publishes this frame's totals and starts counting the next frame
+    void endFrame() {
+        last = current;
+        current = Counters();
+    }
+    const Counters& getLastFrame() const { return last; }
+
+private:
+    RenderStats() : current(), last() {}
+
+    Counters current;
+    Counters last;
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+class Model;
+class ResourceManager;
+
+enum ResourceType {
+    RESOURCE_TEXTURE,
+    RESOURCE_MODEL
+};
+
+// Reference-counted handle to a resource owned by a ResourceManager. The
+// resource is freed when the last handle to it goes away.
+class ResourceHandle {
+public:
+    ResourceHandle() : manager(nullptr), id(-1) {}
+    ResourceHandle(const ResourceHandle& other);
+    ResourceHandle(ResourceHandle&& other) noexcept;
+    ResourceHandle& operator=(const ResourceHandle& other);
+    ResourceHandle& operator=(ResourceHandle&& other) noexcept;
+    ~ResourceHandle();
+
+    bool valid() const { return manager != nullptr; }
+    unsigned int texture() const;
+    Model* model() const;
+
+    void reset();
+
+private:
+    friend class ResourceManager;
+    ResourceHandle(ResourceManager* manager, int id);
+
+    ResourceManager* manager;
+    int id;
+};
+
+// Loads textures and models once per unique file content. Identical files
+// under different paths share a single GL object.
+class ResourceManager {
+public:
+    struct ResourceInfo {
+        std::string name;
+        ResourceType type;
+        uint64_t contentHash;
+        int refCount;
+        size_t cpuBytes;
+        size_t gpuBytes;
+    };
+
+    ResourceManager();
+    ~ResourceManager();
+
+    ResourceHandle acquireTexture(const std::string& path, bool async = true);
+    ResourceHandle acquireModel(const std::string& path);
+
+    // Tracks a texture owned elsewhere so it shows up in snapshots
+    ResourceHandle trackTexture(const std::string& name, unsigned int texture);
+
+    std::vector<ResourceInfo> snapshot() const;
+    void printSnapshot() const;
+
+private:
+    friend class ResourceHandle;
+
+    struct Entry {
+        std::string name;
+        ResourceType type = RESOURCE_TEXTURE;
+        uint64_t contentHash = 0;
+        int refCount = 0;
+        bool owned = false;
+        unsigned int texture = 0;
+        Model* model = nullptr;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<int> freeSlots;
+    std::unordered_map<uint64_t, int> byHash;
+    std::unordered_map<std::string, uint64_t> pathHashes;
+
+    bool hashFile(const std::string& path, uint64_t& outHash);
+    int allocateEntry();
+    void addRef(int id);
+    void release(int id);
+    size_t textureBytes(unsigned int texture) const;
+};
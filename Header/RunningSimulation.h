@@ -1,34 +1,87 @@
 #pragma once
 #include <vector>
+#include <deque>
+#include <cstdint>
 #include <glm/glm.hpp>
+#include "CityGenerator.h"
+#include "JobSystem.h"
 
 class RunningSimulation {
-public:
-    struct Building {
-        glm::vec3 position;
-        float scale;
-        int type;
-    };
-
 private:
     bool isRunning;
     float speed;
     float segmentLength;
     int numSegments;
-    float buildingSpacing;
+    float viewDistance;
+    float lastMovement;
 
+    // Road segments stay sorted by descending z when read from the head
+    // index, so the one that passes the camera first is always at the head
+    // and recycling it to the back is just advancing the head.
     std::vector<float> segmentPositions;
-    std::vector<Building> buildings;
+    int segmentHead;
+
+    // Streamed city. Buildings and side streets of the active chunks are
+    // stored front to back, so retiring the nearest chunk drops a prefix.
+    // Retired buildings stay in the arrays in front of buildingHead until
+    // they outnumber the live ones, then one compaction drops them all; every
+    // building is moved at most once on average.
+    struct ActiveChunk {
+        int64_t index;
+        int buildingCount;
+        int sideStreetCount;
+    };
+
+    // A chunk being generated on the job system. The chunk belongs to the
+    // job until done, so the index is kept outside of it.
+    struct ChunkRequest {
+        int64_t index;
+        CityChunk chunk;
+        const CityGenerator* generator;
+        JobCounter done;
+    };
+
+    CityGenerator generator;
+    double distance;   // track position of the camera
+    BuildingArrays buildings;
+    int buildingHead;        // first live building in buildings
+    std::vector<SideStreet> sideStreets;
+    std::deque<ActiveChunk> activeChunks;
+    int64_t firstBuilding;   // serial number of the building at buildingHead
+    std::deque<ChunkRequest*> pendingChunks;
+    std::vector<ChunkRequest*> freeRequests;
+    int64_t nextChunk;
+
+    static void generateChunkJob(void* data, int begin, int end);
+    void streamChunks();
+    void waitForPendingChunks();
 
 public:
-    RunningSimulation(float segmentLength = 10.0f, int numSegments = 5);
-    
+    RunningSimulation(float segmentLength = 10.0f, int numSegments = 5, float viewDistance = 160.0f, uint32_t seed = 0);
+    ~RunningSimulation();
+
     void update(double deltaTime, bool running);
     void reset();
-    
+    // Regenerates the city from the start for a new seed
+    void setSeed(uint32_t seed);
+
+    // Storage order, not street order
     const std::vector<float>& getSegmentPositions() const { return segmentPositions; }
-    const std::vector<Building>& getBuildings() const { return buildings; }
-    
+    // Live buildings only; valid until the next update or reset
+    BuildingView getBuildings() const { return buildings.view(buildingHead); }
+    const std::vector<SideStreet>& getSideStreets() const { return sideStreets; }
+    int getActiveChunkCount() const { return (int)activeChunks.size(); }
+    // Buildings are numbered in street order since the last reset;
+    // buildings[i] has serial number getFirstBuildingSerial() + i
+    int64_t getFirstBuildingSerial() const { return firstBuilding; }
+    // Total distance moved since the last reset
+    double getDistance() const { return distance; }
+
     bool getIsRunning() const { return isRunning; }
     float getSpeed() const { return speed; }
+    // Distance the street moved in the last update, 0 when standing still
+    float getLastMovement() const { return lastMovement; }
 };
+
+// Adds delta to every value, four at a time where SSE2 is available
+void addToAll(float* values, int count, float delta);
@@ -0,0 +1,24 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "Street.h"
+#include "Watch.h"
+#include "Camera.h"
+
+// Everything the GL thread needs to draw one frame. The simulation thread
+// fills it after its fixed steps; once published it is never modified.
+struct SceneSnapshot {
+    uint64_t frame;
+
+    CameraBlock camera;
+
+    // World matrices of the transform hierarchy, indexed by node
+    std::vector<glm::mat4> transforms;
+    glm::vec3 watchLightPos;
+    bool handViewing;
+    bool freeCamera;
+
+    StreetDrawList street;
+    WatchDisplay watch;
+};
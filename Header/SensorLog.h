@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "MappedFile.h"
+
+// One reading of a recorded workout
+struct SensorSample {
+    int64_t timeMs;     // since the first sample of the log
+    int heartRate;      // beats per minute
+    int pace;           // seconds per kilometer, 0 while standing
+    int battery;        // percent
+};
+
+// Streams a recorded workout from a memory-mapped file, decoding samples
+// only as playback reaches them. Two formats are read:
+//
+//   CSV     one "seconds,heart_rate,pace,battery" line per sample; lines
+//           that do not start with a digit (headers, comments) are skipped
+//   binary  "SWSL", a uint32 version, then fixed 12-byte records
+//
+// Opening reads only the first and last samples. Binary records have a
+// fixed size, so a seek is a binary search over them. CSV seeks go through
+// a sparse index of the sample in effect at the start of every INDEX_MS,
+// extended only as far as seeks have reached, so a seek costs one lookup
+// plus at most one interval of decoding once that part is indexed. Samples
+// must be in time order; ones that go back in time are ignored.
+class SensorLog {
+public:
+    static const int64_t INDEX_MS = 10000;
+
+    SensorLog();
+
+    bool open(const char* path);
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+    bool isBinary() const { return binary; }
+
+    // The latest sample at or before timeMs; the last one past the end.
+    // Playing forward only decodes the samples passed since the previous call.
+    bool sampleAt(int64_t timeMs, SensorSample& out);
+
+    int64_t getDurationMs() const { return durationMs; }
+
+    // Writes samples in the binary format, for converting CSV logs
+    static bool writeBinary(const char* path, const std::vector<SensorSample>& samples);
+
+private:
+    MappedFile file;
+    bool binary;
+    size_t dataStart;
+    int64_t firstTimeMs;   // absolute time of the first sample, subtracted from all of them
+    int64_t durationMs;
+
+    size_t recordCount;          // binary only
+
+    // CSV only: offset of the sample in effect at k * INDEX_MS, and where
+    // the pass that builds it stopped
+    std::vector<size_t> index;
+    size_t scanOffset;
+    size_t scanPrevious;         // offset of the last sample indexed
+    int64_t scanTime;            // and its time
+
+    // Playback position: the sample in effect and the one after it
+    bool positioned;
+    SensorSample current, next;
+    bool hasNext;
+    size_t cursor;               // offset just past next
+
+    // Decodes the sample at offset and moves offset past it; false at the end.
+    // Times come back absolute, as stored in the file.
+    bool readRecord(size_t& offset, SensorSample& out) const;
+    bool readCsvLine(size_t& offset, SensorSample& out) const;
+    bool readLastCsvLine(SensorSample& out) const;
+    // Indexes CSV lines until the index has slot or the file ends
+    void extendIndex(int64_t slot);
+    void seek(int64_t timeMs);
+    void advance();
+};
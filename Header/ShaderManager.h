@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Called after a program was relinked in place, since uniform locations may
+// have moved
+typedef void (*ShaderReloadCallback)(void* data, unsigned int program);
+
+// Builds shader programs from vertex and fragment source files. Linked
+// programs are cached on disk with glGetProgramBinary, keyed by a hash of
+// both sources and the driver's vendor, renderer and version strings, so
+// later launches skip compiling and linking until a shader or the driver
+// changes. Without program binary support, or when the driver rejects a
+// cached binary, programs are compiled from source as before.
+//
+// With hot reload on, edited shader files are recompiled and relinked into
+// the same program object, so program ids held elsewhere stay valid. A
+// shader that fails to compile or link leaves the previous version running.
+class ShaderManager {
+public:
+    ShaderManager();
+    ~ShaderManager();
+
+    ShaderManager(const ShaderManager&) = delete;
+    ShaderManager& operator=(const ShaderManager&) = delete;
+
+    // Returns 0 if a source cannot be read or the program fails to build.
+    // onReload also runs once here, after the first build.
+    unsigned int load(const char* vsPath, const char* fsPath, ShaderReloadCallback onReload = nullptr, void* data = nullptr);
+
+    // Watches the shader files: inotify on Linux, polled elsewhere
+    void enableHotReload();
+    // Relinks programs whose files changed; call on the GL thread once a
+    // frame. Returns how many were relinked.
+    int pollChanges();
+
+    void setCacheDirectory(const std::string& dir) { cacheDir = dir; }
+
+private:
+    struct Program {
+        unsigned int id;
+        std::string vsPath, fsPath;
+        std::string vsSource, fsSource;   // last sources that linked, to fall back on
+        uint64_t seenHash;                 // of the last sources built, whether they linked or not
+        ShaderReloadCallback onReload;
+        void* data;
+    };
+
+    std::vector<Program> programs;
+    std::string cacheDir;
+    std::string driver;        // vendor, renderer and version, part of every cache key
+    bool binarySupported;
+
+    bool hotReload;
+    int notifyFd;              // -1 when not on Linux or inotify is unavailable
+    std::vector<std::string> watchedDirs;
+    double nextPollTime;       // for polling without inotify
+
+    std::string getCachePath(const Program& program) const;
+    uint64_t getCacheKey(const std::string& vsSource, const std::string& fsSource) const;
+    bool loadBinary(const Program& program, uint64_t key);
+    void saveBinary(const Program& program, uint64_t key);
+
+    // Compiles and links into program.id; prints logs and timings
+    bool buildFromSource(const Program& program, const std::string& vsSource, const std::string& fsSource);
+    bool reload(Program& program);
+    void watch(const std::string& path);
+    // True when the files may have changed: an inotify event, or the poll interval passed
+    bool filesChanged();
+};
@@ -2,6 +2,7 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "RenderStats.h"
 
 struct ShaderUniforms {
     GLint uM;
@@ -54,14 +55,17 @@ struct ShaderUniforms {
 
     void setModelMatrix(const glm::mat4& m) const {
         glUniformMatrix4fv(uM, 1, GL_FALSE, glm::value_ptr(m));
+        RenderStats::get().countUniforms();
     }
 
     void setViewMatrix(const glm::mat4& v) const {
         glUniformMatrix4fv(uV, 1, GL_FALSE, glm::value_ptr(v));
+        RenderStats::get().countUniforms();
     }
 
     void setProjectionMatrix(const glm::mat4& p) const {
         glUniformMatrix4fv(uP, 1, GL_FALSE, glm::value_ptr(p));
+        RenderStats::get().countUniforms();
     }
 
     void setMaterial(const glm::vec3& kD, const glm::vec3& kA, const glm::vec3& kS, float shine) const {
@@ -69,22 +73,27 @@ struct ShaderUniforms {
         glUniform3fv(uMaterial_kA, 1, glm::value_ptr(kA));
         glUniform3fv(uMaterial_kS, 1, glm::value_ptr(kS));
         glUniform1f(uMaterial_shine, shine);
+        RenderStats::get().countUniforms(4);
     }
 
     void setTexture(bool use, GLuint texId = 0) const {
         glUniform1i(uUseTexture, use ? 1 : 0);
+        RenderStats::get().countUniforms();
         if (use && texId != 0) {
             glActiveTexture(GL_TEXTURE0);
             glBindTexture(GL_TEXTURE_2D, texId);
             glUniform1i(uTexture, 0);
+            RenderStats::get().countUniforms();
         }
     }
 
     void setFog(bool use, const glm::vec3& color = glm::vec3(0), float density = 0) const {
         glUniform1i(uUseFog, use ? 1 : 0);
+        RenderStats::get().countUniforms();
         if (use) {
             glUniform3fv(uFogColor, 1, glm::value_ptr(color));
             glUniform1f(uFogDensity, density);
+            RenderStats::get().countUniforms(2);
         }
     }
 };
@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include "InputLog.h"
+#include "SceneSnapshot.h"
+#include "TripleBuffer.h"
+
+// One frame of work for the simulation thread. Events are the ones polled
+// during the previous frame and are applied before stepping, which keeps
+// the order of the single-threaded loop and therefore replays intact.
+struct SimulationJob {
+    InputFrame input;
+    bool advance;   // false: deliver events only (the final job)
+    bool quit;
+};
+
+// Runs simulation and scene preparation on a worker thread, one frame ahead
+// of the GL thread. Jobs go through a small SPSC ring and snapshots come
+// back through a triple buffer; the only blocking is an atomic wait when
+// one side has nothing to do.
+class SimulationThread {
+public:
+    typedef void (*StepFunction)(const SimulationJob& job, SceneSnapshot& out);
+
+    SimulationThread();
+    ~SimulationThread();
+
+    void start(StepFunction step);
+    // Runs every submitted job, then joins
+    void stop();
+
+    // Takes the job's contents and leaves it with cleared vectors to reuse.
+    // Blocks only while QUEUE_SIZE jobs are pending.
+    void submit(SimulationJob& job);
+
+    // Newest snapshot whose frame is at least minFrame, waiting if needed.
+    // Stays valid until the next call.
+    const SceneSnapshot& acquire(uint64_t minFrame);
+
+private:
+    static const uint32_t QUEUE_SIZE = 4;
+
+    SimulationJob jobs[QUEUE_SIZE];
+    alignas(64) std::atomic<uint32_t> jobHead;   // written by the GL thread
+    alignas(64) std::atomic<uint32_t> jobTail;   // written by the worker
+    alignas(64) std::atomic<uint64_t> publishedCount;
+
+    TripleBuffer<SceneSnapshot> snapshots;
+    StepFunction step;
+    std::thread worker;
+
+    void run();
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+// Spatial hash over a uniform grid on the xz plane. Objects are boxes that
+// are linked into every cell they touch; cells are hashed into a bucket
+// table, so the grid is unbounded and empty space costs nothing.
+// Boxes are stored relative to an origin that can be moved for free, which
+// lets a whole scene that scrolls uniformly stay put in the grid.
+//
+// Queries only read the grid and may run on several threads at once.
+class SpatialGrid {
+public:
+    // The bucket table doubles whenever it holds more entries than buckets
+    SpatialGrid(float cellSize = 8.0f, int bucketCount = 1024);
+
+    // Boxes are given relative to the origin. Returns a handle that stays
+    // valid until the object is removed.
+    int insert(const glm::vec3& boxMin, const glm::vec3& boxMax, int userData);
+    void move(int handle, const glm::vec3& boxMin, const glm::vec3& boxMax);
+    void remove(int handle);
+    void clear();
+
+    // World position of the grid's (0, 0, 0); queries are in world space
+    void setOrigin(const glm::vec3& origin) { this->origin = origin; }
+    const glm::vec3& getOrigin() const { return origin; }
+
+    int size() const { return (int)objects.size() - (int)freeObjects.size(); }
+    int getUserData(int handle) const { return objects[handle].userData; }
+
+    // Append the user data of every overlapping object, each once
+    void queryAabb(const glm::vec3& boxMin, const glm::vec3& boxMax, std::vector<int>& out) const;
+    void queryRadius(const glm::vec3& center, float radius, std::vector<int>& out) const;
+    // Only cells whose column (the used height range) overlaps the frustum
+    // are walked. maxDistance > 0 cuts the frustum off that far from the
+    // near plane, for scenes that end before the projection's far plane.
+    void queryFrustum(const glm::mat4& viewProj, std::vector<int>& out, float maxDistance = 0.0f) const;
+    // Nearest box hit within maxDistance along a normalized direction
+    bool raycast(const glm::vec3& rayOrigin, const glm::vec3& direction, float maxDistance,
+                 int& outUserData, float& outDistance) const;
+
+private:
+    struct Object {
+        glm::vec3 boxMin, boxMax;
+        int userData;
+        glm::ivec2 cellMin, cellMax;
+        int firstEntry;   // -1 once removed
+    };
+
+    // Link of one object into one cell's bucket list
+    struct Entry {
+        int object;
+        glm::ivec2 cell;
+        glm::ivec2 objectCellMin;   // copy that saves a fetch when skipping duplicates
+        int bucket;
+        int prev, next;       // bucket list
+        int nextOfObject;
+    };
+
+    float cellSize;
+    float inverseCellSize;
+    int bucketMask;
+    glm::vec3 origin;
+
+    std::vector<int> buckets;   // first entry, -1 when empty
+    std::vector<Entry> entries;
+    std::vector<Object> objects;
+    std::vector<int> freeObjects;
+    int freeEntries;            // chained through Entry::next
+    int entryCount;
+
+    // Grows only; keeps queries from walking cells nothing was ever in
+    glm::vec3 usedMin, usedMax;
+
+    glm::ivec2 cellOf(float x, float z) const;
+    int bucketOf(const glm::ivec2& cell) const;
+    void link(int handle);
+    void unlink(int handle);
+    void rehash(int bucketCount);
+
+    // Calls visit(object) once for every object linked into a cell of
+    // [cellMin, cellMax], using the query range to skip duplicates
+    template<typename F>
+    void forEachInCells(const glm::ivec2& cellMin, const glm::ivec2& cellMax, const F& visit) const;
+    // Same over rows firstRow, firstRow + 1, ... each covering the cells
+    // spans[row].x to spans[row].y (empty when x > y). An object is reported
+    // from the first of its cells in the spans, row by row.
+    template<typename F>
+    void forEachInSpans(int firstRow, const std::vector<glm::ivec2>& spans, const F& visit) const;
+};
@@ -1,28 +1,94 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <vector>
+#include <deque>
+#include <cstdint>
 #include "Models.h"
 #include "ShaderUniforms.h"
 #include "RunningSimulation.h"
+#include "OcclusionCuller.h"
+#include "SpatialGrid.h"
+#include "PickScene.h"
+#include "TransformBatch.h"
+#include "ResourceManager.h"
+
+// Culled, sorted draw data for one frame. Built on the simulation thread and
+// consumed by the GL thread without touching the live simulation.
+struct StreetDrawList {
+    struct Building {
+        int index;   // in the simulation's building arrays
+        int type;
+        uint64_t sortKey;
+    };
+
+    std::vector<float> segments;
+    std::vector<glm::mat4> sideStreets;
+    std::vector<Building> buildings;
+    // Transforms of the buildings above, in the same order; ready to upload as instance data
+    std::vector<InstanceTransform> instances;
+};
 
 class Street {
 public:
     Street();
     ~Street();
 
-    void init(float roadWidth, float segmentLength, int numSegments);
+    // Buildings are generated up to viewDistance ahead, the road a bit further
+    void init(ResourceManager& resources, float roadWidth, float segmentLength, float viewDistance);
     void update(double deltaTime, bool isRunning);
-    void render(const ShaderUniforms& uniforms) const;
+    // Rebuilds the city layout from a new seed
+    void setCitySeed(uint32_t seed);
+    // Culls against the occlusion buffer and sorts visible buildings by model, then front to back
+    void buildDrawList(const glm::mat4& viewProj, const glm::vec3& cameraPos, StreetDrawList& out);
+    void render(const ShaderUniforms& uniforms, const StreetDrawList& drawList) const;
+    // Adds every building where it is drawn, as objects firstObject + storage index
+    void addPickTargets(PickScene& scene, int firstObject) const;
+
+    // Draws the street partway through the last step, 0 = previous step, 1 = current
+    void setRenderAlpha(float alpha);
 
     const std::vector<float>& getSegmentPositions() const;
+    BuildingView getBuildings() const;
+    // Meters per second the runner is moving, 0 when standing
+    float getRunningSpeed() const;
 
 private:
     Mesh groundPlane;
     Mesh roadSegment;
-    std::vector<Model*> buildingModels;
+    float roadWidth;
+    std::vector<ResourceHandle> buildingModels;
+    std::vector<TriangleBvh> buildingBvhs;   // one per building type
     RunningSimulation* simulation;
 
-    unsigned int roadTexture;
+    ResourceHandle roadTexture;
+
+    OcclusionCuller occlusionCuller;
+
+    // Buildings in track space: the grid origin follows the distance run, so
+    // moving the street never touches it. User data is the building serial.
+    SpatialGrid buildingGrid;
+    std::deque<int> gridHandles;   // street order, like the buildings
+    int64_t gridEnd;               // serial after the last inserted building
+    // Furthest building edge from the road center and highest roof so far,
+    // which with the ends of the street bound what a query can find
+    float buildingReach, buildingTop;
+    std::vector<int> queryResults;
+
+    // Per-building cull results, filled in parallel then compacted
+    std::vector<StreetDrawList::Building> candidates;
+    std::vector<unsigned char> candidateVisible;
+    // Positions, rotations and scales of the drawn buildings in draw order
+    BuildingArrays instanceInputs;
+
+    // Z shift from simulation state back to the interpolated render position
+    float renderOffset;
+
+    void getBuildingBounds(const BuildingView& buildings, int i, glm::vec3& outMin, glm::vec3& outMax) const;
+    glm::mat4 getBuildingMatrix(const BuildingView& buildings, int i) const;
+    // How far from the camera the frustum query has to reach, 0 for no limit
+    float getCullDistance(const BuildingView& buildings, const glm::vec3& cameraPos) const;
+    // Adds newly generated buildings to the grid and drops retired ones
+    void syncGrid();
 
     struct {
         glm::vec3 groundKD, groundKA, groundKS;
@@ -2,13 +2,14 @@
 #include <glm/glm.hpp>
 #include "Models.h"
 #include "ShaderUniforms.h"
+#include "ResourceManager.h"
 
 class Sun {
 public:
     Sun();
     ~Sun();
 
-    void init(const char* texturePath);
+    void init(ResourceManager& resources, const char* texturePath);
     void render(const ShaderUniforms& uniforms) const;
 
     glm::vec3 getPosition() const { return position; }
@@ -21,7 +22,7 @@ public:
 private:
     Mesh sunMesh;
     bool meshReady;
-    unsigned int texture;
+    ResourceHandle texture;
     glm::vec3 position;
     float scale;
 
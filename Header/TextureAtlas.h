@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+// Packs several images into one texture at load time (skyline bottom-left).
+// Every region is surrounded by edge-extruded padding and aligned to the
+// padding size, so mip levels up to log2(padding) never bleed between icons.
+class TextureAtlas {
+public:
+    struct Region {
+        glm::vec2 uvMin;
+        glm::vec2 uvMax;
+    };
+
+    TextureAtlas(int padding = 4, int maxImageSize = 256);
+    ~TextureAtlas();
+
+    int addImage(const std::string& name, const char* filePath);
+    bool build();
+
+    unsigned int getTexture() const { return texture; }
+    int getRegionCount() const { return (int)regions.size(); }
+    const Region& getRegion(int id) const { return regions[id]; }
+    int findRegion(const std::string& name) const;
+
+    int getWidth() const { return atlasWidth; }
+    int getHeight() const { return atlasHeight; }
+
+private:
+    struct Image {
+        std::string name;
+        int width, height;
+        std::vector<unsigned char> pixels;
+        int x, y;
+    };
+
+    struct SkylineNode {
+        int x, y, width;
+    };
+
+    std::vector<Image> images;
+    std::vector<Region> regions;
+    std::unordered_map<std::string, int> lookup;
+
+    int padding;
+    int maxImageSize;
+    int atlasWidth, atlasHeight;
+    unsigned int texture;
+
+    bool pack(int width, int height);
+    int findPosition(const std::vector<SkylineNode>& skyline, int w, int h, int limitW, int limitH, int& outX, int& outY) const;
+};
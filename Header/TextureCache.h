@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+// Cooked texture container written next to the source image (<image>.stex).
+// It stores the full mip chain in its final GL upload format so a cache hit
+// is a memory map plus one upload per level, with no decode or mip generation.
+struct CookedTexture {
+    struct Level {
+        int width, height;
+        size_t offset, size;
+    };
+
+    int width, height, channels;
+    unsigned int glFormat;
+    std::vector<Level> levels;
+
+    const unsigned char* data;
+    size_t dataSize;
+
+    // Backing storage: a mapped cache file or a freshly cooked buffer
+    MappedFile file;
+    std::vector<unsigned char> storage;
+
+    CookedTexture() : width(0), height(0), channels(0), glFormat(0), data(nullptr), dataSize(0) {}
+};
+
+std::string getCookedTexturePath(const char* sourcePath);
+
+bool loadCookedTexture(const char* sourcePath, CookedTexture& out);
+bool cookTexture(const char* sourcePath, const unsigned char* pixels, int width, int height, int channels, bool dropAlpha, CookedTexture& out);
+
+// Uploads every level into the given texture (or a new one when 0)
+unsigned int uploadCookedTexture(const CookedTexture& tex, unsigned int texture = 0);
+void setCookedTextureParameters(const CookedTexture& tex);
+
+void downsampleImage(const unsigned char* src, int width, int height, int channels, std::vector<unsigned char>& dst, int& outWidth, int& outHeight);
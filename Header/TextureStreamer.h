@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <chrono>
+#include "TextureCache.h"
+#include "JobSystem.h"
+
+// Decodes images (or maps their cooked cache) as jobs on the job system and uploads
+// them through pixel buffer objects on the GL thread. load() hands out a texture id straight away that
+// shows a 1x1 placeholder until the real image has been uploaded.
+class TextureStreamer {
+public:
+    TextureStreamer();
+    ~TextureStreamer();
+
+    unsigned int load(const char* filePath);
+    // Call before deleting a texture from load() that may still be in
+    // flight; GL reuses deleted names, so the upload cannot tell by itself
+    void cancel(unsigned int texture);
+
+    // Must be called on the thread that owns the GL context
+    void processUploads(int maxUploads = 1);
+
+    bool isIdle();
+
+private:
+    struct Request {
+        std::string path;
+        unsigned int texture;
+        uint32_t ticket;
+    };
+
+    struct Decoded {
+        Request request;
+        CookedTexture* texture;
+        bool cacheHit;
+        double decodeMs;
+    };
+
+    struct DecodeTask {
+        TextureStreamer* streamer;
+        Request request;
+    };
+
+    std::mutex mutex;
+    std::deque<Decoded> decoded;
+    int inFlight;
+    JobCounter decodeJobs;
+
+    unsigned int pbo;
+
+    // Ticket of the live request for each texture; GL thread only. A
+    // decoded image is uploaded only if its ticket is still the one here.
+    std::unordered_map<unsigned int, uint32_t> pending;
+    uint32_t nextTicket;
+
+    static void decodeJob(void* data, int begin, int end);
+    void decode(const Request& request);
+    void upload(Decoded& item);
+};
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+struct TimeSeriesSample {
+    int64_t time;   // milliseconds
+    int32_t value;
+};
+
+// Summary of the samples under one column of a graph
+struct TimeSeriesBucket {
+    int32_t min, max;
+    float average;
+    int count;      // 0 when the column has no data
+};
+
+// Append-only series of integer samples, e.g. heart rate once a second.
+// Full blocks are compressed: timestamps as delta-of-delta, values as
+// deltas, both zigzagged and bit-packed at the narrowest width the block
+// needs, so a steady one-second cadence costs no timestamp bits at all.
+// Next to the blocks sits a pyramid of min/max/sum buckets, each level
+// merging pairs of the one below, which answers graph queries without
+// decoding anything.
+class TimeSeries {
+public:
+    static const int BLOCK_SAMPLES = 256;
+    static const int BUCKET_SAMPLES = 32;   // samples per bucket on the lowest level
+
+    TimeSeries();
+
+    // Timestamps must not decrease
+    void append(int64_t time, int32_t value);
+    void clear();
+
+    int getCount() const { return count; }
+    int64_t getFirstTime() const;
+    int64_t getLastTime() const;
+
+    // Every sample with from <= time < to, oldest first; decodes only the blocks involved
+    void read(int64_t from, int64_t to, std::vector<TimeSeriesSample>& out) const;
+
+    // Splits [from, to) into columns equal spans and summarizes each from the
+    // pyramid, in O(log n) per column whatever the sample count. Resolution is
+    // one lowest-level bucket: a bucket straddling two columns counts in both.
+    void summarize(int64_t from, int64_t to, int columns, TimeSeriesBucket* out) const;
+
+    // Memory held by the blocks, the pyramid and the object itself, which
+    // includes the 3 KB open block. Vectors count at capacity, not size.
+    size_t getMemoryBytes() const;
+
+private:
+    struct Block {
+        int64_t firstTime;
+        int64_t firstDelta;    // between the first two timestamps
+        int32_t firstValue;
+        uint32_t firstWord;    // into words
+        uint8_t timeBits, valueBits;
+        uint16_t count;
+    };
+
+    // Sample counts follow from the position: only the last bucket of a level is partial
+    struct Aggregate {
+        int32_t min, max;
+        int64_t sum;
+    };
+
+    std::vector<Block> blocks;
+    std::vector<uint64_t> words;
+
+    // The block being filled, uncompressed until it is full
+    int64_t openTimes[BLOCK_SAMPLES];
+    int32_t openValues[BLOCK_SAMPLES];
+    int openCount;
+
+    // First timestamp of each lowest-level bucket, and the levels themselves
+    std::vector<int64_t> bucketTimes;
+    std::vector<std::vector<Aggregate>> levels;
+
+    int count;
+
+    void sealOpenBlock();
+    void decodeBlock(const Block& block, int64_t* times, int32_t* values) const;
+    void addToPyramid(int64_t time, int32_t value);
+    Aggregate aggregateBuckets(int first, int end, int& samples) const;
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Called with the deadline the timer was due at, not the time it ran
+typedef void (*TimerCallback)(void* data, int64_t deadline);
+
+// Hierarchical timer wheel over integer ticks (the watch uses
+// milliseconds). Four levels of 64 slots cover 2^24 ticks ahead; each
+// level keeps a bitmask of occupied slots, so the next event is found with
+// a few bit scans instead of a walk over the slots. Timers further out wait
+// on an overflow list. The earliest event is cached, which makes advancing
+// to a time before it a single compare however many timers are pending.
+//
+// Periodic timers are rescheduled from their deadline rather than from the
+// time they ran, so they never drift; if advance skips several periods the
+// callback runs once for each.
+class TimerWheel {
+public:
+    static const int SLOT_BITS = 6;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const int LEVELS = 4;
+
+    TimerWheel();
+
+    // Returns an id for cancel and setPeriod. Ids of finished or cancelled
+    // timers are reused, so drop them once the timer is gone.
+    int schedule(int64_t deadline, TimerCallback callback, void* data);
+    int schedulePeriodic(int64_t firstDeadline, int64_t period, TimerCallback callback, void* data);
+    void cancel(int id);
+    // Takes effect from the next time the timer is rescheduled
+    void setPeriod(int id, int64_t period);
+
+    // Runs every timer due at or before now in deadline order; returns how many ran
+    int advance(int64_t now);
+
+    int64_t getTime() const { return current; }
+    int getActiveCount() const { return activeCount; }
+
+private:
+    struct Timer {
+        int64_t deadline;
+        int64_t period;       // 0 for one-shot timers
+        TimerCallback callback;
+        void* data;
+        int prev, next;       // within the slot list
+        int8_t level;         // LEVELS for the overflow list, -1 while due or free
+        uint8_t slot;
+        bool active;
+    };
+
+    std::vector<Timer> timers;
+    std::vector<int> freeTimers;
+    int activeCount;
+
+    int heads[LEVELS][SLOTS];
+    uint64_t occupied[LEVELS];
+    int overflowHead;
+
+    int64_t current;      // every event before this has been handled
+    int64_t nextEvent;    // no event happens before this; may be early, never late
+    std::vector<int> due;
+
+    void place(int id);
+    void unlink(int id);
+    void pushFront(int& head, int id);
+    // Time of the earliest event: timers firing at level 0, a slot cascading
+    // down from a higher level, or the overflow list (level == LEVELS)
+    int64_t findNextEvent(int& level, int& slot) const;
+};
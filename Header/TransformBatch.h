@@ -0,0 +1,39 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// Per-instance data as it goes into an instance buffer: the model matrix
+// and the normal matrix, both column-major with every column padded to a
+// vec4 so the layout works for attributes and std140 alike.
+struct InstanceTransform {
+    glm::mat4 model;
+    glm::vec4 normal[3];
+};
+static_assert(sizeof(InstanceTransform) == 28 * sizeof(float), "InstanceTransform must stay tightly packed");
+
+// Translation, rotation and scale of many instances in structure-of-arrays
+// form. Rotations are unit quaternions. When scaleY and scaleZ are null,
+// scaleX is a uniform scale.
+struct TrsArrays {
+    const float* positionX;
+    const float* positionY;
+    const float* positionZ;
+    const float* rotationX;
+    const float* rotationY;
+    const float* rotationZ;
+    const float* rotationW;
+    const float* scaleX;
+    const float* scaleY;
+    const float* scaleZ;
+};
+
+// Compose translate * rotate * scale for count instances, eight at a time
+// on CPUs with AVX2, four with SSE2, one at a time otherwise (see
+// getSimdLevel). Uniform scale skips
+// the reciprocals: its normal matrix is the bare rotation, which is only off
+// by a factor the shader's normalize removes.
+void composeTransforms(const TrsArrays& in, int count, InstanceTransform* out);
+
+// Rotation about +y by an angle in radians, with uniform scale, like the
+// street's buildings
+void composeYawTransforms(const float* positionX, const float* positionY, const float* positionZ,
+                          const float* yaw, const float* scale, int count, InstanceTransform* out);
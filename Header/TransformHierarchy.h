@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Scene-graph transforms in structure-of-arrays form. A node's parent is
+// always added before it, so one front-to-back pass over the arrays updates
+// the whole hierarchy; only nodes whose local matrix or an ancestor changed
+// since the last update are recomputed.
+class TransformHierarchy {
+public:
+    TransformHierarchy();
+
+    // parent is -1 for a root
+    int addNode(int parent, const glm::mat4& local = glm::mat4(1.0f));
+    void setLocal(int node, const glm::mat4& local);
+    void clear();
+
+    // Recomputes dirty world matrices; returns how many were recomputed
+    int update();
+
+    const glm::mat4& getLocal(int node) const { return localMatrices[node]; }
+    // As of the last update
+    const glm::mat4& getWorld(int node) const { return worldMatrices[node]; }
+    const std::vector<glm::mat4>& getWorldMatrices() const { return worldMatrices; }
+
+    int size() const { return (int)parents.size(); }
+    int getLastUpdateCount() const { return lastUpdateCount; }
+
+private:
+    std::vector<int> parents;
+    std::vector<glm::mat4> localMatrices;
+    std::vector<glm::mat4> worldMatrices;
+    std::vector<uint8_t> dirty;
+    bool anyDirty;
+    int lastUpdateCount;
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "Models.h"
+
+struct BvhHit {
+    float distance;        // in units of the ray direction's length
+    int triangle;          // in the order meshes were added
+    glm::vec2 barycentric; // weights of the second and third corner
+    glm::vec2 uv;          // interpolated texture coordinates
+};
+
+// Bounding volume hierarchy over the triangles of one or more meshes, for
+// ray picking on the CPU. Built top-down with binned SAH, then collapsed to
+// four children per node so one SSE test covers all four boxes; leaves hold
+// triangles in groups of four for the same reason.
+class TriangleBvh {
+public:
+    TriangleBvh();
+
+    // Collects triangles; nothing is usable until build
+    void addMesh(const Mesh& mesh);
+    void addModel(const Model& model);
+    void build();
+    void clear();
+
+    // Nearest hit along the ray in [0, maxDistance]; both sides of a triangle count
+    bool intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, BvhHit& hit) const;
+
+    int getTriangleCount() const { return (int)(positions.size() / 3); }
+    int getNodeCount() const { return (int)nodes.size(); }
+    glm::vec3 getBoundsMin() const { return boundsMin; }
+    glm::vec3 getBoundsMax() const { return boundsMax; }
+
+private:
+    // Four child boxes in structure-of-arrays form
+    struct alignas(16) Node {
+        float minX[4], minY[4], minZ[4];
+        float maxX[4], maxY[4], maxZ[4];
+        int child[4];         // node index, or first packet of a leaf
+        int packetCount[4];   // 0 for inner nodes, -1 for unused slots
+    };
+
+    // Up to four triangles as corner plus two edges; padding is degenerate
+    struct alignas(16) Packet {
+        float v0x[4], v0y[4], v0z[4];
+        float e1x[4], e1y[4], e1z[4];
+        float e2x[4], e2y[4], e2z[4];
+        int triangle[4];
+    };
+
+    // Binary tree from the SAH build, only used while building
+    struct BuildNode {
+        glm::vec3 boxMin, boxMax;
+        int left, right;
+        int first, count;
+    };
+
+    std::vector<glm::vec3> positions;   // three corners per triangle
+    std::vector<glm::vec2> texCoords;
+    std::vector<Node> nodes;
+    std::vector<Packet> packets;
+    glm::vec3 boundsMin, boundsMax;
+
+    // bounds holds min and max of each triangle, side by side
+    int buildRecursive(std::vector<BuildNode>& build, std::vector<int>& order, const std::vector<glm::vec3>& centroids,
+                       const std::vector<glm::vec3>& bounds, int first, int count);
+    int flatten(const std::vector<BuildNode>& build, const std::vector<int>& order, int index);
+    void emitLeaf(const BuildNode& leaf, const std::vector<int>& order);
+    void intersectPacket(const Packet& packet, const glm::vec3& origin, const glm::vec3& direction,
+                         float& best, int& bestTriangle, glm::vec2& bestBarycentric) const;
+};
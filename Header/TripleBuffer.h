@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer/single-consumer triple buffer. The writer and
+// the reader each own one slot; the third is handed over with one atomic
+// exchange, so neither side ever waits for the other. The reader always
+// sees the most recently published slot, older ones are overwritten.
+// Slots are reused, so containers inside keep their capacity.
+template<typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : back(0), front(1), middle(2) {}
+
+    // Writer side
+    T& writeSlot() { return slots[back]; }
+    void publish() {
+        back = middle.exchange((uint8_t)(back | FRESH), std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Reader side: swaps in the newest published slot, if there is one
+    const T& read() {
+        if (middle.load(std::memory_order_relaxed) & FRESH) {
+            front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+        return slots[front];
+    }
+
+private:
+    static const uint8_t FRESH = 4;
+    static const uint8_t INDEX_MASK = 3;
+
+    T slots[3];
+    alignas(64) uint8_t back;
+    alignas(64) uint8_t front;
+    alignas(64) std::atomic<uint8_t> middle;
+};
@@ -3,6 +3,10 @@
 #include <GLFW/glfw3.h>
 #include <string>
 int endProgram(std::string message);
-unsigned int createShader(const char* vsSource, const char* fsSource);
 unsigned loadImageToTexture(const char* filePath);
+unsigned loadImageToTextureAsync(const char* filePath);
+void cancelTextureUpload(unsigned texture);
+void processTextureUploads();
+void finishTextureUploads();
+void shutdownTextureStreaming();
 GLFWcursor* loadImageToCursor(const char* filePath);
\ No newline at end of file
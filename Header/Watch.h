@@ -1,8 +1,17 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <cstdint>
 #include "Models.h"
 #include "ShaderUniforms.h"
 #include "DigitRenderer.h"
+#include "TextureAtlas.h"
+#include "ResourceManager.h"
+#include "TriangleBvh.h"
+#include "TransformHierarchy.h"
+#include "EcgSignal.h"
+#include "TimeSeries.h"
+#include "SensorLog.h"
+#include "TimerWheel.h"
 
 enum WatchScreen {
     WATCH_SCREEN_CLOCK,
@@ -10,59 +19,131 @@ enum WatchScreen {
     WATCH_SCREEN_BATTERY
 };
 
+// Clickable parts of the watch face
+enum WatchWidget {
+    WATCH_WIDGET_NONE,
+    WATCH_WIDGET_PREV_ARROW,
+    WATCH_WIDGET_NEXT_ARROW
+};
+
+// What the watch face shows, copied into each scene snapshot so the GL
+// thread never reads state the simulation thread is changing
+struct WatchDisplay {
+    WatchScreen screen;
+    int hours, minutes, seconds;
+    int heartRate;
+    int batteryPercent;
+    uint64_t ecgEnd;   // ECG samples written when the snapshot was taken
+};
+
 class Watch {
 public:
     Watch();
     ~Watch();
 
-    void init();
-    void update(double deltaTime, double currentTime, bool isRunning);
-    void render(const ShaderUniforms& uniforms, const glm::mat4& handMatrix, unsigned int shader) const;
-    void renderContent(unsigned int shader, const glm::mat4& screenMatrix, double currentTime) const;
+    void init(ResourceManager& resources);
+    // speed is the runner's in meters per second, for the pace history
+    void update(double deltaTime, double currentTime, bool isRunning, float speed);
+    // World matrices come from a scene snapshot, indexed by this watch's nodes
+    void render(const ShaderUniforms& uniforms, const std::vector<glm::mat4>& transforms, unsigned int shader, const WatchDisplay& display) const;
+    void renderContent(unsigned int shader, const std::vector<glm::mat4>& transforms, const WatchDisplay& display) const;
+
+    WatchDisplay getDisplay() const;
 
     void nextScreen();
     void prevScreen();
     WatchScreen getCurrentScreen() const { return currentScreen; }
+    void setScreen(WatchScreen screen) { currentScreen = screen; }
+
+    // Adds watch -> screen -> widget nodes below the hand node; none of them
+    // move relative to the hand, so they are only recomputed when it moves
+    void attachTransforms(TransformHierarchy& transforms, int handNode);
+    int getScreenNode() const { return screenNode; }
+    glm::vec3 getLightPosition(const std::vector<glm::mat4>& transforms) const;
 
-    glm::vec3 getScreenPosition(const glm::mat4& handMatrix) const;
-    glm::vec2 getLeftArrowScreenPos() const { return leftArrowScreenPos; }
-    glm::vec2 getRightArrowScreenPos() const { return rightArrowScreenPos; }
-    void updateArrowPositions(const glm::mat4& view, const glm::mat4& proj, int screenWidth, int screenHeight);
+    // Screen disc for picking, placed by the screen node
+    const TriangleBvh& getScreenBvh() const { return screenBvh; }
+    // Widget under a texture coordinate of the screen disc on the current screen
+    WatchWidget widgetAt(const glm::vec2& uv) const;
 
     int getHeartRate() const { return heartRate; }
     int getBatteryPercent() const { return batteryPercent; }
+    const EcgSignal& getEcg() const { return ecg; }
+    void setEcgSampleRate(int hz) { ecg.setSampleRate(hz); }
+
+    // Recorded on every clock tick, timestamped in simulation milliseconds.
+    // Pace is in seconds per kilometer, 0 while standing.
+    const TimeSeries& getHeartRateHistory() const { return heartRateHistory; }
+    const TimeSeries& getBatteryHistory() const { return batteryHistory; }
+    const TimeSeries& getPaceHistory() const { return paceHistory; }
+
+    // Replays seed the heart-rate noise and start the clock where the recording did
+    void setRandomSeed(uint32_t seed) { rngState = seed ? seed : 1u; }
+    void setClock(int h, int m, int s) { hours = h; minutes = m; seconds = s; }
+    void getClock(int& h, int& m, int& s) const { h = hours; m = minutes; s = seconds; }
+
+    // Periodic work runs on this wheel in simulation milliseconds; watch
+    // features and complications can add their own timers to it
+    TimerWheel& getTimers() { return timers; }
+
+    // Plays back a recorded workout instead of simulating the sensors;
+    // the log is not owned and null goes back to simulating
+    void setSensorLog(SensorLog* log) { sensorLog = log; }
 
 private:
     Mesh watchBody;
     Mesh watchScreen;
+    TriangleBvh screenBvh;
     DigitRenderer* digitRenderer;
 
     WatchScreen currentScreen;
 
     int hours, minutes, seconds;
-    double lastTimeUpdate;
 
     int heartRate;
-    double lastHeartUpdate;
-    float ecgScrollOffset;
+    EcgSignal ecg;
 
     int batteryPercent;
-    double lastBatteryUpdate;
+    int pace;
+
+    // Clock, heart rate and battery ticks; state the callbacks read is set
+    // by update just before it advances the wheel
+    TimerWheel timers;
+    int heartTimer;
+    bool running, recorded;
+    static void clockTick(void* watch, int64_t deadline);
+    static void heartTick(void* watch, int64_t deadline);
+    static void batteryTick(void* watch, int64_t deadline);
 
-    unsigned int warningTexture;
-    unsigned int ecgTexture;
-    unsigned int batteryTexture;
-    unsigned int arrowTexture;
+    TimeSeries heartRateHistory, batteryHistory, paceHistory;
 
-    mutable glm::vec2 leftArrowScreenPos;
-    mutable glm::vec2 rightArrowScreenPos;
+    uint32_t rngState;
+    int nextRandom(int range);
+
+    SensorLog* sensorLog;
+
+    // UI icons share one atlas texture
+    TextureAtlas* uiAtlas;
+    int warningIcon, batteryIcon, arrowIcon;
+    unsigned int iconVAO, iconVBO;
+    ResourceHandle atlasTexture;
+
+    // ECG line strip, refilled every frame it is shown
+    unsigned int ecgVAO, ecgVBO;
+    mutable std::vector<float> ecgWindow;
+    mutable unsigned int boundTexture;
 
     glm::vec3 watchOffset;
     float contentScale;
 
-    void renderClockScreen(unsigned int shader, const glm::mat4& parentModel) const;
-    void renderHeartRateScreen(unsigned int shader, const glm::mat4& parentModel, double currentTime) const;
-    void renderBatteryScreen(unsigned int shader, const glm::mat4& parentModel) const;
-    void renderQuad(unsigned int shader, unsigned int texture, float x, float y, float w, float h, const glm::mat4& parentModel, bool flipX = false) const;
-    void renderECG(unsigned int shader, float x, float y, float w, float h, const glm::mat4& parentModel) const;
+    int watchNode, screenNode, prevArrowNode, nextArrowNode, lightNode;
+
+    void renderClockScreen(unsigned int shader, const glm::mat4& parentModel, const WatchDisplay& display) const;
+    void renderHeartRateScreen(unsigned int shader, const glm::mat4& parentModel, const WatchDisplay& display) const;
+    void renderBatteryScreen(unsigned int shader, const glm::mat4& parentModel, const WatchDisplay& display) const;
+    void bindTexture(unsigned int shader, unsigned int texture) const;
+    void buildIconQuads();
+    void renderQuad(unsigned int shader, int icon, float x, float y, float w, float h, const glm::mat4& parentModel) const;
+    void renderIcon(unsigned int shader, int icon, const glm::mat4& model) const;
+    void renderECG(unsigned int shader, float x, float y, float w, float h, const glm::mat4& parentModel, const WatchDisplay& display) const;
 };
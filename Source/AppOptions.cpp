@@ -0,0 +1,101 @@
+#include "../Header/AppOptions.h"
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+
+void printAppUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --headless        render offscreen for a fixed number of frames and print timings\n"
+              << "  --egl             create the headless context through EGL instead of OSMesa\n"
+              << "  --width <px>      offscreen render width (default 1280)\n"
+              << "  --height <px>     offscreen render height (default 720)\n"
+              << "  --frames <n>      frames to measure (default 600)\n"
+              << "  --warmup <n>      frames rendered before measuring (default 30)\n"
+              << "  --dt <seconds>    fixed simulation timestep (default 1/60)\n"
+              << "  --idle            measure the headless runner standing still instead of running\n"
+              << "  --record <file>   write an input log of this run\n"
+              << "  --replay <file>   drive the run from an input log instead of live input\n"
+              << "  --trace <file>    write the profiler ring buffer as Chrome trace JSON on exit (F3 writes trace.json)\n"
+              << "  --fps <n>         frame rate cap without vsync, 0 for uncapped (default 75)\n"
+              << "  --vsync <mode>    off, on or adaptive (late frames tear instead of waiting)\n"
+              << "  --latency <ms>    start each frame this long before its deadline\n"
+              << "  --threads <n>     job system threads, 0 for one per core (default 0); with 1,\n"
+              << "                    texture decoding still gets a background thread of its own\n"
+              << "  --bench           run the CPU benchmarks on 1..threads threads and exit\n"
+              << "  --view-distance <m>  how far ahead the city is generated (default 160)\n"
+              << "  --ecg-rate <hz>   watch ECG sample rate, 250 to 1000 (default 500)\n"
+              << "  --sensor-log <file>  play heart rate, pace and battery from a CSV or binary workout log\n"
+              << "  --shader-dev      relink shaders when phong.vert or phong.frag change on disk\n";
+}
+
+static bool readInt(int argc, char** argv, int& i, int minValue, int& out) {
+    if (i + 1 >= argc) return false;
+    char* end = nullptr;
+    long value = strtol(argv[++i], &end, 10);
+    if (*end != '\0' || value < minValue) return false;
+    out = (int)value;
+    return true;
+}
+
+static bool readString(int argc, char** argv, int& i, std::string& out) {
+    if (i + 1 >= argc) return false;
+    out = argv[++i];
+    return true;
+}
+
+static bool readDouble(int argc, char** argv, int& i, double& out) {
+    if (i + 1 >= argc) return false;
+    char* end = nullptr;
+    double value = strtod(argv[++i], &end);
+    if (*end != '\0' || value <= 0.0) return false;
+    out = value;
+    return true;
+}
+
+bool parseAppOptions(int argc, char** argv, AppOptions& out) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool ok = true;
+
+        if (strcmp(arg, "--headless") == 0) out.headless = true;
+        else if (strcmp(arg, "--egl") == 0) out.useEGL = true;
+        else if (strcmp(arg, "--width") == 0) ok = readInt(argc, argv, i, 1, out.width);
+        else if (strcmp(arg, "--height") == 0) ok = readInt(argc, argv, i, 1, out.height);
+        else if (strcmp(arg, "--frames") == 0) ok = readInt(argc, argv, i, 1, out.frames);
+        else if (strcmp(arg, "--warmup") == 0) ok = readInt(argc, argv, i, 0, out.warmupFrames);
+        else if (strcmp(arg, "--dt") == 0) ok = readDouble(argc, argv, i, out.fixedDeltaTime);
+        else if (strcmp(arg, "--idle") == 0) out.idle = true;
+        else if (strcmp(arg, "--record") == 0) ok = readString(argc, argv, i, out.recordPath);
+        else if (strcmp(arg, "--replay") == 0) ok = readString(argc, argv, i, out.replayPath);
+        else if (strcmp(arg, "--trace") == 0) ok = readString(argc, argv, i, out.tracePath);
+        else if (strcmp(arg, "--fps") == 0) ok = readInt(argc, argv, i, 0, out.targetFps);
+        else if (strcmp(arg, "--latency") == 0) ok = readDouble(argc, argv, i, out.latencyMs);
+        else if (strcmp(arg, "--threads") == 0) ok = readInt(argc, argv, i, 0, out.threads);
+        else if (strcmp(arg, "--bench") == 0) out.bench = true;
+        else if (strcmp(arg, "--view-distance") == 0) ok = readInt(argc, argv, i, 40, out.viewDistance);
+        else if (strcmp(arg, "--sensor-log") == 0) ok = readString(argc, argv, i, out.sensorLogPath);
+        else if (strcmp(arg, "--shader-dev") == 0) out.shaderDev = true;
+        else if (strcmp(arg, "--ecg-rate") == 0) ok = readInt(argc, argv, i, 250, out.ecgSampleRate) && out.ecgSampleRate <= 1000;
+        else if (strcmp(arg, "--vsync") == 0) {
+            std::string mode;
+            ok = readString(argc, argv, i, mode);
+            if (mode == "off") out.vsync = VSYNC_OFF;
+            else if (mode == "on") out.vsync = VSYNC_ON;
+            else if (mode == "adaptive") out.vsync = VSYNC_ADAPTIVE;
+            else ok = false;
+        }
+        else ok = false;
+
+        if (!ok) {
+            std::cerr << "Invalid argument: " << arg << std::endl;
+            printAppUsage(argv[0]);
+            return false;
+        }
+    }
+
+    if (!out.recordPath.empty() && !out.replayPath.empty()) {
+        std::cerr << "--record and --replay cannot be combined" << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,741 @@
+#include "../Header/Benchmarks.h"
+#include "../Header/JobSystem.h"
+#include "../Header/FrameStats.h"
+#include "../Header/OcclusionCuller.h"
+#include "../Header/RunningSimulation.h"
+#include "../Header/SpatialGrid.h"
+#include "../Header/TriangleBvh.h"
+#include "../Header/Models.h"
+#include "../Header/TransformBatch.h"
+#include "../Header/CpuFeatures.h"
+#include "../Header/EcgSignal.h"
+#include "../Header/TimeSeries.h"
+#include "../Header/TimerWheel.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const int BENCH_REPEATS = 15;
+
+template<typename F>
+static double medianMs(int repeats, const F& body) {
+    FrameStats stats;
+    for (int i = 0; i < repeats; i++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        stats.addSample(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return stats.summarize().p50;
+}
+
+// 1, 2, 4, ... up to and including maxThreads
+static std::vector<int> threadCounts(int maxThreads) {
+    std::vector<int> counts;
+    for (int n = 1; n < maxThreads; n *= 2) counts.push_back(n);
+    counts.push_back(maxThreads);
+    return counts;
+}
+
+template<typename F>
+static void runScaling(const char* name, int maxThreads, const F& body) {
+    std::cout << name << std::endl;
+    std::cout << "  threads   median ms   speedup   efficiency" << std::endl;
+
+    double baseMs = 0.0;
+    for (int threads : threadCounts(maxThreads)) {
+        JobSystem::get().start(threads - 1);
+        body();  // warm caches and wake the workers
+        double ms = medianMs(BENCH_REPEATS, body);
+        if (threads == 1) baseMs = ms;
+
+        double speedup = ms > 0.0 ? baseMs / ms : 0.0;
+        std::cout << std::fixed << std::setprecision(3)
+                  << "  " << std::setw(7) << threads
+                  << "  " << std::setw(10) << ms
+                  << "  " << std::setw(8) << std::setprecision(2) << speedup << "x"
+                  << "  " << std::setw(10) << std::setprecision(0) << speedup / threads * 100.0 << "%"
+                  << std::defaultfloat << std::endl;
+    }
+}
+
+static void benchmarkJobSystem(int maxThreads) {
+    // Street-style model matrices for a large instance count
+    const int INSTANCES = 1000000;
+    std::vector<glm::vec3> positions(INSTANCES);
+    std::vector<float> scales(INSTANCES);
+    std::vector<glm::mat4> models(INSTANCES);
+    for (int i = 0; i < INSTANCES; i++) {
+        positions[i] = glm::vec3((i % 2) ? 7.0f : -7.0f, 0.0f, -2.0f - (i / 2) * 4.0f);
+        scales[i] = 3.5f + (i % 3) * 0.5f;
+    }
+    runScaling("Model matrices, 1M instances", maxThreads, [&]() {
+        JobSystem::get().parallelFor(INSTANCES, 4096, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                models[i] = glm::scale(glm::translate(glm::mat4(1.0f), positions[i]), glm::vec3(scales[i]));
+            }
+        });
+    });
+
+    // Occlusion tests against a street of occluders
+    OcclusionCuller culler;
+    glm::mat4 viewProj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f)
+                       * glm::lookAt(glm::vec3(0.0f, 1.4f, 0.0f), glm::vec3(0.0f, 1.4f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    culler.beginFrame(viewProj);
+    for (int i = 0; i < 16; i++) {
+        float z = -4.0f - i * 4.0f;
+        culler.addOccluder(glm::vec3(-9.0f, 0.0f, z - 1.5f), glm::vec3(-5.0f, 12.0f, z + 1.5f));
+        culler.addOccluder(glm::vec3(5.0f, 0.0f, z - 1.5f), glm::vec3(9.0f, 12.0f, z + 1.5f));
+    }
+    culler.buildHierarchy();
+
+    const int BOXES = 200000;
+    std::vector<unsigned char> visible(BOXES);
+    runScaling("Occlusion tests, 200k boxes", maxThreads, [&]() {
+        JobSystem::get().parallelFor(BOXES, 1024, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                float x = (float)(i % 40) - 20.0f;
+                float z = -2.0f - (float)(i / 40 % 100) * 2.0f;
+                visible[i] = culler.isVisible(glm::vec3(x, 0.0f, z), glm::vec3(x + 1.0f, 2.0f, z + 1.0f)) ? 1 : 0;
+            }
+        });
+    });
+
+    // Scheduling overhead: empty jobs through run/wait
+    const int JOBS = 100000;
+    runScaling("Empty jobs, 100k", maxThreads, [&]() {
+        JobCounter counter;
+        for (int i = 0; i < JOBS; i++) JobSystem::get().run([](void*, int, int) {}, nullptr, 0, 0, &counter);
+        JobSystem::get().wait(counter);
+    });
+}
+
+// The previous array-of-structs update: move, scan for the minimum, recycle
+struct AosBuilding {
+    glm::vec3 position;
+    float scale;
+    int type;
+};
+
+static void updateAosReference(std::vector<AosBuilding>& buildings, float movement, float spacing) {
+    for (auto& b : buildings) b.position.z += movement;
+
+    float minZ = buildings[0].position.z;
+    for (const auto& b : buildings) minZ = std::min(minZ, b.position.z);
+
+    for (auto& b : buildings) {
+        if (b.position.z > 5.0f) {
+            b.position.z = minZ - spacing;
+            minZ = b.position.z;
+        }
+    }
+}
+
+static void benchmarkStreetUpdate(int maxThreads) {
+    const int STEPS = 120;
+    const float STEP = 1.0f / 120.0f;
+    JobSystem::get().start(maxThreads - 1);
+
+    // Both columns do the same work: move every building and recycle the
+    // ones that passed the camera. SoA recycling is a head index bump, so its
+    // column is the parallel z update. Streaming, which the AoS layout never
+    // had, is timed on its own below.
+    std::cout << "Street update, " << STEPS << " steps at 120 Hz (" << maxThreads << " threads)" << std::endl;
+    std::cout << "  buildings   AoS ms/step   SoA ms/step   speedup   streamed update ms/step" << std::endl;
+    for (int count : { 10000, 100000, 1000000 }) {
+        // The city is streamed, so ask for a view distance that holds about count buildings
+        RunningSimulation simulation(15.0f, 12, count * 2.5f);
+        BuildingView city = simulation.getBuildings();
+        count = city.size();
+        std::vector<AosBuilding> aos(count);
+        for (int i = 0; i < count; i++) {
+            aos[i].position = glm::vec3((i % 2) ? 7.0f : -7.0f, 0.0f, -2.0f - (i / 2) * 4.0f);
+            aos[i].scale = 3.5f;
+            aos[i].type = i % 4;
+        }
+        std::vector<float> z(city.z, city.z + count);
+
+        double aosMs = medianMs(BENCH_REPEATS, [&]() {
+            for (int s = 0; s < STEPS; s++) updateAosReference(aos, 8.0f * STEP, 4.0f);
+        }) / STEPS;
+        double soaMs = medianMs(BENCH_REPEATS, [&]() {
+            for (int s = 0; s < STEPS; s++) {
+                float* values = z.data();
+                float movement = 8.0f * STEP;
+                JobSystem::get().parallelFor(count, 16384, [values, movement](int begin, int end) {
+                    addToAll(values + begin, end - begin, movement);
+                });
+            }
+        }) / STEPS;
+        // Moving plus generating chunks ahead and retiring the ones behind
+        double streamedMs = medianMs(BENCH_REPEATS, [&]() {
+            for (int s = 0; s < STEPS; s++) simulation.update(STEP, true);
+        }) / STEPS;
+
+        std::cout << std::fixed << std::setprecision(4)
+                  << "  " << std::setw(9) << count
+                  << "  " << std::setw(12) << aosMs
+                  << "  " << std::setw(12) << soaMs
+                  << "  " << std::setw(7) << std::setprecision(2) << (soaMs > 0.0 ? aosMs / soaMs : 0.0) << "x"
+                  << "  " << std::setw(23) << std::setprecision(4) << streamedMs
+                  << std::defaultfloat << std::endl;
+    }
+}
+
+static void printOperation(const char* name, int count, double ms) {
+    std::cout << std::fixed << std::setprecision(3)
+              << "  " << std::left << std::setw(22) << name << std::right
+              << std::setw(8) << count
+              << "  " << std::setw(10) << ms
+              << "  " << std::setw(10) << std::setprecision(1) << ms * 1e6 / count
+              << std::defaultfloat << std::endl;
+}
+
+static void benchmarkSpatialGrid() {
+    const int OBJECTS = 100000;
+    const int QUERIES = 10000;
+    const float AREA = 2000.0f;
+
+    // Buildings scattered over a 2 km square, about one per 40 m^2
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> coord(-AREA * 0.5f, AREA * 0.5f);
+    std::uniform_real_distribution<float> size(1.0f, 4.0f);
+    std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+    std::vector<glm::vec3> boxMin(OBJECTS), boxMax(OBJECTS), moved(OBJECTS);
+    for (int i = 0; i < OBJECTS; i++) {
+        glm::vec3 center(coord(random), 0.0f, coord(random));
+        glm::vec3 half(size(random), size(random) * 4.0f, size(random));
+        boxMin[i] = center - half;
+        boxMax[i] = center + half;
+        moved[i] = glm::vec3(jitter(random), 0.0f, jitter(random));
+    }
+    std::vector<glm::vec3> queryPoints(QUERIES), queryDirections(QUERIES);
+    for (int i = 0; i < QUERIES; i++) {
+        queryPoints[i] = glm::vec3(coord(random), 1.0f, coord(random));
+        float angle = coord(random);
+        queryDirections[i] = glm::vec3(cosf(angle), 0.0f, sinf(angle));
+    }
+
+    SpatialGrid grid;
+    std::vector<int> handles(OBJECTS);
+    std::vector<int> results;
+    size_t found = 0;
+
+    std::cout << "Spatial grid, " << OBJECTS / 1000 << "k objects (1 thread)" << std::endl;
+    std::cout << "  operation                count   median ms      ns/op" << std::endl;
+
+    printOperation("insert", OBJECTS, medianMs(BENCH_REPEATS, [&]() {
+        grid.clear();
+        for (int i = 0; i < OBJECTS; i++) handles[i] = grid.insert(boxMin[i], boxMax[i], i);
+    }));
+
+    // Half a meter back and forth; most moves stay within their cells
+    int direction = 1;
+    printOperation("move", OBJECTS, medianMs(BENCH_REPEATS, [&]() {
+        for (int i = 0; i < OBJECTS; i++) {
+            glm::vec3 offset = direction > 0 ? moved[i] : glm::vec3(0.0f);
+            grid.move(handles[i], boxMin[i] + offset, boxMax[i] + offset);
+        }
+        direction = -direction;
+    }));
+
+    printOperation("AABB query, 16 m", QUERIES, medianMs(BENCH_REPEATS, [&]() {
+        for (int i = 0; i < QUERIES; i++) {
+            results.clear();
+            grid.queryAabb(queryPoints[i] - glm::vec3(8.0f), queryPoints[i] + glm::vec3(8.0f), results);
+            found += results.size();
+        }
+    }));
+
+    printOperation("radius query, 20 m", QUERIES, medianMs(BENCH_REPEATS, [&]() {
+        for (int i = 0; i < QUERIES; i++) {
+            results.clear();
+            grid.queryRadius(queryPoints[i], 20.0f, results);
+            found += results.size();
+        }
+    }));
+
+    printOperation("raycast, 200 m", QUERIES, medianMs(BENCH_REPEATS, [&]() {
+        for (int i = 0; i < QUERIES; i++) {
+            int hit;
+            float distance;
+            if (grid.raycast(queryPoints[i], queryDirections[i], 200.0f, hit, distance)) found++;
+        }
+    }));
+
+    // The camera's projection reaches 350 m; the street only builds about 190 m ahead
+    const int FRUSTUMS = QUERIES / 10;
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 350.0f);
+    std::vector<glm::mat4> frustums(FRUSTUMS);
+    for (int i = 0; i < FRUSTUMS; i++) {
+        frustums[i] = projection * glm::lookAt(queryPoints[i], queryPoints[i] + queryDirections[i], glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+    printOperation("frustum query, 350 m", FRUSTUMS, medianMs(BENCH_REPEATS, [&]() {
+        for (int i = 0; i < FRUSTUMS; i++) {
+            results.clear();
+            grid.queryFrustum(frustums[i], results);
+            found += results.size();
+        }
+    }));
+    printOperation("frustum query, 190 m", FRUSTUMS, medianMs(BENCH_REPEATS, [&]() {
+        for (int i = 0; i < FRUSTUMS; i++) {
+            results.clear();
+            grid.queryFrustum(frustums[i], results, 190.0f);
+            found += results.size();
+        }
+    }));
+
+    // What every query would cost without the grid
+    const int SCANS = QUERIES / 100;
+    printOperation("AABB by linear scan", SCANS, medianMs(BENCH_REPEATS, [&]() {
+        for (int q = 0; q < SCANS; q++) {
+            glm::vec3 qMin = queryPoints[q] - glm::vec3(8.0f);
+            glm::vec3 qMax = queryPoints[q] + glm::vec3(8.0f);
+            for (int i = 0; i < OBJECTS; i++) {
+                if (boxMin[i].x <= qMax.x && boxMin[i].y <= qMax.y && boxMin[i].z <= qMax.z &&
+                    qMin.x <= boxMax[i].x && qMin.y <= boxMax[i].y && qMin.z <= boxMax[i].z) found++;
+            }
+        }
+    }));
+
+    printOperation("frustum by linear scan", SCANS, medianMs(BENCH_REPEATS, [&]() {
+        for (int q = 0; q < SCANS; q++) {
+            const glm::mat4& m = frustums[q];
+            glm::vec4 rowX(m[0][0], m[1][0], m[2][0], m[3][0]);
+            glm::vec4 rowY(m[0][1], m[1][1], m[2][1], m[3][1]);
+            glm::vec4 rowZ(m[0][2], m[1][2], m[2][2], m[3][2]);
+            glm::vec4 rowW(m[0][3], m[1][3], m[2][3], m[3][3]);
+            glm::vec4 planes[6] = { rowW + rowX, rowW - rowX, rowW + rowY, rowW - rowY, rowW + rowZ, rowW - rowZ };
+            for (int i = 0; i < OBJECTS; i++) {
+                bool inside = true;
+                for (const glm::vec4& plane : planes) {
+                    glm::vec3 p(plane.x >= 0.0f ? boxMax[i].x : boxMin[i].x,
+                                plane.y >= 0.0f ? boxMax[i].y : boxMin[i].y,
+                                plane.z >= 0.0f ? boxMax[i].z : boxMin[i].z);
+                    if (plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w < 0.0f) { inside = false; break; }
+                }
+                if (inside) found++;
+            }
+        }
+    }));
+
+    // Keeps the queries from being optimized away
+    if (found == 0) std::cout << "  (no results)" << std::endl;
+}
+
+// Stand-in for a model file that is not there: a sphere with bumps, CPU-only
+static Mesh createLumpySphere(int latSegments, int lonSegments) {
+    Mesh mesh;
+    for (int i = 0; i <= latSegments; i++) {
+        float theta = 3.14159265f * (float)i / (float)latSegments;
+        for (int j = 0; j <= lonSegments; j++) {
+            float phi = 2.0f * 3.14159265f * (float)j / (float)lonSegments;
+            float radius = 1.0f + 0.15f * sinf(theta * 7.0f) * cosf(phi * 5.0f);
+            Vertex v;
+            v.position = radius * glm::vec3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+            v.normal = glm::normalize(v.position);
+            v.texCoords = glm::vec2((float)j / (float)lonSegments, (float)i / (float)latSegments);
+            mesh.vertices.push_back(v);
+        }
+    }
+    for (int i = 0; i < latSegments; i++) {
+        for (int j = 0; j < lonSegments; j++) {
+            unsigned int a = i * (lonSegments + 1) + j;
+            unsigned int b = a + lonSegments + 1;
+            mesh.indices.insert(mesh.indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+        }
+    }
+    return mesh;
+}
+
+// Nearest hit by testing every triangle, the reference the hierarchy is measured against
+static bool intersectAll(const std::vector<glm::vec3>& corners, const glm::vec3& origin, const glm::vec3& direction, float& best) {
+    bool found = false;
+    for (size_t i = 0; i + 2 < corners.size(); i += 3) {
+        glm::vec3 e1 = corners[i + 1] - corners[i];
+        glm::vec3 e2 = corners[i + 2] - corners[i];
+        glm::vec3 p = glm::cross(direction, e2);
+        float det = glm::dot(e1, p);
+        if (fabsf(det) <= 1e-12f) continue;
+        float invDet = 1.0f / det;
+        glm::vec3 s = origin - corners[i];
+        float u = glm::dot(s, p) * invDet;
+        glm::vec3 q = glm::cross(s, e1);
+        float v = glm::dot(direction, q) * invDet;
+        float t = glm::dot(e2, q) * invDet;
+        if (u < 0.0f || v < 0.0f || u + v > 1.0f || t < 0.0f || t >= best) continue;
+        best = t;
+        found = true;
+    }
+    return found;
+}
+
+static void benchmarkPicking() {
+    const int RAYS = 10000;
+    const int BRUTE_RAYS = RAYS / 100;
+    const char* names[] = { "arm", "chonky building", "skyscraper", "tall building", "large building" };
+    const char* paths[] = {
+        "Resources/arm/arm.obj",
+        "Resources/ChonkyBuilding/chonky_buildingA.obj",
+        "Resources/Skyscraper/skyscraperE.obj",
+        "Resources/TallBuilding/tall_buildingC.obj",
+        "Resources/Large Building/large_buildingE.obj"
+    };
+
+    std::cout << "Ray picking, " << RAYS / 1000 << "k rays per mesh (1 thread)" << std::endl;
+    std::cout << "  operation                count   median ms      ns/op" << std::endl;
+
+    for (int m = 0; m < 5; m++) {
+        // CPU-only load, so no GL context is needed
+        std::vector<Mesh> meshes;
+        {
+            Model model(paths[m], false);
+            meshes = model.getMeshes();
+        }
+        bool procedural = meshes.empty();
+        if (procedural) meshes.push_back(createLumpySphere(128, 192));
+
+        TriangleBvh bvh;
+        double buildMs = medianMs(5, [&]() {
+            bvh.clear();
+            for (const Mesh& mesh : meshes) bvh.addMesh(mesh);
+            bvh.build();
+        });
+
+        std::vector<glm::vec3> corners;
+        for (const Mesh& mesh : meshes) {
+            for (unsigned int index : mesh.indices) corners.push_back(mesh.vertices[index].position);
+        }
+
+        // Rays from a shell around the mesh towards random points inside its bounds
+        glm::vec3 boundsMin = bvh.getBoundsMin(), boundsMax = bvh.getBoundsMax();
+        glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+        float radius = glm::length(boundsMax - boundsMin);
+        std::mt19937 random(99 + m);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::vector<glm::vec3> origins(RAYS), directions(RAYS);
+        for (int i = 0; i < RAYS; i++) {
+            glm::vec3 onSphere = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) - 0.5f + 1e-4f);
+            origins[i] = center + onSphere * radius;
+            glm::vec3 target = boundsMin + (boundsMax - boundsMin) * glm::vec3(unit(random), unit(random), unit(random));
+            directions[i] = glm::normalize(target - origins[i]);
+        }
+
+        int hits = 0;
+        double pickMs = medianMs(BENCH_REPEATS, [&]() {
+            hits = 0;
+            BvhHit hit;
+            for (int i = 0; i < RAYS; i++) {
+                if (bvh.intersect(origins[i], directions[i], radius * 4.0f, hit)) hits++;
+            }
+        });
+
+        // The hierarchy has to find the same nearest hit as the full loop
+        int mismatches = 0;
+        double bruteMs = medianMs(3, [&]() {
+            mismatches = 0;
+            BvhHit hit;
+            for (int i = 0; i < BRUTE_RAYS; i++) {
+                float best = radius * 4.0f;
+                bool found = intersectAll(corners, origins[i], directions[i], best);
+                bool bvhFound = bvh.intersect(origins[i], directions[i], radius * 4.0f, hit);
+                if (found != bvhFound || (found && fabsf(best - hit.distance) > 1e-4f * radius)) mismatches++;
+            }
+        });
+
+        std::cout << "  " << names[m] << (procedural ? " (procedural stand-in)" : "") << ": "
+                  << bvh.getTriangleCount() << " triangles, " << bvh.getNodeCount() << " nodes, "
+                  << hits * 100 / RAYS << "% of rays hit" << std::endl;
+        printOperation("build", bvh.getTriangleCount(), buildMs);
+        printOperation("pick", RAYS, pickMs);
+        printOperation("pick, every triangle", BRUTE_RAYS, bruteMs);
+        if (mismatches > 0) std::cout << "  " << mismatches << " rays disagree with the full loop" << std::endl;
+    }
+}
+
+static void benchmarkTransforms() {
+    const int COUNTS[] = { 10000, 100000 };
+
+    std::cout << "Instance transforms, model + normal matrix (1 thread, "
+              << getSimdLevelName(getSupportedSimdLevel()) << ")" << std::endl;
+    std::cout << "  operation                count   median ms      ns/op" << std::endl;
+
+    for (int count : COUNTS) {
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> coord(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::uniform_real_distribution<float> size(3.5f, 4.5f);
+        std::vector<float> px(count), py(count), pz(count), yaw(count), scale(count);
+        std::vector<float> qx(count), qy(count), qz(count), qw(count), sy(count), sz(count);
+        for (int i = 0; i < count; i++) {
+            px[i] = coord(random); py[i] = 0.0f; pz[i] = coord(random);
+            yaw[i] = unit(random) * 3.14159265f;
+            scale[i] = size(random); sy[i] = size(random); sz[i] = size(random);
+            glm::vec4 q = glm::normalize(glm::vec4(unit(random), unit(random), unit(random), unit(random)) + glm::vec4(0.0f, 0.0f, 0.0f, 1e-3f));
+            qx[i] = q.x; qy[i] = q.y; qz[i] = q.z; qw[i] = q.w;
+        }
+        std::vector<InstanceTransform> reference(count), batch(count);
+
+        // How Street built each building before: full 4x4 products, then the usual normal matrix
+        printOperation("glm, yaw + scale", count, medianMs(BENCH_REPEATS, [&]() {
+            for (int i = 0; i < count; i++) {
+                glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(px[i], py[i], pz[i]));
+                model = glm::rotate(model, yaw[i], glm::vec3(0.0f, 1.0f, 0.0f));
+                model = glm::scale(model, glm::vec3(scale[i]));
+                glm::mat3 normal = glm::transpose(glm::inverse(glm::mat3(model)));
+                reference[i].model = model;
+                for (int c = 0; c < 3; c++) reference[i].normal[c] = glm::vec4(normal[c], 0.0f);
+            }
+        }));
+        printOperation("batch, yaw + scale", count, medianMs(BENCH_REPEATS, [&]() {
+            composeYawTransforms(px.data(), py.data(), pz.data(), yaw.data(), scale.data(), count, batch.data());
+        }));
+
+        TrsArrays trs = { px.data(), py.data(), pz.data(), qx.data(), qy.data(), qz.data(), qw.data(),
+                          scale.data(), nullptr, nullptr };
+        printOperation("batch, quat uniform", count, medianMs(BENCH_REPEATS, [&]() {
+            composeTransforms(trs, count, batch.data());
+        }));
+        trs.scaleY = sy.data();
+        trs.scaleZ = sz.data();
+        printOperation("batch, quat, xyz scale", count, medianMs(BENCH_REPEATS, [&]() {
+            composeTransforms(trs, count, batch.data());
+        }));
+
+        // Every kernel width the CPU runs has to agree with glm. Model matrices
+        // only: normals match in direction, the batch skips the 1/scale. A
+        // quaternion about +y is the same yaw, so both entry points are checked.
+        std::vector<float> yawX(count, 0.0f), yawY(count), yawZ(count, 0.0f), yawW(count);
+        std::vector<glm::mat4> scaled(count);
+        for (int i = 0; i < count; i++) {
+            yawY[i] = sinf(yaw[i] * 0.5f);
+            yawW[i] = cosf(yaw[i] * 0.5f);
+            scaled[i] = glm::scale(glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(px[i], py[i], pz[i])), yaw[i], glm::vec3(0.0f, 1.0f, 0.0f)),
+                                   glm::vec3(scale[i], sy[i], sz[i]));
+        }
+        TrsArrays yawTrs = { px.data(), py.data(), pz.data(), yawX.data(), yawY.data(), yawZ.data(), yawW.data(),
+                             scale.data(), nullptr, nullptr };
+        for (int level = SIMD_SCALAR; level <= getSupportedSimdLevel(); level++) {
+            setSimdLevel((SimdLevel)level);
+            float error = 0.0f;
+            for (int path = 0; path < 3; path++) {
+                if (path == 0) composeYawTransforms(px.data(), py.data(), pz.data(), yaw.data(), scale.data(), count, batch.data());
+                yawTrs.scaleY = path == 2 ? sy.data() : nullptr;
+                yawTrs.scaleZ = path == 2 ? sz.data() : nullptr;
+                if (path > 0) composeTransforms(yawTrs, count, batch.data());
+                for (int i = 0; i < count; i++) {
+                    const glm::mat4& expected = path == 2 ? scaled[i] : reference[i].model;
+                    for (int c = 0; c < 4; c++) error = std::max(error, glm::length(expected[c] - batch[i].model[c]));
+                }
+            }
+            if (error > 1e-3f) std::cout << "  " << getSimdLevelName((SimdLevel)level) << " batch differs from glm by " << error << std::endl;
+        }
+        setSimdLevel(getSupportedSimdLevel());
+    }
+}
+
+static void benchmarkEcg() {
+    const int RATES[] = { 250, 1000 };
+    const int WATCHES = 64;
+    const double SIM_STEP = 1.0 / 120.0;
+
+    std::cout << "ECG synthesis, " << WATCHES << " watches, one second each (1 thread, "
+              << getSimdLevelName(getSupportedSimdLevel()) << ")" << std::endl;
+    std::cout << "  operation                count   median ms      ns/op" << std::endl;
+
+    for (int rate : RATES) {
+        int samples = WATCHES * rate;
+        std::vector<int> heartRates(WATCHES);
+        for (int w = 0; w < WATCHES; w++) heartRates[w] = 60 + w * 150 / WATCHES;
+        std::vector<float> reference(samples), batch(samples);
+
+        // Straightforward per-sample sum with std::exp as the baseline
+        printOperation("std::exp per sample", samples, medianMs(BENCH_REPEATS, [&]() {
+            for (int w = 0; w < WATCHES; w++) {
+                EcgWaveform wave = makeEcgWaveform(heartRates[w]);
+                float step = heartRates[w] / 60.0f / rate;
+                for (int i = 0; i < rate; i++) {
+                    float phase = i * step;
+                    phase -= std::floor(phase);
+                    float sum = 0.0f;
+                    for (int k = 0; k < EcgWaveform::WAVES; k++) {
+                        float d = phase - wave.center[k];
+                        d -= std::floor(d + 0.5f);
+                        sum += wave.amplitude[k] * std::exp(-d * d * wave.falloff[k] / 1.44269504f);
+                    }
+                    reference[w * rate + i] = sum;
+                }
+            }
+        }));
+        printOperation("batch", samples, medianMs(BENCH_REPEATS, [&]() {
+            for (int w = 0; w < WATCHES; w++) {
+                synthesizeEcg(makeEcgWaveform(heartRates[w]), 0.0f, heartRates[w] / 60.0f / rate, rate, batch.data() + w * rate);
+            }
+        }));
+
+        // The way the watch uses it: one advance per simulation step into its ring
+        std::vector<EcgSignal> signals(WATCHES);
+        for (EcgSignal& signal : signals) signal.setSampleRate(rate);
+        int steps = (int)(1.0 / SIM_STEP);
+        printOperation("ring, 120 Hz steps", samples, medianMs(BENCH_REPEATS, [&]() {
+            for (int w = 0; w < WATCHES; w++) {
+                for (int i = 0; i < steps; i++) signals[w].advance(SIM_STEP, heartRates[w]);
+            }
+        }));
+
+        // Every kernel width the CPU runs, not just the one timed
+        for (int level = SIMD_SCALAR; level <= getSupportedSimdLevel(); level++) {
+            setSimdLevel((SimdLevel)level);
+            for (int w = 0; w < WATCHES; w++) {
+                synthesizeEcg(makeEcgWaveform(heartRates[w]), 0.0f, heartRates[w] / 60.0f / rate, rate, batch.data() + w * rate);
+            }
+            float error = 0.0f;
+            for (int i = 0; i < samples; i++) error = std::max(error, std::fabs(reference[i] - batch[i]));
+            if (error > 1e-3f) {
+                std::cout << "  " << getSimdLevelName((SimdLevel)level) << " batch differs from std::exp by " << error << " mV" << std::endl;
+            }
+        }
+        setSimdLevel(getSupportedSimdLevel());
+    }
+}
+
+static void benchmarkTimeSeries() {
+    const int COUNTS[] = { 10800, 1000000 };   // three hours and eleven days at 1 Hz
+    const int COLUMNS = 240;
+
+    std::cout << "Heart-rate time series, " << COLUMNS << "-column graph (1 thread)" << std::endl;
+    std::cout << "  operation                count   median ms      ns/op" << std::endl;
+
+    for (int count : COUNTS) {
+        // A random walk around a resting rate, sampled once a second with some jitter
+        std::mt19937 random(11);
+        std::vector<TimeSeriesSample> samples(count);
+        int64_t time = 0;
+        int rate = 70;
+        for (int i = 0; i < count; i++) {
+            time += 1000 + (random() % 8 == 0 ? (int)(random() % 20) : 0);
+            rate = std::max(40, std::min(200, rate + (int)(random() % 3) - 1));
+            samples[i].time = time;
+            samples[i].value = rate;
+        }
+
+        TimeSeries series;
+        printOperation("append", count, medianMs(BENCH_REPEATS, [&]() {
+            series.clear();
+            for (const TimeSeriesSample& s : samples) series.append(s.time, s.value);
+        }));
+
+        std::vector<TimeSeriesSample> decoded;
+        printOperation("read everything", count, medianMs(BENCH_REPEATS, [&]() {
+            series.read(samples.front().time, samples.back().time + 1, decoded);
+        }));
+
+        // The graph the pyramid replaces: every sample visited per redraw
+        int64_t from = samples.front().time, to = samples.back().time + 1;
+        std::vector<TimeSeriesBucket> columns(COLUMNS), scanned(COLUMNS);
+        printOperation("graph, decode + scan", COLUMNS, medianMs(BENCH_REPEATS, [&]() {
+            series.read(from, to, decoded);
+            for (TimeSeriesBucket& c : scanned) c = TimeSeriesBucket{ INT32_MAX, INT32_MIN, 0.0f, 0 };
+            for (const TimeSeriesSample& s : decoded) {
+                TimeSeriesBucket& c = scanned[(int)((s.time - from) * COLUMNS / (to - from))];
+                c.min = std::min(c.min, s.value);
+                c.max = std::max(c.max, s.value);
+                c.count++;
+            }
+        }));
+        printOperation("graph, pyramid", COLUMNS, medianMs(BENCH_REPEATS, [&]() {
+            series.summarize(from, to, COLUMNS, columns.data());
+        }));
+
+        bool sameSamples = decoded.size() == samples.size();
+        for (size_t i = 0; sameSamples && i < decoded.size(); i++) {
+            sameSamples = decoded[i].time == samples[i].time && decoded[i].value == samples[i].value;
+        }
+        if (!sameSamples) std::cout << "  decoded samples differ from the input" << std::endl;
+        std::cout << "  " << count << " samples in " << series.getMemoryBytes() / 1024 << " KB, "
+                  << std::setprecision(2) << (double)series.getMemoryBytes() / count << " bytes each" << std::endl;
+    }
+}
+
+static void countTimer(void* data, int64_t) {
+    (*(int*)data)++;
+}
+
+static void benchmarkTimers() {
+    const int COUNTS[] = { 1000, 10000 };
+    const int FRAMES = 7500;          // a minute of 8 ms frames
+    const int64_t FRAME_MS = 8;
+
+    std::cout << "Periodic timers over " << FRAMES << " frames (1 thread)" << std::endl;
+    std::cout << "  operation                count   median ms      ns/op" << std::endl;
+
+    for (int count : COUNTS) {
+        // Periods from a tenth of a second to a minute, like watch features would use
+        std::mt19937 random(5);
+        std::vector<int64_t> periods(count), deadlines(count);
+        for (int i = 0; i < count; i++) periods[i] = 100 + (int64_t)(random() % 60000);
+
+        // What the watch did before: compare every timer's deadline every frame
+        int polled = 0;
+        printOperation("poll every timer", FRAMES, medianMs(BENCH_REPEATS, [&]() {
+            for (int i = 0; i < count; i++) deadlines[i] = periods[i];
+            for (int f = 1; f <= FRAMES; f++) {
+                int64_t now = f * FRAME_MS;
+                for (int i = 0; i < count; i++) {
+                    while (deadlines[i] <= now) {
+                        deadlines[i] += periods[i];
+                        polled++;
+                    }
+                }
+            }
+        }));
+
+        int fired = 0;
+        printOperation("timer wheel", FRAMES, medianMs(BENCH_REPEATS, [&]() {
+            TimerWheel wheel;
+            for (int i = 0; i < count; i++) wheel.schedulePeriodic(periods[i], periods[i], countTimer, &fired);
+            for (int f = 1; f <= FRAMES; f++) wheel.advance(f * FRAME_MS);
+        }));
+
+        // Same timers, all due in the second top-level slot: nothing fires or
+        // cascades down during the measured minute, so every frame is idle.
+        // The wheels are filled before timing; only advance is measured.
+        const int64_t IDLE_START = (int64_t)1 << (TimerWheel::SLOT_BITS * (TimerWheel::LEVELS - 1));
+        std::vector<TimerWheel> idleWheels(BENCH_REPEATS);
+        for (TimerWheel& wheel : idleWheels) {
+            for (int i = 0; i < count; i++) wheel.schedulePeriodic(IDLE_START + periods[i], periods[i], countTimer, &fired);
+        }
+        int idleRun = 0;
+        printOperation("timer wheel, idle", FRAMES, medianMs(BENCH_REPEATS, [&]() {
+            TimerWheel& wheel = idleWheels[idleRun++];
+            for (int f = 1; f <= FRAMES; f++) wheel.advance(f * FRAME_MS);
+        }));
+
+        if (fired / BENCH_REPEATS != polled / BENCH_REPEATS) {
+            std::cout << "  wheel ran " << fired / BENCH_REPEATS << " callbacks, polling " << polled / BENCH_REPEATS << std::endl;
+        }
+    }
+}
+
+int runBenchmarks(int maxThreads) {
+    if (maxThreads <= 0) maxThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    std::cout << "Benchmarks on up to " << maxThreads << " threads, median of " << BENCH_REPEATS << " runs" << std::endl;
+
+    benchmarkJobSystem(maxThreads);
+    benchmarkStreetUpdate(maxThreads);
+    benchmarkSpatialGrid();
+    benchmarkPicking();
+    benchmarkTransforms();
+    benchmarkEcg();
+    benchmarkTimeSeries();
+    benchmarkTimers();
+
+    JobSystem::get().stop();
+    return 0;
+}
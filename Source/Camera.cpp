@@ -12,11 +12,18 @@ Camera::Camera(glm::vec3 startPosition, float aspectRatio)
       farPlane(350.0f),
       bobbingOffset(0.0f),
       bobbingSpeed(8.0f),
-      bobbingAmount(0.08f) {
-    updateCameraVectors();
+      bobbingAmount(0.08f),
+      bobbingTime(0.0f),
+      prevPosition(startPosition),
+      prevBobbingOffset(0.0f),
+      renderPosition(startPosition),
+      block(),
+      vectorsDirty(true),
+      viewDirty(true),
+      projectionDirty(true) {
 }
 
-void Camera::updateCameraVectors() {
+void Camera::updateCameraVectors() const {
     glm::vec3 newFront;
     newFront.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
     newFront.y = sin(glm::radians(pitch));
@@ -25,29 +32,130 @@ void Camera::updateCameraVectors() {
     
     right = glm::normalize(glm::cross(front, worldUp));
     up = glm::normalize(glm::cross(right, front));
+    vectorsDirty = false;
 }
 
-glm::mat4 Camera::getViewMatrix() const {
-    glm::vec3 actualPosition = position + glm::vec3(0.0f, bobbingOffset, 0.0f);
-    return glm::lookAt(actualPosition, actualPosition + front, up);
+glm::vec3 Camera::getFront() const {
+    if (vectorsDirty) updateCameraVectors();
+    return front;
 }
 
-glm::mat4 Camera::getProjectionMatrix() const {
-    return glm::perspective(glm::radians(fov), aspectRatio, nearPlane, farPlane);
+glm::vec3 Camera::getUp() const {
+    if (vectorsDirty) updateCameraVectors();
+    return up;
+}
+
+glm::vec3 Camera::getRight() const {
+    if (vectorsDirty) updateCameraVectors();
+    return right;
+}
+
+void Camera::refresh() const {
+    if (!viewDirty && !projectionDirty) return;
+
+    if (viewDirty) {
+        if (vectorsDirty) updateCameraVectors();
+        block.view = glm::lookAt(renderPosition, renderPosition + front, up);
+        block.position = glm::vec4(renderPosition, 1.0f);
+    }
+    if (projectionDirty) {
+        block.projection = glm::perspective(glm::radians(fov), aspectRatio, nearPlane, farPlane);
+    }
+    viewDirty = projectionDirty = false;
+
+    block.viewProjection = block.projection * block.view;
+    block.inverseViewProjection = glm::inverse(block.viewProjection);
+
+    // Gribb-Hartmann: each plane is the last row plus or minus one of the others
+    const glm::mat4& m = block.viewProjection;
+    glm::vec4 rowX(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 rowY(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 rowZ(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 rowW(m[0][3], m[1][3], m[2][3], m[3][3]);
+    glm::vec4 planes[6] = { rowW + rowX, rowW - rowX, rowW + rowY, rowW - rowY, rowW + rowZ, rowW - rowZ };
+    for (int i = 0; i < 6; i++) {
+        block.frustumPlanes[i] = planes[i] / glm::length(glm::vec3(planes[i]));
+    }
+}
+
+const glm::mat4& Camera::getViewMatrix() const {
+    refresh();
+    return block.view;
+}
+
+const glm::mat4& Camera::getProjectionMatrix() const {
+    refresh();
+    return block.projection;
+}
+
+const glm::mat4& Camera::getViewProjectionMatrix() const {
+    refresh();
+    return block.viewProjection;
+}
+
+const glm::mat4& Camera::getInverseViewProjectionMatrix() const {
+    refresh();
+    return block.inverseViewProjection;
+}
+
+const glm::vec4* Camera::getFrustumPlanes() const {
+    refresh();
+    return block.frustumPlanes;
+}
+
+const CameraBlock& Camera::getCameraBlock() const {
+    refresh();
+    return block;
+}
+
+void Camera::getPickRay(float x, float y, int width, int height, glm::vec3& origin, glm::vec3& direction) const {
+    const glm::mat4& inverseViewProj = getInverseViewProjectionMatrix();
+    float ndcX = 2.0f * x / (float)width - 1.0f;
+    float ndcY = 1.0f - 2.0f * y / (float)height;
+
+    glm::vec4 nearPoint = inverseViewProj * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverseViewProj * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+    origin = glm::vec3(nearPoint) / nearPoint.w;
+    direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+}
+
+void Camera::setRenderPosition(const glm::vec3& value) {
+    if (value.x == renderPosition.x && value.y == renderPosition.y && value.z == renderPosition.z) return;
+    renderPosition = value;
+    viewDirty = true;
+}
+
+void Camera::setAspectRatio(float ratio) {
+    if (ratio == aspectRatio) return;
+    aspectRatio = ratio;
+    projectionDirty = true;
+}
+
+void Camera::beginStep() {
+    prevPosition = position;
+    prevBobbingOffset = bobbingOffset;
+}
+
+void Camera::setRenderAlpha(float alpha) {
+    float bob = prevBobbingOffset + (bobbingOffset - prevBobbingOffset) * alpha;
+    setRenderPosition(prevPosition + (position - prevPosition) * alpha + glm::vec3(0.0f, bob, 0.0f));
 }
 
 void Camera::moveVertical(float offset) {
     position.y += offset;
     if (position.y < 1.3f) position.y = 1.3f;
     if (position.y > 1.8f) position.y = 1.8f;
+    // Mouse input is applied between steps and shows up immediately
+    prevPosition.y = position.y;
+    setRenderPosition(glm::vec3(renderPosition.x, position.y + bobbingOffset, renderPosition.z));
 }
 
 void Camera::moveForward(float speed) {
-    position += front * speed;
+    position += getFront() * speed;
 }
 
 void Camera::moveRight(float speed) {
-    position += right * speed;
+    position += getRight() * speed;
 }
 
 void Camera::moveUp(float speed) {
@@ -68,16 +176,18 @@ void Camera::rotate(float xoffset, float yoffset) {
         yaw  += 180.0f;
     }
 
-    updateCameraVectors();
+    // Trig waits until the vectors are next needed, usually once per frame
+    vectorsDirty = true;
+    viewDirty = true;
 }
 
 void Camera::updateBobbing(double deltaTime, bool isRunning) {
     if (isRunning) {
-        static float bobbingTime = 0.0f;
         bobbingTime += deltaTime * bobbingSpeed;
         bobbingOffset = sin(bobbingTime) * bobbingAmount;
     } else {
-        bobbingOffset *= 0.95f;
+        // Same decay as the old 0.95 per frame at 75 FPS, independent of step size
+        bobbingOffset *= powf(0.95f, (float)deltaTime * 75.0f);
         if (fabs(bobbingOffset) < 0.001f) {
             bobbingOffset = 0.0f;
         }
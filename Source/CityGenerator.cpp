@@ -0,0 +1,119 @@
+#include "../Header/CityGenerator.h"
+#include <algorithm>
+
+// Layout of one side of the street
+const float BUILDING_SETBACK = 3.0f;       // from the road edge to the building center
+const float BUILDING_SETBACK_JITTER = 1.5f;
+const float BUILDING_SPACING = 4.0f;
+const float BUILDING_SPACING_JITTER = 2.0f;
+const float BUILDING_MARGIN = 2.0f;        // kept free at chunk edges and around side streets
+const float SIDE_STREET_CHANCE = 0.35f;
+const float SIDE_STREET_WIDTH = 8.0f;
+const float MAX_ROTATION_JITTER = 0.1f;
+
+void BuildingArrays::clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    scale.clear();
+    rotation.clear();
+    type.clear();
+}
+
+void BuildingArrays::append(const BuildingArrays& other, float zOffset) {
+    x.insert(x.end(), other.x.begin(), other.x.end());
+    y.insert(y.end(), other.y.begin(), other.y.end());
+    size_t first = z.size();
+    z.insert(z.end(), other.z.begin(), other.z.end());
+    for (size_t i = first; i < z.size(); i++) z[i] += zOffset;
+    scale.insert(scale.end(), other.scale.begin(), other.scale.end());
+    rotation.insert(rotation.end(), other.rotation.begin(), other.rotation.end());
+    type.insert(type.end(), other.type.begin(), other.type.end());
+}
+
+void BuildingArrays::eraseFront(int count) {
+    x.erase(x.begin(), x.begin() + count);
+    y.erase(y.begin(), y.begin() + count);
+    z.erase(z.begin(), z.begin() + count);
+    scale.erase(scale.begin(), scale.begin() + count);
+    rotation.erase(rotation.begin(), rotation.begin() + count);
+    type.erase(type.begin(), type.begin() + count);
+}
+
+BuildingView BuildingArrays::view(int first) const {
+    BuildingView v;
+    v.x = x.data() + first;
+    v.y = y.data() + first;
+    v.z = z.data() + first;
+    v.scale = scale.data() + first;
+    v.rotation = rotation.data() + first;
+    v.type = type.data() + first;
+    v.count = size() - first;
+    return v;
+}
+
+// splitmix64; every chunk gets its own stream so neighbours are unrelated
+struct ChunkRandom {
+    uint64_t state;
+
+    ChunkRandom(uint32_t seed, int64_t index)
+        : state(((uint64_t)seed << 32) ^ ((uint64_t)index * 0x9E3779B97F4A7C15ull)) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    // [0, 1)
+    float uniform() { return (float)(next() >> 40) / (float)(1 << 24); }
+    int range(int count) { return (int)(next() % (uint64_t)count); }
+};
+
+CityGenerator::CityGenerator(uint32_t seed, float roadHalfWidth)
+    : seed(seed), roadHalfWidth(roadHalfWidth) {
+}
+
+void CityGenerator::generate(int64_t index, CityChunk& out) const {
+    out.index = index;
+    out.buildings.clear();
+    out.sideStreets.clear();
+
+    ChunkRandom random(seed, index);
+
+    // At most one side street per chunk, never across a chunk edge
+    float gapStart = 0.0f, gapEnd = 0.0f;
+    int gapSide = 2;
+    if (random.uniform() < SIDE_STREET_CHANCE) {
+        float halfGap = SIDE_STREET_WIDTH * 0.5f + BUILDING_MARGIN;
+        float center = halfGap + random.uniform() * (CITY_CHUNK_LENGTH - 2.0f * halfGap);
+        gapSide = random.range(3) - 1;
+        gapStart = center - halfGap;
+        gapEnd = center + halfGap;
+        out.sideStreets.push_back({ -center, gapSide });
+    }
+
+    for (int side = -1; side <= 1; side += 2) {
+        bool hasGap = gapSide == 0 || gapSide == side;
+        float along = BUILDING_MARGIN + random.uniform() * BUILDING_SPACING_JITTER;
+        while (along < CITY_CHUNK_LENGTH - BUILDING_MARGIN) {
+            if (hasGap && along > gapStart && along < gapEnd) {
+                along = gapEnd;
+                continue;
+            }
+
+            float setback = BUILDING_SETBACK + random.uniform() * BUILDING_SETBACK_JITTER;
+            // Facing either way along the street, slightly off axis
+            float rotation = random.range(2) * 3.14159265f + (random.uniform() * 2.0f - 1.0f) * MAX_ROTATION_JITTER;
+
+            out.buildings.x.push_back(side * (roadHalfWidth + setback));
+            out.buildings.y.push_back(0.0f);
+            out.buildings.z.push_back(-along);
+            out.buildings.scale.push_back(3.5f + random.uniform());
+            out.buildings.rotation.push_back(rotation);
+            out.buildings.type.push_back(random.range(4));
+
+            along += BUILDING_SPACING + random.uniform() * BUILDING_SPACING_JITTER;
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#include "../Header/CpuFeatures.h"
+#if defined(_MSC_VER) && defined(SIMD_HAS_AVX2)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+static SimdLevel detectSimdLevel() {
+#if defined(SIMD_HAS_AVX2)
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return SIMD_SSE2;
+
+    // AVX also needs the OS to save the upper register halves: OSXSAVE set
+    // and XCR0 enabling both SSE and AVX state
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return SIMD_SSE2;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) ? SIMD_AVX2 : SIMD_SSE2;
+#else
+    // Checks the OS support for the AVX state too
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? SIMD_AVX2 : SIMD_SSE2;
+#endif
+#elif defined(__SSE2__)
+    return SIMD_SSE2;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+static SimdLevel& currentSimdLevel() {
+    static SimdLevel level = getSupportedSimdLevel();
+    return level;
+}
+
+SimdLevel getSupportedSimdLevel() {
+    static const SimdLevel supported = detectSimdLevel();
+    return supported;
+}
+
+SimdLevel getSimdLevel() {
+    return currentSimdLevel();
+}
+
+void setSimdLevel(SimdLevel level) {
+    SimdLevel supported = getSupportedSimdLevel();
+    currentSimdLevel() = level < supported ? level : supported;
+}
+
+const char* getSimdLevelName(SimdLevel level) {
+    switch (level) {
+    case SIMD_AVX2: return "AVX2";
+    case SIMD_SSE2: return "SSE2";
+    default: return "scalar";
+    }
+}
@@ -1,15 +1,18 @@
 #include "../Header/DigitRenderer.h"
+#include "../Header/RenderStats.h"
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <string>
 #include <iostream>
 
-DigitRenderer::DigitRenderer() : VAO(0), VBO(0) {}
+DigitRenderer::DigitRenderer() : VAO(0), VBO(0), batching(false), batchVAO(0), batchVBO(0) {}
 
 DigitRenderer::~DigitRenderer() {
     if (VAO) glDeleteVertexArrays(1, &VAO);
     if (VBO) glDeleteBuffers(1, &VBO);
+    if (batchVAO) glDeleteVertexArrays(1, &batchVAO);
+    if (batchVBO) glDeleteBuffers(1, &batchVBO);
 }
 
 void DigitRenderer::init() {
@@ -33,6 +36,30 @@ void DigitRenderer::init() {
 }
 
 void DigitRenderer::drawSegment(float x, float y, float w, float h, const glm::vec3& color, unsigned int shader, const glm::mat4& parentModel) {
+    if (batching) {
+        Batch* batch = nullptr;
+        for (auto& b : batches) {
+            if (b.color == color) { batch = &b; break; }
+        }
+        if (!batch) {
+            batches.push_back({ color, {} });
+            batch = &batches.back();
+        }
+
+        // Same quad as the VBO below, transformed on the CPU
+        glm::vec3 p00 = glm::vec3(parentModel * glm::vec4(x, y, 0.02f, 1.0f));
+        glm::vec3 p10 = glm::vec3(parentModel * glm::vec4(x + w, y, 0.02f, 1.0f));
+        glm::vec3 p11 = glm::vec3(parentModel * glm::vec4(x + w, y + h, 0.02f, 1.0f));
+        glm::vec3 p01 = glm::vec3(parentModel * glm::vec4(x, y + h, 0.02f, 1.0f));
+        const glm::vec3 corners[6] = { p00, p10, p11, p00, p11, p01 };
+        for (const auto& c : corners) {
+            batch->vertices.push_back(c.x);
+            batch->vertices.push_back(c.y);
+            batch->vertices.push_back(c.z);
+        }
+        return;
+    }
+
     if (VAO == 0) init();
 
     glm::mat4 model = parentModel;
@@ -47,6 +74,62 @@ void DigitRenderer::drawSegment(float x, float y, float w, float h, const glm::v
     glBindVertexArray(VAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
     glBindVertexArray(0);
+    RenderStats::get().countUniforms(4);
+    RenderStats::get().countDraw(2);
+}
+
+void DigitRenderer::drawRect(float x, float y, float w, float h, const glm::vec3& color, unsigned int shader, const glm::mat4& parentModel) {
+    drawSegment(x, y, w, h, color, shader, parentModel);
+}
+
+void DigitRenderer::beginBatch() {
+    batching = true;
+    // Colours are reused every frame, so keep their vertex storage around
+    if (batches.size() > 32) batches.clear();
+    for (auto& b : batches) b.vertices.clear();
+}
+
+void DigitRenderer::flushBatch(unsigned int shader) {
+    batching = false;
+
+    uploadBuffer.clear();
+    for (const auto& b : batches) uploadBuffer.insert(uploadBuffer.end(), b.vertices.begin(), b.vertices.end());
+    if (uploadBuffer.empty()) return;
+
+    if (batchVAO == 0) {
+        glGenVertexArrays(1, &batchVAO);
+        glGenBuffers(1, &batchVBO);
+        glBindVertexArray(batchVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, batchVBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+    }
+
+    // Orphan the previous contents so the driver never waits on last frame's draw
+    glBindVertexArray(batchVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, batchVBO);
+    glBufferData(GL_ARRAY_BUFFER, uploadBuffer.size() * sizeof(float), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, uploadBuffer.size() * sizeof(float), uploadBuffer.data());
+
+    glm::mat4 identity(1.0f);
+    glUniformMatrix4fv(glGetUniformLocation(shader, "uM"), 1, GL_FALSE, glm::value_ptr(identity));
+    glUniform1i(glGetUniformLocation(shader, "uUseTexture"), 0);
+    RenderStats::get().countUniforms(2);
+
+    GLint uKD = glGetUniformLocation(shader, "uMaterial.kD");
+    GLint uKA = glGetUniformLocation(shader, "uMaterial.kA");
+    int first = 0;
+    for (const auto& b : batches) {
+        int count = (int)b.vertices.size() / 3;
+        if (count == 0) continue;
+        glUniform3fv(uKD, 1, glm::value_ptr(b.color));
+        glUniform3fv(uKA, 1, glm::value_ptr(b.color));
+        glDrawArrays(GL_TRIANGLES, first, count);
+        RenderStats::get().countUniforms(2);
+        RenderStats::get().countDraw(count / 3);
+        first += count;
+    }
+    glBindVertexArray(0);
 }
 
 void DigitRenderer::drawDigit(int digit, float x, float y, float scale, const glm::vec3& color, unsigned int shader, const glm::mat4& parentModel) {
@@ -161,6 +244,9 @@ void DigitRenderer::drawChar(char c, float x, float y, float scale, const glm::v
         case 'Z': s[0]=1; s[1]=1; s[3]=1; s[4]=1; s[6]=1; break;
         case '-': s[6]=1; break;
         case '_': s[3]=1; break;
+        case '.':
+            drawSegment(x + w / 2.0f - t / 2.0f, y, t, t, color, shader, parentModel);
+            return;
         case ' ': break;
         case ':':
             drawColon(x, y, scale, color, shader, parentModel);
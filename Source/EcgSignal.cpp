@@ -0,0 +1,232 @@
+#include "../Header/EcgSignal.h"
+#include "../Header/CpuFeatures.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#define ECG_SSE2 1
+#endif
+#ifdef SIMD_HAS_AVX2
+#include <immintrin.h>
+#define ECG_AVX2 1
+#endif
+#if defined(ECG_AVX2) && defined(__GNUC__) && !defined(__AVX__)
+// Same as in TransformBatch.cpp: synthesizeBlock<AvxOps> is only inlined
+// into the AVX2 loop, never called across the ABI it warns about
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+const int MIN_SAMPLE_RATE = 250;
+const int MAX_SAMPLE_RATE = 1000;
+
+// Where the R peak sits in the beat phase; everything else is placed around it
+const float R_PHASE = 0.3f;
+const float LOG2_E = 1.44269504f;
+
+// Samples are evaluated a block of lanes at a time, like the transform
+// kernels. Waves are 2^(-k d^2); the vector exp2 splits off the integer part
+// into the exponent bits and covers the rest with a polynomial.
+namespace {
+
+struct ScalarOps {
+    typedef float V;
+    static const int WIDTH = 1;
+    static V set1(float v) { return v; }
+    static V ramp() { return 0.0f; }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    static V mul(V a, V b) { return a * b; }
+    static V floor(V a) { return std::floor(a); }
+    static V exp2(V a) { return std::exp2(a); }
+    static void store(float* p, V a) { *p = a; }
+};
+
+#ifdef ECG_SSE2
+struct SseOps {
+    typedef __m128 V;
+    static const int WIDTH = 4;
+    static V set1(float v) { return _mm_set1_ps(v); }
+    static V ramp() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    // SSE2 only truncates; step down where that rounded a negative value up
+    static V floor(V a) {
+        V t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+        return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.0f)));
+    }
+    static V exp2(V a) {
+        a = _mm_max_ps(a, _mm_set1_ps(-126.0f));
+        V n = floor(_mm_add_ps(a, _mm_set1_ps(0.5f)));
+        V f = _mm_sub_ps(a, n);
+        V p = _mm_set1_ps(1.3333558e-3f);
+        p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(9.6181291e-3f));
+        p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(5.5504109e-2f));
+        p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(2.4022651e-1f));
+        p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(6.9314718e-1f));
+        p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+        __m128i bits = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23);
+        return _mm_mul_ps(p, _mm_castsi128_ps(bits));
+    }
+    static void store(float* p, V a) { _mm_storeu_ps(p, a); }
+};
+#endif
+
+#ifdef ECG_AVX2
+struct AvxOps {
+    typedef __m256 V;
+    static const int WIDTH = 8;
+    AVX2_TARGET static V set1(float v) { return _mm256_set1_ps(v); }
+    AVX2_TARGET static V ramp() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+    AVX2_TARGET static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    AVX2_TARGET static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    AVX2_TARGET static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    AVX2_TARGET static V floor(V a) { return _mm256_floor_ps(a); }
+    AVX2_TARGET static V exp2(V a) {
+        a = _mm256_max_ps(a, _mm256_set1_ps(-126.0f));
+        V n = _mm256_floor_ps(_mm256_add_ps(a, _mm256_set1_ps(0.5f)));
+        V f = _mm256_sub_ps(a, n);
+        V p = _mm256_set1_ps(1.3333558e-3f);
+        p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(9.6181291e-3f));
+        p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(5.5504109e-2f));
+        p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(2.4022651e-1f));
+        p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(6.9314718e-1f));
+        p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(1.0f));
+        __m256i bits = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(n), _mm256_set1_epi32(127)), 23);
+        return _mm256_mul_ps(p, _mm256_castsi256_ps(bits));
+    }
+    AVX2_TARGET static void store(float* p, V a) { _mm256_storeu_ps(p, a); }
+};
+#endif
+
+} // namespace
+
+template<typename Ops>
+static SIMD_INLINE void synthesizeBlock(const EcgWaveform& wave, float phase, float phaseStep, float* out) {
+    typedef typename Ops::V V;
+    V half = Ops::set1(0.5f);
+    V p = Ops::add(Ops::set1(phase), Ops::mul(Ops::ramp(), Ops::set1(phaseStep)));
+    p = Ops::sub(p, Ops::floor(p));
+
+    V sum = Ops::set1(0.0f);
+    for (int w = 0; w < EcgWaveform::WAVES; w++) {
+        // Distance to the wave's center, wrapped so a T wave can run into the next P
+        V d = Ops::sub(p, Ops::set1(wave.center[w]));
+        d = Ops::sub(d, Ops::floor(Ops::add(d, half)));
+        V e = Ops::exp2(Ops::mul(Ops::mul(d, d), Ops::set1(-wave.falloff[w])));
+        sum = Ops::add(sum, Ops::mul(e, Ops::set1(wave.amplitude[w])));
+    }
+    Ops::store(out, sum);
+}
+
+EcgWaveform makeEcgWaveform(int heartRate) {
+    // Seconds from the R peak and widths in seconds at 60 bpm
+    const float OFFSET[EcgWaveform::WAVES]    = { -0.16f, -0.03f, 0.0f, 0.03f, 0.28f };
+    const float WIDTH[EcgWaveform::WAVES]     = { 0.025f, 0.010f, 0.011f, 0.011f, 0.06f };
+    const float AMPLITUDE[EcgWaveform::WAVES] = { 0.15f, -0.12f, 1.1f, -0.25f, 0.3f };
+    const bool SCALES[EcgWaveform::WAVES]     = { true, false, false, false, true };
+
+    float interval = 60.0f / (float)std::max(30, std::min(250, heartRate));
+    float stretch = std::sqrt(interval);
+
+    EcgWaveform wave;
+    for (int w = 0; w < EcgWaveform::WAVES; w++) {
+        float s = SCALES[w] ? stretch : 1.0f;
+        float center = R_PHASE + OFFSET[w] * s / interval;
+        float width = WIDTH[w] * s / interval;
+        wave.center[w] = center - std::floor(center);
+        wave.falloff[w] = LOG2_E / (2.0f * width * width);
+        wave.amplitude[w] = AMPLITUDE[w];
+    }
+    return wave;
+}
+
+#ifdef ECG_AVX2
+// Whole blocks of eight; returns how many samples were done
+AVX2_TARGET static int synthesizeEcgAvx2(const EcgWaveform& wave, float phase, float phaseStep, int count, float* out) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) synthesizeBlock<AvxOps>(wave, phase + i * phaseStep, phaseStep, out + i);
+    return i;
+}
+#endif
+
+float synthesizeEcg(const EcgWaveform& wave, float phase, float phaseStep, int count, float* out) {
+    int i = 0;
+    SimdLevel level = getSimdLevel();
+#ifdef ECG_AVX2
+    if (level >= SIMD_AVX2) i = synthesizeEcgAvx2(wave, phase, phaseStep, count, out);
+#endif
+#ifdef ECG_SSE2
+    if (level >= SIMD_SSE2) {
+        for (; i + 4 <= count; i += 4) synthesizeBlock<SseOps>(wave, phase + i * phaseStep, phaseStep, out + i);
+    }
+#endif
+    for (; i < count; i++) synthesizeBlock<ScalarOps>(wave, phase + i * phaseStep, phaseStep, out + i);
+
+    float next = phase + count * phaseStep;
+    return next - std::floor(next);
+}
+
+EcgSignal::EcgSignal()
+    : written(0),
+      generated(0),
+      sampleRate(500),
+      pendingSamples(0.0),
+      phase(0.0f),
+      waveHeartRate(-1) {
+    memset(ring, 0, sizeof(ring));
+}
+
+void EcgSignal::setSampleRate(int hz) {
+    sampleRate = std::max(MIN_SAMPLE_RATE, std::min(MAX_SAMPLE_RATE, hz));
+}
+
+void EcgSignal::advance(double deltaTime, int heartRate) {
+    pendingSamples += deltaTime * sampleRate;
+    int count = (int)pendingSamples;
+    pendingSamples -= count;
+    if (count <= 0) return;
+    if (count > MAX_BATCH) count = MAX_BATCH;
+
+    // Only this thread stores to written, so a relaxed load sees the latest value
+    uint64_t end = written.load(std::memory_order_relaxed) + count;
+    if (generated < end) {
+        if (heartRate != waveHeartRate) {
+            wave = makeEcgWaveform(heartRate);
+            waveHeartRate = heartRate;
+        }
+        float phaseStep = (float)heartRate / 60.0f / (float)sampleRate;
+
+        // Whole blocks, so the kernels never fall back to single samples.
+        // Blocks start on multiples of BLOCK and never straddle the ring's end.
+        int needed = (int)((end - generated + BLOCK - 1) / BLOCK) * BLOCK;
+        int offset = (int)(generated & (CAPACITY - 1));
+        int first = std::min(needed, CAPACITY - offset);
+        phase = synthesizeEcg(wave, phase, phaseStep, first, ring + offset);
+        if (needed > first) phase = synthesizeEcg(wave, phase, phaseStep, needed - first, ring);
+        generated += needed;
+    }
+
+    written.store(end, std::memory_order_release);
+}
+
+int EcgSignal::copyWindow(uint64_t end, int count, float* out) const {
+    count = (int)std::min<uint64_t>(std::min(count, CAPACITY - MAX_BATCH - BLOCK), end);
+    if (count <= 0) return 0;
+
+    uint64_t begin = end - count;
+    int offset = (int)(begin & (CAPACITY - 1));
+    int first = std::min(count, CAPACITY - offset);
+    memcpy(out, ring + offset, first * sizeof(float));
+    memcpy(out + first, ring, (count - first) * sizeof(float));
+
+    // The writer may be filling up to MAX_BATCH + BLOCK slots past what it
+    // published; if any of those could be ours, the copy is suspect
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t latest = written.load(std::memory_order_relaxed);
+    if (latest + MAX_BATCH + BLOCK > begin + CAPACITY) return 0;
+    return count;
+}
@@ -0,0 +1,143 @@
+#include "../Header/FramePacer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifndef _WIN32
+#include <cerrno>
+#include <time.h>
+#endif
+
+// Below this much remaining time the pacer spins instead of sleeping
+const double SPIN_THRESHOLD = 0.0002;
+const int JITTER_HISTORY = 600;
+
+FramePacer::FramePacer()
+    : period(0.0),
+      latencyTarget(-1.0),
+      vsync(VSYNC_OFF),
+      nextDeadline(0.0),
+      lastPresent(0.0),
+      overshootEstimate(0.0005),
+      intervals(JITTER_HISTORY, 0.0f),
+      intervalHead(0),
+      intervalCount(0) {
+}
+
+double FramePacer::now() {
+#ifndef _WIN32
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void FramePacer::setPeriod(double seconds) {
+    period = seconds;
+    nextDeadline = 0.0;
+}
+
+void FramePacer::sleepUntil(double deadline) {
+    while (true) {
+        double remaining = deadline - now();
+        if (remaining <= 0.0) return;
+
+        if (remaining > SPIN_THRESHOLD + overshootEstimate) {
+            // Wake early by the expected overshoot and learn from the actual wake time
+            double wakeAt = deadline - SPIN_THRESHOLD - overshootEstimate;
+#ifndef _WIN32
+            timespec ts;
+            ts.tv_sec = (time_t)wakeAt;
+            ts.tv_nsec = (long)((wakeAt - (double)ts.tv_sec) * 1e9);
+            // Returns the error number; only an interrupted sleep is retried
+            int error;
+            while ((error = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr)) == EINTR) {}
+            if (error != 0) {
+                while (now() < deadline) std::this_thread::yield();
+                return;
+            }
+#else
+            std::this_thread::sleep_for(std::chrono::duration<double>(wakeAt - now()));
+#endif
+            double overshoot = std::max(0.0, now() - wakeAt);
+            overshootEstimate = std::min(0.9 * overshootEstimate + 0.1 * overshoot, 0.004);
+        } else {
+            while (now() < deadline) {
+#if defined(_M_X64) || defined(__SSE2__)
+                _mm_pause();
+#endif
+            }
+            return;
+        }
+    }
+}
+
+void FramePacer::waitForFrameStart() {
+    if (period <= 0.0) return;
+
+    double t = now();
+    if (nextDeadline == 0.0) nextDeadline = t + period;
+
+    // Default latency target is a whole period: start right after the last deadline
+    double latency = latencyTarget < 0.0 ? period : std::min(latencyTarget, period);
+    double start = nextDeadline - latency;
+    if (start > t) sleepUntil(start);
+}
+
+void FramePacer::endFrame() {
+    double t = now();
+    if (lastPresent > 0.0) {
+        intervals[intervalHead] = (float)(t - lastPresent);
+        intervalHead = (intervalHead + 1) % JITTER_HISTORY;
+        intervalCount = std::min(intervalCount + 1, JITTER_HISTORY);
+    }
+    lastPresent = t;
+
+    if (period <= 0.0) return;
+
+    if (vsync != VSYNC_OFF) {
+        // SwapBuffers returned at the vblank, the next one is a period away
+        nextDeadline = t + period;
+    } else {
+        nextDeadline += period;
+        // Missed by more than a frame: drop the lost time instead of rushing to catch up
+        if (nextDeadline < t) nextDeadline = t + period;
+    }
+}
+
+double FramePacer::getJitterStdDev() const {
+    if (intervalCount < 2) return 0.0;
+    double sum = 0.0, sumSq = 0.0;
+    for (int i = 0; i < intervalCount; i++) {
+        sum += intervals[i];
+        sumSq += (double)intervals[i] * intervals[i];
+    }
+    double mean = sum / intervalCount;
+    return std::sqrt(std::max(0.0, sumSq / intervalCount - mean * mean));
+}
+
+double FramePacer::getMaxDeviation() const {
+    if (intervalCount == 0) return 0.0;
+    double sum = 0.0;
+    for (int i = 0; i < intervalCount; i++) sum += intervals[i];
+    double expected = period > 0.0 ? period : sum / intervalCount;
+
+    double maxDeviation = 0.0;
+    for (int i = 0; i < intervalCount; i++) maxDeviation = std::max(maxDeviation, std::fabs(intervals[i] - expected));
+    return maxDeviation;
+}
+
+void FramePacer::printStats() const {
+    std::cout << "Frame pacing: period " << period * 1000.0 << " ms, jitter stddev "
+              << getJitterStdDev() * 1000.0 << " ms, max deviation " << getMaxDeviation() * 1000.0
+              << " ms, sleep overshoot " << overshootEstimate * 1000.0 << " ms ("
+              << intervalCount << " frames)" << std::endl;
+}
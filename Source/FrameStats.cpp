@@ -0,0 +1,41 @@
+#include "../Header/FrameStats.h"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    // Nearest-rank on the sorted samples
+    size_t rank = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+FrameStats::Summary FrameStats::summarize() const {
+    Summary s = { 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    if (samples.empty()) return s;
+
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (double v : sorted) sum += v;
+
+    s.count = (int)sorted.size();
+    s.mean = sum / sorted.size();
+    s.min = sorted.front();
+    s.max = sorted.back();
+    s.p50 = percentile(sorted, 0.50);
+    s.p95 = percentile(sorted, 0.95);
+    s.p99 = percentile(sorted, 0.99);
+    return s;
+}
+
+void FrameStats::print(const char* label) const {
+    Summary s = summarize();
+    std::cout << std::fixed << std::setprecision(3)
+              << label << ": " << s.count << " frames"
+              << "  mean " << s.mean << " ms"
+              << "  p50 " << s.p50 << "  p95 " << s.p95 << "  p99 " << s.p99
+              << "  min " << s.min << "  max " << s.max
+              << "  (" << std::setprecision(1) << (s.mean > 0.0 ? 1000.0 / s.mean : 0.0) << " fps)"
+              << std::defaultfloat << std::endl;
+}
@@ -1,39 +1,45 @@
 #include "../Header/Hand.h"
+#include "../Header/Profiler.h"
 #include <glm/gtc/matrix_transform.hpp>
 
 Hand::Hand()
-    : armModel(nullptr),
-      skinKD(0.85f, 0.72f, 0.62f),
+    : skinKD(0.85f, 0.72f, 0.62f),
       skinKA(0.4f, 0.32f, 0.28f),
       skinKS(0.25f, 0.22f, 0.2f),
       skinShine(12.0f),
       armOffset(0.0f, 0.0f, 0.3f),
       armRotation(0.0f, 0.1f, 1.0f),
-      armScale(0.02f) {
+      armScale(0.02f),
+      renderAlpha(1.0f),
+      handNode(-1), armNode(-1),
+      nodePosition(0.0f), nodeRotation(-1.0f) {
 }
 
 Hand::~Hand() {
-    delete armModel;
 }
 
-void Hand::init(const char* armModelPath) {
-    armModel = new Model(armModelPath);
+void Hand::init(ResourceManager& resources, const char* armModelPath) {
+    armModel = resources.acquireModel(armModelPath);
+    if (armModel.valid()) {
+        armBvh.addModel(*armModel.model());
+        armBvh.build();
+    }
 }
 
 void Hand::update(double deltaTime, const glm::vec3& cameraPos) {
+    PROFILE_SCOPE("Hand::update");
     controller.update(deltaTime, cameraPos);
 }
 
-void Hand::render(const ShaderUniforms& uniforms) const {
-    if (!armModel) return;
+void Hand::render(const ShaderUniforms& uniforms, const std::vector<glm::mat4>& transforms) const {
+    PROFILE_SCOPE("Hand::render");
+    if (!armModel.valid() || armNode < 0 || armNode >= (int)transforms.size()) return;
 
-    glm::mat4 armTransform = getArmTransformMatrix();
-
-    uniforms.setModelMatrix(armTransform);
+    uniforms.setModelMatrix(transforms[armNode]);
     uniforms.setMaterial(skinKD, skinKA, skinKS, skinShine);
     uniforms.setTexture(false);
 
-    armModel->draw();
+    armModel.model()->draw();
 }
 
 void Hand::toggleViewingMode() {
@@ -48,15 +54,37 @@ bool Hand::isInTransition() const {
     return controller.isInTransition();
 }
 
+void Hand::beginStep() {
+    controller.beginStep();
+}
+
 glm::mat4 Hand::getTransformMatrix() const {
+    return controller.getInterpolatedTransformMatrix(renderAlpha);
+}
+
+glm::mat4 Hand::getStateTransformMatrix() const {
     return controller.getTransformMatrix();
 }
 
-glm::mat4 Hand::getArmTransformMatrix() const {
-    glm::mat4 handM = controller.getTransformMatrix();
-    glm::mat4 armTransform = handM;
-    armTransform = glm::translate(armTransform, armOffset);
-    armTransform = glm::rotate(armTransform, glm::radians(180.0f), armRotation);
-    armTransform = glm::scale(armTransform, glm::vec3(armScale));
-    return armTransform;
+void Hand::attachTransforms(TransformHierarchy& transforms) {
+    handNode = transforms.addNode(-1);
+    nodeRotation = -1.0f;
+
+    // The arm never moves relative to the hand
+    glm::mat4 armLocal = glm::translate(glm::mat4(1.0f), armOffset);
+    armLocal = glm::rotate(armLocal, glm::radians(180.0f), armRotation);
+    armLocal = glm::scale(armLocal, glm::vec3(armScale));
+    armNode = transforms.addNode(handNode, armLocal);
+}
+
+void Hand::updateTransforms(TransformHierarchy& transforms) {
+    glm::vec3 position;
+    float rotation;
+    controller.getInterpolatedPose(renderAlpha, position, rotation);
+    if (position.x == nodePosition.x && position.y == nodePosition.y && position.z == nodePosition.z &&
+        rotation == nodeRotation) return;
+
+    nodePosition = position;
+    nodeRotation = rotation;
+    transforms.setLocal(handNode, HandController::buildTransform(position, rotation));
 }
@@ -10,7 +10,14 @@ HandController::HandController()
       cameraPosition(0.0f),
       transitionProgress(0.0f),
       transitionSpeed(3.0f),           
-      isTransitioning(false) {
+      isTransitioning(false),
+      prevPosition(normalOffset),
+      prevRotation(0.0f) {
+}
+
+void HandController::beginStep() {
+    prevPosition = getPosition();
+    prevRotation = getRotationAmount();
 }
 
 void HandController::update(double deltaTime, const glm::vec3& camPos) {
@@ -49,22 +56,36 @@ void HandController::toggleState() {
     transitionProgress = 0.0f;
 }
 
-glm::mat4 HandController::getTransformMatrix() const {
+float HandController::getRotationAmount() const {
+    if (isTransitioning && targetState == HAND_STATE_VIEWING) return transitionProgress;
+    if (isTransitioning && targetState == HAND_STATE_NORMAL) return 1.0f - transitionProgress;
+    return currentState == HAND_STATE_VIEWING ? 1.0f : 0.0f;
+}
+
+glm::mat4 HandController::buildTransform(const glm::vec3& position, float t) {
     glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, cameraPosition + currentOffset);
+    model = glm::translate(model, position);
 
-    if (currentState == HAND_STATE_VIEWING || isTransitioning) {
-        float t = 0.0f;
-        if (isTransitioning && targetState == HAND_STATE_VIEWING) {
-            t = transitionProgress;
-        } else if (isTransitioning && targetState == HAND_STATE_NORMAL) {
-            t = 1.0f - transitionProgress;
-        } else if (currentState == HAND_STATE_VIEWING) {
-            t = 1.0f;
-        }
+    if (t > 0.0f) {
         model = glm::rotate(model, t * glm::radians(90.0f),  glm::vec3(0.0f, 1.0f, 0.0f));
         model = glm::rotate(model, t * glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
     }
 
     return model;
 }
+
+glm::mat4 HandController::getTransformMatrix() const {
+    return buildTransform(getPosition(), getRotationAmount());
+}
+
+glm::mat4 HandController::getInterpolatedTransformMatrix(float alpha) const {
+    glm::vec3 position;
+    float rotation;
+    getInterpolatedPose(alpha, position, rotation);
+    return buildTransform(position, rotation);
+}
+
+void HandController::getInterpolatedPose(float alpha, glm::vec3& position, float& rotation) const {
+    position = prevPosition + (getPosition() - prevPosition) * alpha;
+    rotation = prevRotation + (getRotationAmount() - prevRotation) * alpha;
+}
@@ -0,0 +1,162 @@
+#include "../Header/InputLog.h"
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+static const char INPUT_LOG_MAGIC[4] = { 'S', 'W', 'I', 'N' };
+static const uint32_t INPUT_LOG_VERSION = 2;
+static const uint8_t RECORD_FRAME = 0;
+
+InputLogWriter::InputLogWriter() : file(nullptr), frameCount(0) {
+}
+
+InputLogWriter::~InputLogWriter() {
+    close();
+}
+
+bool InputLogWriter::open(const char* path, const InputLogHeader& header) {
+    close();
+    file = fopen(path, "wb");
+    if (!file) {
+        std::cout << "Failed to open input log for writing: " << path << std::endl;
+        return false;
+    }
+
+    frameCount = 0;
+    put(INPUT_LOG_MAGIC, 4);
+    put(&INPUT_LOG_VERSION, sizeof(INPUT_LOG_VERSION));
+    put(&header, sizeof(header));
+    return true;
+}
+
+void InputLogWriter::close() {
+    if (!file) return;
+    flush();
+    fclose(file);
+    file = nullptr;
+}
+
+void InputLogWriter::put(const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+void InputLogWriter::flush() {
+    if (!buffer.empty()) fwrite(buffer.data(), 1, buffer.size(), file);
+    buffer.clear();
+}
+
+void InputLogWriter::addFrame(double deltaTime, uint8_t heldKeys) {
+    if (!file) return;
+    put(&RECORD_FRAME, 1);
+    put(&deltaTime, sizeof(deltaTime));
+    put(&heldKeys, 1);
+    frameCount++;
+
+    // Keep the log mostly on disk if the app dies mid-run
+    if (buffer.size() > 64 * 1024) flush();
+}
+
+void InputLogWriter::addKey(int key, int action, int mods) {
+    if (!file) return;
+    uint8_t type = INPUT_EVENT_KEY;
+    int16_t code = (int16_t)key;
+    uint8_t packed[2] = { (uint8_t)action, (uint8_t)mods };
+    put(&type, 1);
+    put(&code, sizeof(code));
+    put(packed, 2);
+}
+
+void InputLogWriter::addCursor(double x, double y) {
+    if (!file) return;
+    uint8_t type = INPUT_EVENT_CURSOR;
+    put(&type, 1);
+    put(&x, sizeof(x));
+    put(&y, sizeof(y));
+}
+
+void InputLogWriter::addButton(int button, int action, int mods, double x, double y) {
+    if (!file) return;
+    uint8_t type = INPUT_EVENT_BUTTON;
+    uint8_t packed[3] = { (uint8_t)button, (uint8_t)action, (uint8_t)mods };
+    put(&type, 1);
+    put(packed, 3);
+    put(&x, sizeof(x));
+    put(&y, sizeof(y));
+}
+
+InputLogReader::InputLogReader() : cursor(0) {
+    memset(&header, 0, sizeof(header));
+}
+
+bool InputLogReader::get(void* data, size_t size) {
+    if (cursor + size > file.size()) return false;
+    memcpy(data, file.data() + cursor, size);
+    cursor += size;
+    return true;
+}
+
+bool InputLogReader::open(const char* path) {
+    if (!file.open(path)) {
+        std::cout << "Failed to open input log: " << path << std::endl;
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version = 0;
+    cursor = 0;
+    bool valid = get(magic, 4) && memcmp(magic, INPUT_LOG_MAGIC, 4) == 0 &&
+                 get(&version, sizeof(version)) && (version == 1 || version == INPUT_LOG_VERSION);
+    if (valid) {
+        memset(&header, 0, sizeof(header));
+        valid = get(&header, version == 1 ? offsetof(InputLogHeader, screen) : sizeof(header));
+    }
+    if (!valid) {
+        std::cout << "Not a valid input log: " << path << std::endl;
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+bool InputLogReader::nextFrame(InputFrame& out) {
+    out.events.clear();
+
+    uint8_t type;
+    if (!get(&type, 1) || type != RECORD_FRAME) return false;
+    if (!get(&out.deltaTime, sizeof(out.deltaTime)) || !get(&out.heldKeys, 1)) return false;
+
+    // Events run until the next frame record
+    while (cursor < file.size() && file.data()[cursor] != RECORD_FRAME) {
+        get(&type, 1);
+        InputEvent e = {};
+        e.type = (InputEventType)type;
+
+        bool ok = true;
+        if (type == INPUT_EVENT_KEY) {
+            int16_t code;
+            uint8_t packed[2];
+            ok = get(&code, sizeof(code)) && get(packed, 2);
+            e.code = code;
+            e.action = packed[0];
+            e.mods = packed[1];
+        } else if (type == INPUT_EVENT_CURSOR) {
+            ok = get(&e.x, sizeof(e.x)) && get(&e.y, sizeof(e.y));
+        } else if (type == INPUT_EVENT_BUTTON) {
+            uint8_t packed[3];
+            ok = get(packed, 3) && get(&e.x, sizeof(e.x)) && get(&e.y, sizeof(e.y));
+            e.code = packed[0];
+            e.action = packed[1];
+            e.mods = packed[2];
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            std::cout << "Corrupt input log record at byte " << cursor << std::endl;
+            return false;
+        }
+        out.events.push_back(e);
+    }
+    return true;
+}
@@ -0,0 +1,313 @@
+#include "../Header/JobSystem.h"
+#include "../Header/Profiler.h"
+#include <algorithm>
+
+// Queue owned by the current thread, -1 until it first submits
+static thread_local int t_queueIndex = -1;
+
+bool JobSystem::WorkQueue::push(const Job& job) {
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= CAPACITY) return false;
+
+    Slot& slot = slots[b & (CAPACITY - 1)];
+    slot.function.store(job.function, std::memory_order_relaxed);
+    slot.data.store(job.data, std::memory_order_relaxed);
+    slot.begin.store(job.begin, std::memory_order_relaxed);
+    slot.end.store(job.end, std::memory_order_relaxed);
+    slot.counter.store(job.counter, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+bool JobSystem::WorkQueue::pop(Job& out) {
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    Slot& slot = slots[b & (CAPACITY - 1)];
+    out.function = slot.function.load(std::memory_order_relaxed);
+    out.data = slot.data.load(std::memory_order_relaxed);
+    out.begin = slot.begin.load(std::memory_order_relaxed);
+    out.end = slot.end.load(std::memory_order_relaxed);
+    out.counter = slot.counter.load(std::memory_order_relaxed);
+
+    // Last item: race thieves for it
+    bool taken = true;
+    if (t == b) {
+        taken = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return taken;
+}
+
+bool JobSystem::WorkQueue::steal(Job& out) {
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b) return false;
+
+    Slot& slot = slots[t & (CAPACITY - 1)];
+    out.function = slot.function.load(std::memory_order_relaxed);
+    out.data = slot.data.load(std::memory_order_relaxed);
+    out.begin = slot.begin.load(std::memory_order_relaxed);
+    out.end = slot.end.load(std::memory_order_relaxed);
+    out.counter = slot.counter.load(std::memory_order_relaxed);
+    return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+JobSystem& JobSystem::get() {
+    static JobSystem system;
+    return system;
+}
+
+JobSystem::JobSystem()
+    : externalCount(0),
+      workerCount(0),
+      running(false),
+      wakeSignal(0),
+      continuationCount(0),
+      backgroundCount(0) {
+    for (int i = 0; i < MAX_QUEUES; i++) queues[i].store(nullptr, std::memory_order_relaxed);
+}
+
+JobSystem::~JobSystem() {
+    stop();
+    for (int i = 0; i < MAX_QUEUES; i++) delete queues[i].load(std::memory_order_relaxed);
+}
+
+void JobSystem::start(int count) {
+    stop();
+    if (count < 0) count = (int)std::thread::hardware_concurrency() - 1;
+    workerCount = std::max(0, std::min(count, (int)MAX_WORKERS));
+
+    // Queues are kept across restarts, thieves may still hold a pointer
+    t_queueIndex = 0;
+    for (int i = 0; i <= workerCount; i++) {
+        if (!queues[i].load(std::memory_order_relaxed)) queues[i].store(new WorkQueue(), std::memory_order_release);
+    }
+
+    running.store(true, std::memory_order_release);
+    for (int i = 1; i <= workerCount; i++) {
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+    if (workerCount == 0) backgroundWorker = std::thread(&JobSystem::backgroundLoop, this);
+}
+
+void JobSystem::stop() {
+    if (!running.load(std::memory_order_acquire)) {
+        workerCount = 0;
+        return;
+    }
+
+    running.store(false, std::memory_order_release);
+    wakeSignal.fetch_add(1, std::memory_order_release);
+    wakeSignal.notify_all();
+    for (auto& worker : workers) worker.join();
+    workers.clear();
+    if (backgroundWorker.joinable()) backgroundWorker.join();
+    workerCount = 0;
+
+    // Background jobs nobody got to still have counters waiting on them
+    Job job;
+    while (findBackgroundJob(job)) execute(job);
+}
+
+int JobSystem::getQueueIndex() {
+    if (t_queueIndex >= 0) return t_queueIndex;
+
+    int external = externalCount.fetch_add(1, std::memory_order_relaxed);
+    if (external >= MAX_EXTERNAL) return -1;
+
+    int index = 1 + MAX_WORKERS + external;
+    queues[index].store(new WorkQueue(), std::memory_order_release);
+    t_queueIndex = index;
+    return index;
+}
+
+void JobSystem::submit(const Job& job) {
+    // Without workers, or with a full queue, the caller just runs the job
+    int index = workerCount > 0 ? getQueueIndex() : -1;
+    if (index < 0 || !queues[index].load(std::memory_order_relaxed)->push(job)) {
+        execute(job);
+        return;
+    }
+    wakeSignal.fetch_add(1, std::memory_order_release);
+    wakeSignal.notify_one();
+}
+
+void JobSystem::run(JobFunction function, void* data, int begin, int end, JobCounter* counter) {
+    if (counter) counter->pending.fetch_add(1, std::memory_order_relaxed);
+    submit({ function, data, begin, end, counter });
+}
+
+void JobSystem::runBackground(JobFunction function, void* data, int begin, int end, JobCounter* counter) {
+    if (counter) counter->pending.fetch_add(1, std::memory_order_relaxed);
+    Job job = { function, data, begin, end, counter };
+    if (!running.load(std::memory_order_acquire)) {
+        execute(job);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(backgroundMutex);
+        backgroundJobs.push_back(job);
+        backgroundCount.fetch_add(1, std::memory_order_release);
+    }
+    wakeSignal.fetch_add(1, std::memory_order_release);
+    wakeSignal.notify_one();
+}
+
+void JobSystem::runAfter(JobCounter& dependency, JobFunction function, void* data, int begin, int end, JobCounter* counter) {
+    if (counter) counter->pending.fetch_add(1, std::memory_order_relaxed);
+    Job job = { function, data, begin, end, counter };
+
+    // Announce the continuation before looking at the dependency; finish()
+    // decrements before looking at continuationCount. One of the two always
+    // sees the other, so the job is either queued here or picked up there.
+    continuationCount.fetch_add(1, std::memory_order_seq_cst);
+    {
+        std::lock_guard<std::mutex> lock(continuationMutex);
+        if (dependency.pending.load(std::memory_order_seq_cst) != 0) {
+            continuations.push_back({ &dependency, job });
+            return;
+        }
+    }
+    continuationCount.fetch_sub(1, std::memory_order_relaxed);
+    submit(job);
+}
+
+void JobSystem::parallelFor(int count, int grain, JobFunction function, void* data, JobCounter& counter) {
+    if (count <= 0) return;
+
+    // A few ranges per thread is enough for stealing to even out the load
+    int maxRanges = getThreadCount() * 4;
+    grain = std::max(grain, (count + maxRanges - 1) / maxRanges);
+    int ranges = (count + grain - 1) / grain;
+    counter.pending.fetch_add(ranges, std::memory_order_relaxed);
+
+    int index = workerCount > 0 ? getQueueIndex() : -1;
+    WorkQueue* queue = index >= 0 ? queues[index].load(std::memory_order_relaxed) : nullptr;
+    for (int begin = 0; begin < count; begin += grain) {
+        Job job = { function, data, begin, std::min(begin + grain, count), &counter };
+        if (!queue || !queue->push(job)) execute(job);
+    }
+    wakeSignal.fetch_add(1, std::memory_order_release);
+    wakeSignal.notify_all();
+}
+
+bool JobSystem::findJob(int self, Job& out) {
+    if (self >= 0) {
+        WorkQueue* own = queues[self].load(std::memory_order_relaxed);
+        if (own && own->pop(out)) return true;
+    }
+
+    // Start at a different victim per thread so thieves spread out
+    int start = self >= 0 ? self + 1 : 0;
+    for (int i = 0; i < MAX_QUEUES; i++) {
+        int victim = (start + i) % MAX_QUEUES;
+        if (victim == self) continue;
+        WorkQueue* queue = queues[victim].load(std::memory_order_acquire);
+        if (queue && queue->steal(out)) return true;
+    }
+    return false;
+}
+
+bool JobSystem::findBackgroundJob(Job& out) {
+    if (backgroundCount.load(std::memory_order_acquire) == 0) return false;
+    std::lock_guard<std::mutex> lock(backgroundMutex);
+    if (backgroundJobs.empty()) return false;
+    out = backgroundJobs.front();
+    backgroundJobs.pop_front();
+    backgroundCount.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+void JobSystem::execute(const Job& job) {
+    job.function(job.data, job.begin, job.end);
+    if (job.counter) finish(job.counter);
+}
+
+void JobSystem::finish(JobCounter* counter) {
+    if (counter->pending.fetch_sub(1, std::memory_order_seq_cst) != 1) return;
+    if (continuationCount.load(std::memory_order_seq_cst) == 0) return;
+
+    // The counter may be gone once it reached zero; it is only compared here
+    std::vector<Job> ready;
+    {
+        std::lock_guard<std::mutex> lock(continuationMutex);
+        for (size_t i = 0; i < continuations.size(); ) {
+            if (continuations[i].dependency == counter) {
+                ready.push_back(continuations[i].job);
+                continuations[i] = continuations.back();
+                continuations.pop_back();
+                continuationCount.fetch_sub(1, std::memory_order_relaxed);
+            } else {
+                i++;
+            }
+        }
+    }
+    for (const auto& job : ready) submit(job);
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    int self = getQueueIndex();
+    int idle = 0;
+    while (!counter.isDone()) {
+        Job job;
+        if (findJob(self, job)) {
+            execute(job);
+            idle = 0;
+        } else if (++idle > 64) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::workerLoop(int index) {
+    Profiler::get().setThreadName("Job worker");
+    t_queueIndex = index;
+
+    int idle = 0;
+    while (running.load(std::memory_order_acquire)) {
+        Job job;
+        if (findJob(index, job) || findBackgroundJob(job)) {
+            execute(job);
+            idle = 0;
+            continue;
+        }
+        if (++idle < 64) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Read the signal before the final check so a push in between wakes us
+        uint32_t signal = wakeSignal.load(std::memory_order_acquire);
+        if (findJob(index, job) || findBackgroundJob(job)) {
+            execute(job);
+            idle = 0;
+            continue;
+        }
+        wakeSignal.wait(signal, std::memory_order_acquire);
+    }
+}
+
+void JobSystem::backgroundLoop() {
+    Profiler::get().setThreadName("Background jobs");
+
+    while (running.load(std::memory_order_acquire)) {
+        // Read the signal before looking so a job queued in between wakes us
+        uint32_t signal = wakeSignal.load(std::memory_order_acquire);
+        Job job;
+        if (findBackgroundJob(job)) {
+            execute(job);
+            continue;
+        }
+        wakeSignal.wait(signal, std::memory_order_acquire);
+    }
+}
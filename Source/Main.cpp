@@ -5,8 +5,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
-#include <thread>
+#include <iomanip>
 #include <chrono>
+#include <random>
 
 #include "../Header/Util.h"
 #include "../Header/Camera.h"
@@ -16,10 +17,22 @@
 #include "../Header/Hand.h"
 #include "../Header/Watch.h"
 #include "../Header/DigitRenderer.h"
-
-// FPS limiting
-const int TARGET_FPS = 75;
-const double TARGET_FRAME_TIME = 1.0 / TARGET_FPS;
+#include "../Header/ResourceManager.h"
+#include "../Header/AppOptions.h"
+#include "../Header/FrameStats.h"
+#include "../Header/OffscreenTarget.h"
+#include "../Header/InputLog.h"
+#include "../Header/Profiler.h"
+#include "../Header/RenderStats.h"
+#include "../Header/PerformanceHud.h"
+#include "../Header/FramePacer.h"
+#include "../Header/SimulationThread.h"
+#include "../Header/JobSystem.h"
+#include "../Header/Benchmarks.h"
+#include "../Header/PickScene.h"
+#include "../Header/TransformHierarchy.h"
+#include "../Header/SensorLog.h"
+#include "../Header/ShaderManager.h"
 
 // Window dimensions
 int g_width = 1200, g_height = 800;
@@ -31,30 +44,76 @@ Watch* g_watch = nullptr;
 Sun* g_sun = nullptr;
 Street* g_street = nullptr;
 DigitRenderer* g_digitRenderer = nullptr;
+PerformanceHud* g_hud = nullptr;
+ResourceManager* g_resources = nullptr;
 ShaderUniforms g_uniforms;
 
-// Input state
+// Hand -> arm, hand -> watch -> screen -> widgets; updated once per frame
+TransformHierarchy g_transforms;
+
+// Simulation state; owned by the simulation thread while it runs
 double g_lastMouseX = 0.0, g_lastMouseY = 0.0;
 bool g_firstMouse = true;
 bool g_isRunning = false;
 bool g_freeCameraMode = false;
+double g_simTime = 0.0, g_simAccumulator = 0.0;
+
+// Events polled this frame, handed to the simulation with the next frame
+std::vector<InputEvent> g_pendingEvents;
+
+// Input log (record or replay, never both)
+InputLogWriter* g_inputRecorder = nullptr;
+InputLogReader* g_inputReplay = nullptr;
+
+// Recorded workout driving the watch sensors, if one was given
+SensorLog* g_sensorLog = nullptr;
+
+// Builds and caches shader programs, relinking edited ones with --shader-dev
+ShaderManager* g_shaders = nullptr;
+
+// Movement keys are polled every frame and packed into one byte for the log
+const int HELD_KEYS[] = { GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_Q, GLFW_KEY_E };
+const int HELD_KEY_COUNT = 6;
+
+// The simulation advances in fixed steps and rendering blends the last two.
+// A long hitch drops time instead of running a burst of catch-up steps.
+const double SIM_STEP = 1.0 / 120.0;
+const int MAX_SIM_STEPS = 8;
 
 // Cursor
 GLFWcursor* g_heartCursor = nullptr;
 
-// Arrow position
-glm::vec2 g_leftArrowScreenPos(0.0f);
-glm::vec2 g_rightArrowScreenPos(0.0f);
-const float ARROW_CLICK_RADIUS = 50.0f;
+// Watch light parameters
+const glm::vec3 WATCH_LIGHT_AMBIENT(0.005f, 0.005f, 0.008f);
+const glm::vec3 WATCH_LIGHT_DIFFUSE(0.03f, 0.04f, 0.05f);
+const glm::vec3 WATCH_LIGHT_SPECULAR(0.02f, 0.02f, 0.03f);
+
+// Object ids in the pick scene; buildings follow from PICK_BUILDINGS on
+const int PICK_ARM = 0;
+const int PICK_WATCH_SCREEN = 1;
+const int PICK_BUILDINGS = 16;
+PickScene g_pickScene;
+
+uint8_t pollHeldKeys(GLFWwindow* window) {
+    uint8_t mask = 0;
+    for (int i = 0; i < HELD_KEY_COUNT; i++) {
+        if (glfwGetKey(window, HELD_KEYS[i]) == GLFW_PRESS) mask |= (uint8_t)(1 << i);
+    }
+    return mask;
+}
 
-glm::vec2 projectToScreen(const glm::vec3& worldPos, const glm::mat4& view, const glm::mat4& proj) {
-    glm::vec4 clipPos = proj * view * glm::vec4(worldPos, 1.0f);
-    if (clipPos.w <= 0.0f) return glm::vec2(-1000.0f);
-    glm::vec3 ndc = glm::vec3(clipPos) / clipPos.w;
-    return glm::vec2((ndc.x + 1.0f) * 0.5f * g_width, (1.0f - ndc.y) * 0.5f * g_height);
+uint8_t heldKeyMask(int key) {
+    for (int i = 0; i < HELD_KEY_COUNT; i++) {
+        if (HELD_KEYS[i] == key) return (uint8_t)(1 << i);
+    }
+    return 0;
 }
 
-void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
+bool isKeyHeld(uint8_t heldKeys, int key) {
+    return (heldKeys & heldKeyMask(key)) != 0;
+}
+
+void handleCursor(double xpos, double ypos) {
     if (g_hand && g_hand->isInViewingMode() && !g_freeCameraMode) return;
 
     if (g_firstMouse) {
@@ -78,23 +137,32 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
     }
 }
 
-void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
-    if (!g_hand || !g_hand->isInViewingMode() || !g_watch) return;
+void handleMouseButton(int button, int action, double xpos, double ypos) {
+    if (!g_hand || !g_hand->isInViewingMode() || !g_watch || !g_street) return;
 
     if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
-        double xpos, ypos;
-        glfwGetCursorPos(window, &xpos, &ypos);
-        glm::vec2 mousePos((float)xpos, (float)ypos);
-
-        if (glm::length(mousePos - g_leftArrowScreenPos) < ARROW_CLICK_RADIUS) {
+        // Pick against what was on screen: the transforms of the last snapshot
+        g_pickScene.clear();
+        g_pickScene.add(PICK_WATCH_SCREEN, &g_watch->getScreenBvh(), g_transforms.getWorld(g_watch->getScreenNode()));
+        g_pickScene.add(PICK_ARM, &g_hand->getArmBvh(), g_transforms.getWorld(g_hand->getArmNode()));
+        g_street->addPickTargets(g_pickScene, PICK_BUILDINGS);
+
+        glm::vec3 origin, direction;
+        g_camera->getPickRay((float)xpos, (float)ypos, g_width, g_height, origin, direction);
+        PickHit hit;
+        if (!g_pickScene.pick(origin, direction, hit) || hit.object != PICK_WATCH_SCREEN) return;
+
+        WatchWidget widget = g_watch->widgetAt(hit.uv);
+        if (widget == WATCH_WIDGET_PREV_ARROW) {
             g_watch->prevScreen();
-        } else if (glm::length(mousePos - g_rightArrowScreenPos) < ARROW_CLICK_RADIUS) {
+        } else if (widget == WATCH_WIDGET_NEXT_ARROW) {
             g_watch->nextScreen();
         }
     }
 }
 
-void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+// Keys that change the simulation, handled on the simulation thread
+void handleKey(int key, int action) {
     if (key == GLFW_KEY_SPACE && action == GLFW_PRESS && g_hand) {
         g_hand->toggleViewingMode();
         g_firstMouse = true;
@@ -103,11 +171,125 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
         g_freeCameraMode = !g_freeCameraMode;
         g_firstMouse = true;
     }
+}
+
+// Keys for the application itself, handled on the GL thread
+void handleAppKey(GLFWwindow* window, int key, int action) {
+    if (key == GLFW_KEY_F2 && action == GLFW_PRESS && g_resources) {
+        g_resources->printSnapshot();
+    }
+    if (key == GLFW_KEY_H && action == GLFW_PRESS && g_hud) {
+        g_hud->toggle();
+    }
+    if (key == GLFW_KEY_F3 && action == GLFW_PRESS) {
+        Profiler::get().exportChromeTrace("trace.json");
+    }
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, true);
     }
 }
 
+// Live input is ignored while replaying, apart from Escape to stop early
+void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
+    if (g_inputReplay) return;
+    if (g_inputRecorder) g_inputRecorder->addCursor(xpos, ypos);
+    g_pendingEvents.push_back({ INPUT_EVENT_CURSOR, 0, 0, 0, xpos, ypos });
+}
+
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+    if (g_inputReplay) return;
+    double xpos, ypos;
+    glfwGetCursorPos(window, &xpos, &ypos);
+    if (g_inputRecorder) g_inputRecorder->addButton(button, action, mods, xpos, ypos);
+    g_pendingEvents.push_back({ INPUT_EVENT_BUTTON, button, action, mods, xpos, ypos });
+}
+
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    if (g_inputReplay) {
+        if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) glfwSetWindowShouldClose(window, true);
+        return;
+    }
+    if (g_inputRecorder) g_inputRecorder->addKey(key, action, mods);
+    handleAppKey(window, key, action);
+    g_pendingEvents.push_back({ INPUT_EVENT_KEY, key, action, mods, 0.0, 0.0 });
+}
+
+// Replayed events take the same path as live ones
+void queueReplayEvents(GLFWwindow* window, const std::vector<InputEvent>& events) {
+    for (const auto& e : events) {
+        if (e.type == INPUT_EVENT_KEY) handleAppKey(window, e.code, e.action);
+        g_pendingEvents.push_back(e);
+    }
+}
+
+void applyInputEvents(const std::vector<InputEvent>& events) {
+    for (const auto& e : events) {
+        if (e.type == INPUT_EVENT_KEY) handleKey(e.code, e.action);
+        else if (e.type == INPUT_EVENT_CURSOR) handleCursor(e.x, e.y);
+        else if (e.type == INPUT_EVENT_BUTTON) handleMouseButton(e.code, e.action, e.x, e.y);
+    }
+}
+
+// Picks this frame's deltaTime and held keys from the replay log or from
+// liveKeys, and records them. Returns false when the replay has ended.
+bool beginFrameInput(uint8_t liveKeys, double& deltaTime, uint8_t& heldKeys, InputFrame& input) {
+    input.events.clear();
+    if (g_inputReplay) {
+        if (!g_inputReplay->nextFrame(input)) return false;
+        deltaTime = input.deltaTime;
+        heldKeys = input.heldKeys;
+    } else {
+        heldKeys = liveKeys;
+    }
+    if (g_inputRecorder) g_inputRecorder->addFrame(deltaTime, heldKeys);
+    return true;
+}
+
+// FNV-1a over everything the simulation advances, to compare replays
+uint64_t hashSimulationState() {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* p = (const unsigned char*)data;
+        for (size_t i = 0; i < size; i++) {
+            hash ^= p[i];
+            hash *= 1099511628211ull;
+        }
+    };
+
+    glm::vec3 camPos = g_camera->getPosition();
+    glm::vec3 camFront = g_camera->getFront();
+    glm::mat4 handM = g_hand->getStateTransformMatrix();
+    mix(&camPos, sizeof(camPos));
+    mix(&camFront, sizeof(camFront));
+    mix(&handM, sizeof(handM));
+
+    for (float z : g_street->getSegmentPositions()) mix(&z, sizeof(z));
+    BuildingView buildings = g_street->getBuildings();
+    for (int i = 0; i < buildings.size(); i++) {
+        glm::vec3 position = buildings.position(i);
+        mix(&position, sizeof(position));
+        mix(&buildings.scale[i], sizeof(float));
+        mix(&buildings.rotation[i], sizeof(float));
+        mix(&buildings.type[i], sizeof(int));
+    }
+
+    int h, m, s;
+    g_watch->getClock(h, m, s);
+    int watchState[] = { (int)g_watch->getCurrentScreen(), g_watch->getHeartRate(), g_watch->getBatteryPercent(), h, m, s,
+                         g_isRunning ? 1 : 0, g_freeCameraMode ? 1 : 0 };
+    uint64_t ecgWritten = g_watch->getEcg().getWritten();
+    float ecgPhase = g_watch->getEcg().getPhase();
+    mix(watchState, sizeof(watchState));
+    mix(&ecgWritten, sizeof(ecgWritten));
+    mix(&ecgPhase, sizeof(ecgPhase));
+    return hash;
+}
+
+void printSimulationState(int frames) {
+    std::cout << "Simulation state after " << frames << " frames: " << std::hex << std::setw(16) << std::setfill('0')
+              << hashSimulationState() << std::dec << std::setfill(' ') << std::endl;
+}
+
 void renderStudentInfoOverlay(unsigned int shader) {
     glm::mat4 orthoProj = glm::ortho(0.0f, (float)g_width, 0.0f, (float)g_height, -1.0f, 1.0f);
     glm::mat4 identity = glm::mat4(1.0f);
@@ -144,201 +326,521 @@ void renderStudentInfoOverlay(unsigned int shader) {
     }
     glBindVertexArray(bgVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
+    RenderStats::get().countDraw(2);
     glBindVertexArray(0);
 
     glm::vec3 textColor(0.0f, 1.0f, 0.5f);
     g_digitRenderer->drawText("papp tamas", margin + 10.0f, margin + 55.0f, textScale, textColor, shader, identity);
     g_digitRenderer->drawText("ra-4-2022", margin + 10.0f, margin + 20.0f, textScale, textColor, shader, identity);
 
+    if (g_hud) g_hud->render(*g_digitRenderer, shader, g_width, g_height);
+
     glEnable(GL_DEPTH_TEST);
 }
 
-int main() {
-    // Initialize GLFW
-    if (!glfwInit()) return -1;
+void updateScene(double deltaTime, double currentTime, uint8_t heldKeys) {
+    PROFILE_SCOPE("Update");
+    // Free camera movement
+    if (g_freeCameraMode) {
+        float speed = 5.0f * (float)deltaTime;
+        if (isKeyHeld(heldKeys, GLFW_KEY_W)) g_camera->moveForward(speed);
+        if (isKeyHeld(heldKeys, GLFW_KEY_S)) g_camera->moveForward(-speed);
+        if (isKeyHeld(heldKeys, GLFW_KEY_A)) g_camera->moveRight(-speed);
+        if (isKeyHeld(heldKeys, GLFW_KEY_D)) g_camera->moveRight(speed);
+        if (isKeyHeld(heldKeys, GLFW_KEY_Q)) g_camera->moveUp(-speed);
+        if (isKeyHeld(heldKeys, GLFW_KEY_E)) g_camera->moveUp(speed);
+    }
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // Running state
+    g_isRunning = !g_freeCameraMode &&
+                  isKeyHeld(heldKeys, GLFW_KEY_D) &&
+                  g_watch->getCurrentScreen() == WATCH_SCREEN_HEART_RATE &&
+                  g_hand->isInViewingMode();
 
-    // Fullscreen
-    GLFWmonitor* monitor = glfwGetPrimaryMonitor();
-    const GLFWvidmode* mode = glfwGetVideoMode(monitor);
-    g_width = mode->width;
-    g_height = mode->height;
+    // Update objects
+    g_camera->updateBobbing(deltaTime, g_isRunning);
+    glm::vec3 camPos = g_camera->getPosition();
 
-    GLFWwindow* window = glfwCreateWindow(g_width, g_height, "SmartWatch3D", monitor, NULL);
-    if (!window) { glfwTerminate(); return -1; }
+    g_hand->update(deltaTime, camPos);
+    g_street->update(deltaTime, g_isRunning);
+    g_watch->update(deltaTime, currentTime, g_isRunning, g_street->getRunningSpeed());
+}
 
-    glfwMakeContextCurrent(window);
-    glfwSwapInterval(0); 
-    glfwSetCursorPosCallback(window, mouseCallback);
-    glfwSetMouseButtonCallback(window, mouseButtonCallback);
-    glfwSetKeyCallback(window, keyCallback);
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
+// Runs as many fixed steps as the accumulated frame time covers, then sets
+// the interpolation factor for rendering
+void advanceSimulation(double deltaTime, double& accumulator, double& simTime, uint8_t heldKeys) {
+    accumulator += deltaTime;
+    if (accumulator > SIM_STEP * MAX_SIM_STEPS) accumulator = SIM_STEP * MAX_SIM_STEPS;
+
+    while (accumulator >= SIM_STEP) {
+        g_camera->beginStep();
+        g_hand->beginStep();
+        simTime += SIM_STEP;
+        updateScene(SIM_STEP, simTime, heldKeys);
+        accumulator -= SIM_STEP;
+    }
 
-    if (glewInit() != GLEW_OK) return -1;
+    float alpha = (float)(accumulator / SIM_STEP);
+    g_camera->setRenderAlpha(alpha);
+    g_hand->setRenderAlpha(alpha);
+    g_street->setRenderAlpha(alpha);
+}
 
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glClearColor(0.07f, 0.08f, 0.12f, 1.0f);
+// Everything the GL thread needs, taken at the interpolated render state
+void prepareSnapshot(SceneSnapshot& out) {
+    PROFILE_SCOPE("Prepare snapshot");
+    out.camera = g_camera->getCameraBlock();
 
-    unsigned int shader = createShader("phong.vert", "phong.frag");
-    g_uniforms.init(shader);
+    g_hand->updateTransforms(g_transforms);
+    {
+        PROFILE_SCOPE("Transform update");
+        g_transforms.update();
+    }
+    Profiler::get().counter("Matrices recomputed", (double)g_transforms.getLastUpdateCount());
+    out.transforms = g_transforms.getWorldMatrices();
+    out.watchLightPos = g_watch->getLightPosition(out.transforms);
+    out.handViewing = g_hand->isInViewingMode();
+    out.freeCamera = g_freeCameraMode;
+    out.watch = g_watch->getDisplay();
+
+    g_street->buildDrawList(out.camera.viewProjection, glm::vec3(out.camera.position), out.street);
+}
 
-    g_heartCursor = loadImageToCursor("Resources/textures/red_heart_cursor.png");
-    if (g_heartCursor) glfwSetCursor(window, g_heartCursor);
+// Runs on the simulation thread, one call per frame
+void simulateFrame(const SimulationJob& job, SceneSnapshot& out) {
+    applyInputEvents(job.input.events);
+    if (!job.advance) return;
 
-    g_camera = new Camera(glm::vec3(0.0f, 1.4f, 0.0f), (float)g_width / (float)g_height);
+    advanceSimulation(job.input.deltaTime, g_simAccumulator, g_simTime, job.input.heldKeys);
+    prepareSnapshot(out);
+}
 
-    g_sun = new Sun();
-    g_sun->init("Resources/sun/2k_sun.jpg");
+void updateCursorMode(GLFWwindow* window, const SceneSnapshot& scene) {
+    if (scene.freeCamera) {
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    } else if (scene.handViewing) {
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+        if (g_heartCursor) glfwSetCursor(window, g_heartCursor);
+    } else {
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
+    }
+}
 
-    g_street = new Street();
-    g_street->init(8.0f, 15.0f, 12);
+// Draws a snapshot; reads nothing the simulation thread writes
+void renderScene(unsigned int shader, const SceneSnapshot& scene) {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glUseProgram(shader);
+
+    g_uniforms.setViewMatrix(scene.camera.view);
+    g_uniforms.setProjectionMatrix(scene.camera.projection);
+    glUniform3fv(g_uniforms.uViewPos, 1, glm::value_ptr(scene.camera.position));
+    RenderStats::get().countUniforms();
+
+    // Set main light (sun)
+    glm::vec3 lightPos = g_sun->getPosition();
+    glUniform3fv(g_uniforms.uLight_pos, 1, glm::value_ptr(lightPos));
+    glUniform3fv(g_uniforms.uLight_kA, 1, glm::value_ptr(g_sun->getAmbient()));
+    glUniform3fv(g_uniforms.uLight_kD, 1, glm::value_ptr(g_sun->getDiffuse()));
+    glUniform3fv(g_uniforms.uLight_kS, 1, glm::value_ptr(g_sun->getSpecular()));
+    RenderStats::get().countUniforms(4);
+
+    // Set watch light
+    glUniform3fv(g_uniforms.uWatchLight_pos, 1, glm::value_ptr(scene.watchLightPos));
+    glUniform3fv(g_uniforms.uWatchLight_kA, 1, glm::value_ptr(WATCH_LIGHT_AMBIENT));
+    glUniform3fv(g_uniforms.uWatchLight_kD, 1, glm::value_ptr(WATCH_LIGHT_DIFFUSE));
+    glUniform3fv(g_uniforms.uWatchLight_kS, 1, glm::value_ptr(WATCH_LIGHT_SPECULAR));
+    glUniform1i(g_uniforms.uUseWatchLight, scene.handViewing ? 1 : 0);
+    RenderStats::get().countUniforms(5);
+
+    // Set fog
+    g_uniforms.setFog(true, glm::vec3(0.07f, 0.08f, 0.12f), 0.00025f);
+
+    // Render street (ground, road, buildings)
+    Profiler::get().counter("Visible buildings", (double)scene.street.buildings.size());
+    {
+        PROFILE_GPU_SCOPE("Street pass");
+        g_street->render(g_uniforms, scene.street);
+    }
 
-    g_hand = new Hand();
-    g_hand->init("Resources/arm/arm.obj");
+    // Render sun (no fog, emissive)
+    {
+        PROFILE_GPU_SCOPE("Sun pass");
+        g_sun->render(g_uniforms);
+    }
+    g_uniforms.setFog(true, glm::vec3(0.07f, 0.08f, 0.12f), 0.00025f);
 
-    g_watch = new Watch();
-    g_watch->init();
+    // Render hand and watch
+    g_uniforms.setFog(false);
+    {
+        PROFILE_GPU_SCOPE("Hand pass");
+        g_hand->render(g_uniforms, scene.transforms);
+    }
+    {
+        PROFILE_GPU_SCOPE("Watch pass");
+        g_watch->render(g_uniforms, scene.transforms, shader, scene.watch);
+    }
 
-    g_digitRenderer = new DigitRenderer();
-    g_digitRenderer->init();
+    // Render student info overlay
+    {
+        PROFILE_GPU_SCOPE("Overlay pass");
+        renderStudentInfoOverlay(shader);
+    }
+
+    // Restore matrices for next frame
+    g_uniforms.setViewMatrix(scene.camera.view);
+    g_uniforms.setProjectionMatrix(scene.camera.projection);
+}
 
-    // Watch light parameters
-    glm::vec3 watchLightAmbient(0.005f, 0.005f, 0.008f);
-    glm::vec3 watchLightDiffuse(0.03f, 0.04f, 0.05f);
-    glm::vec3 watchLightSpecular(0.02f, 0.02f, 0.03f);
+// Frame N hands its input to the simulation thread, then draws the snapshot
+// of frame N-1 while the simulation works on frame N
+void runWindowed(GLFWwindow* window, unsigned int shader, FramePacer& pacer) {
+    SimulationThread simulation;
+    simulation.start(simulateFrame);
 
     double lastTime = glfwGetTime();
+    int frames = 0;
+    InputFrame input;
+    SimulationJob job;
+    job.advance = true;
+    job.quit = false;
 
-    // Main loop
     while (!glfwWindowShouldClose(window)) {
+        pacer.waitForFrameStart();
+
         double currentTime = glfwGetTime();
         double deltaTime = currentTime - lastTime;
         lastTime = currentTime;
 
-        // Free camera movement
-        if (g_freeCameraMode) {
-            float speed = 5.0f * (float)deltaTime;
-            if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) g_camera->moveForward(speed);
-            if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) g_camera->moveForward(-speed);
-            if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) g_camera->moveRight(-speed);
-            if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) g_camera->moveRight(speed);
-            if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) g_camera->moveUp(-speed);
-            if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) g_camera->moveUp(speed);
+        uint8_t heldKeys;
+        if (!beginFrameInput(pollHeldKeys(window), deltaTime, heldKeys, input)) break;
+        job.input.deltaTime = deltaTime;
+        job.input.heldKeys = heldKeys;
+        job.input.events.swap(g_pendingEvents);
+        simulation.submit(job);
+
+        Profiler::get().beginFrame();
+        {
+            PROFILE_SCOPE("Frame");
+            const SceneSnapshot& scene = simulation.acquire(frames > 0 ? frames - 1 : 0);
+            updateCursorMode(window, scene);
+            renderScene(shader, scene);
+            double cpuMs = (glfwGetTime() - currentTime) * 1000.0;
+
+            {
+                PROFILE_SCOPE("Swap");
+                glfwSwapBuffers(window);
+            }
+            pacer.endFrame();
+            glfwPollEvents();
+            if (g_inputReplay) queueReplayEvents(window, input.events);
+
+            // Finish at most one streamed texture per frame
+            processTextureUploads();
+            g_shaders->pollChanges();
+
+            RenderStats::get().endFrame();
+            g_hud->addFrame(deltaTime * 1000.0, cpuMs, Profiler::get().getLastGpuFrameMs(), RenderStats::get().getLastFrame());
         }
+        Profiler::get().endFrame();
+        frames++;
+    }
 
-        // Running state
-        g_isRunning = !g_freeCameraMode &&
-                      glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS &&
-                      g_watch->getCurrentScreen() == WATCH_SCREEN_HEART_RATE &&
-                      g_hand->isInViewingMode();
+    // The last frame's events still reach the simulation before the state is read
+    job.advance = false;
+    job.input.events.swap(g_pendingEvents);
+    simulation.submit(job);
+    simulation.stop();
 
-        // Update objects
-        g_camera->updateBobbing(deltaTime, g_isRunning);
-        glm::vec3 camPos = g_camera->getPosition();
+    pacer.printStats();
 
-        g_hand->update(deltaTime, camPos);
-        g_street->update(deltaTime, g_isRunning);
-        g_watch->update(deltaTime, currentTime, g_isRunning);
+    if (g_inputRecorder || g_inputReplay) printSimulationState(frames);
+}
 
-        if (g_freeCameraMode) {
-            glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-        } else if (g_hand && g_hand->isInViewingMode()) {
-            glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-            if (g_heartCursor) glfwSetCursor(window, g_heartCursor);
-        } else {
-            glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
+// Renders a fixed number of frames into an FBO with a fixed timestep and
+// reports frame time statistics. Each frame ends with glFinish so the GPU
+// (or software rasterizer) work is part of the measured time. Unless it is
+// replaying or asked to stand still, the runner runs: D stays held and the
+// hand is raised to the heart rate screen main() already switched to.
+int runHeadless(GLFWwindow* window, unsigned int shader, const AppOptions& options) {
+    OffscreenTarget target;
+    if (!target.init(options.width, options.height)) return -1;
+    target.bind();
+
+    // Every texture must be resident before measuring
+    finishTextureUploads();
+
+    std::cout << "Headless: " << glGetString(GL_RENDERER) << ", "
+              << options.width << "x" << options.height << ", "
+              << options.warmupFrames << " warmup + " << options.frames << " frames, dt "
+              << options.fixedDeltaTime << " s, "
+              << (g_inputReplay ? "replay" : options.idle ? "standing" : "running") << std::endl;
+    bool running = !g_inputReplay && !options.idle;
+    uint8_t liveKeys = running ? heldKeyMask(GLFW_KEY_D) : 0;
+
+    FrameStats stats;
+    stats.reserve(options.frames);
+
+    SimulationThread simulation;
+    simulation.start(simulateFrame);
+
+    // A replay runs for as long as the log, with its recorded timesteps
+    int frame = 0;
+    InputFrame input;
+    SimulationJob job;
+    job.advance = true;
+    job.quit = false;
+    for (; g_inputReplay || frame < options.warmupFrames + options.frames; frame++) {
+        auto start = std::chrono::steady_clock::now();
+
+        double deltaTime = options.fixedDeltaTime;
+        uint8_t heldKeys;
+        if (!beginFrameInput(liveKeys, deltaTime, heldKeys, input)) break;
+        job.input.deltaTime = deltaTime;
+        job.input.heldKeys = heldKeys;
+        job.input.events.swap(g_pendingEvents);
+        simulation.submit(job);
+
+        // Space raises the hand from the next frame on, like a key press would
+        if (running && frame == 0) {
+            if (g_inputRecorder) g_inputRecorder->addKey(GLFW_KEY_SPACE, GLFW_PRESS, 0);
+            g_pendingEvents.push_back({ INPUT_EVENT_KEY, GLFW_KEY_SPACE, GLFW_PRESS, 0, 0.0, 0.0 });
         }
 
-        // Render
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        Profiler::get().beginFrame();
+        {
+            PROFILE_SCOPE("Frame");
+            renderScene(shader, simulation.acquire(frame > 0 ? frame - 1 : 0));
+            queueReplayEvents(window, input.events);
 
-        glUseProgram(shader);
+            PROFILE_SCOPE("Finish");
+            glFinish();
+        }
+        Profiler::get().endFrame();
 
-        glm::mat4 view = g_camera->getViewMatrix();
-        glm::mat4 projection = g_camera->getProjectionMatrix();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        RenderStats::get().endFrame();
+        g_hud->addFrame(ms, ms, Profiler::get().getLastGpuFrameMs(), RenderStats::get().getLastFrame());
+        if (frame >= options.warmupFrames) stats.addSample(ms);
+    }
 
-        g_uniforms.setViewMatrix(view);
-        g_uniforms.setProjectionMatrix(projection);
-        glUniform3fv(g_uniforms.uViewPos, 1, glm::value_ptr(camPos));
+    job.advance = false;
+    job.input.events.swap(g_pendingEvents);
+    simulation.submit(job);
+    simulation.stop();
 
-        // Set main light (sun)
-        glm::vec3 lightPos = g_sun->getPosition();
-        glUniform3fv(g_uniforms.uLight_pos, 1, glm::value_ptr(lightPos));
-        glUniform3fv(g_uniforms.uLight_kA, 1, glm::value_ptr(g_sun->getAmbient()));
-        glUniform3fv(g_uniforms.uLight_kD, 1, glm::value_ptr(g_sun->getDiffuse()));
-        glUniform3fv(g_uniforms.uLight_kS, 1, glm::value_ptr(g_sun->getSpecular()));
+    target.unbind();
+    stats.print("Frame time");
+    printSimulationState(frame);
+    return 0;
+}
 
-        // Set watch light
-        glm::vec3 watchScreenPos = g_watch->getScreenPosition(g_hand->getTransformMatrix());
-        glUniform3fv(g_uniforms.uWatchLight_pos, 1, glm::value_ptr(watchScreenPos));
-        glUniform3fv(g_uniforms.uWatchLight_kA, 1, glm::value_ptr(watchLightAmbient));
-        glUniform3fv(g_uniforms.uWatchLight_kD, 1, glm::value_ptr(watchLightDiffuse));
-        glUniform3fv(g_uniforms.uWatchLight_kS, 1, glm::value_ptr(watchLightSpecular));
-        glUniform1i(g_uniforms.uUseWatchLight, g_hand->isInViewingMode() ? 1 : 0);
+// Relinking may move uniform locations, so they are looked up again
+void reloadUniforms(void* data, unsigned int shader) {
+    ((ShaderUniforms*)data)->init(shader);
+}
 
-        // Set fog
-        g_uniforms.setFog(true, glm::vec3(0.07f, 0.08f, 0.12f), 0.00025f);
+int main(int argc, char** argv) {
+    AppOptions options;
+    if (!parseAppOptions(argc, argv, options)) return -1;
+    Profiler::get().setThreadName("Main");
+
+    if (options.bench) return runBenchmarks(options.threads);
+    JobSystem::get().start(options.threads - 1);
+
+    // A replay renders at the recorded resolution so screen-space clicks land the same
+    InputLogHeader logHeader = {};
+    if (!options.replayPath.empty()) {
+        g_inputReplay = new InputLogReader();
+        if (!g_inputReplay->open(options.replayPath.c_str())) return -1;
+        logHeader = g_inputReplay->getHeader();
+        options.width = logHeader.width;
+        options.height = logHeader.height;
+    }
 
-        // Render street (ground, road, buildings)
-        g_street->render(g_uniforms);
+#ifdef GLFW_PLATFORM_NULL
+    // GLFW 3.4+: no display server needed, the context comes from OSMesa or EGL
+    if (options.headless) glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
 
-        // Render sun (no fog, emissive)
-        g_sun->render(g_uniforms);
-        g_uniforms.setFog(true, glm::vec3(0.07f, 0.08f, 0.12f), 0.00025f);
-
-        // Render hand and watch
-        g_uniforms.setFog(false);
-        g_hand->render(g_uniforms);
-        g_watch->render(g_uniforms, g_hand->getTransformMatrix(), shader);
-
-        // Calculate arrow positions for click detection
-        glm::mat4 handM = g_hand->getTransformMatrix();
-        glm::mat4 watchM = glm::translate(handM, glm::vec3(0.25f, -0.025f, -0.05f));
-        watchM = glm::rotate(watchM, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        watchM = glm::rotate(watchM, glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        watchM = glm::scale(watchM, glm::vec3(0.35f));
-        glm::mat4 screenM = glm::translate(watchM, glm::vec3(0.0f, 0.0f, 0.021f));
-        float contentScale = 0.55f;
-
-        glm::vec3 leftArrowWorld = glm::vec3(screenM * glm::vec4(-0.14f * contentScale, 0.0f, 0.01f, 1.0f));
-        glm::vec3 rightArrowWorld = glm::vec3(screenM * glm::vec4(0.14f * contentScale, 0.0f, 0.01f, 1.0f));
-        g_leftArrowScreenPos = projectToScreen(leftArrowWorld, view, projection);
-        g_rightArrowScreenPos = projectToScreen(rightArrowWorld, view, projection);
-
-        // Render student info overlay
-        renderStudentInfoOverlay(shader);
+    // Initialize GLFW
+    if (!glfwInit()) return -1;
 
-        // Restore matrices for next frame
-        g_uniforms.setViewMatrix(view);
-        g_uniforms.setProjectionMatrix(projection);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    GLFWwindow* window = nullptr;
+    if (options.headless) {
+        // Hidden window only provides the context, rendering goes to an FBO
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, options.useEGL ? GLFW_EGL_CONTEXT_API : GLFW_OSMESA_CONTEXT_API);
+        g_width = options.width;
+        g_height = options.height;
+        window = glfwCreateWindow(g_width, g_height, "SmartWatch3D", NULL, NULL);
+        if (!window) {
+            std::cout << "Failed to create a headless context (" << (options.useEGL ? "EGL" : "OSMesa") << ")" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+    } else {
+        // Fullscreen
+        GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+        const GLFWvidmode* mode = glfwGetVideoMode(monitor);
+        g_width = mode->width;
+        g_height = mode->height;
+
+        window = glfwCreateWindow(g_width, g_height, "SmartWatch3D", monitor, NULL);
+        if (!window) { glfwTerminate(); return -1; }
+
+        if (g_inputReplay && (g_width != logHeader.width || g_height != logHeader.height)) {
+            std::cout << "Replay was recorded at " << logHeader.width << "x" << logHeader.height
+                      << ", the image will be stretched to fit this display" << std::endl;
+            g_width = logHeader.width;
+            g_height = logHeader.height;
+        }
+    }
+
+    glfwMakeContextCurrent(window);
 
-        // FPS limiting
-        double frameEndTime = glfwGetTime();
-        double frameTime = frameEndTime - currentTime;
-        if (frameTime < TARGET_FRAME_TIME) {
-            std::this_thread::sleep_for(std::chrono::microseconds((int)((TARGET_FRAME_TIME - frameTime) * 1000000)));
+    // Vsync paces to the display refresh; otherwise the pacer caps at --fps
+    FramePacer pacer;
+    if (options.headless || options.vsync == VSYNC_OFF) {
+        glfwSwapInterval(0);
+        if (!options.headless && options.targetFps > 0) pacer.setPeriod(1.0 / options.targetFps);
+    } else {
+        int interval = 1;
+        if (options.vsync == VSYNC_ADAPTIVE) {
+            if (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+                interval = -1;
+            } else {
+                std::cout << "Adaptive vsync not supported, using regular vsync" << std::endl;
+            }
         }
+        glfwSwapInterval(interval);
+
+        const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+        pacer.setVsync(options.vsync);
+        pacer.setPeriod(1.0 / (mode && mode->refreshRate > 0 ? mode->refreshRate : 60));
+    }
+    if (options.latencyMs >= 0.0) pacer.setLatencyTarget(options.latencyMs / 1000.0);
+    if (!options.headless) {
+        glfwSetCursorPosCallback(window, mouseCallback);
+        glfwSetMouseButtonCallback(window, mouseButtonCallback);
+        glfwSetKeyCallback(window, keyCallback);
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
+    }
+
+    if (glewInit() != GLEW_OK) return -1;
+
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glClearColor(0.07f, 0.08f, 0.12f, 1.0f);
+
+    g_shaders = new ShaderManager();
+    if (options.shaderDev && !options.headless) g_shaders->enableHotReload();
+    unsigned int shader = g_shaders->load("phong.vert", "phong.frag", reloadUniforms, &g_uniforms);
+    if (!shader) {
+        delete g_shaders;
+        glfwTerminate();
+        return -1;
+    }
+
+    if (!options.headless) {
+        g_heartCursor = loadImageToCursor("Resources/textures/red_heart_cursor.png");
+        if (g_heartCursor) glfwSetCursor(window, g_heartCursor);
+    }
+
+    g_resources = new ResourceManager();
+
+    g_camera = new Camera(glm::vec3(0.0f, 1.4f, 0.0f), (float)g_width / (float)g_height);
+
+    g_sun = new Sun();
+    g_sun->init(*g_resources, "Resources/sun/2k_sun.jpg");
+
+    g_street = new Street();
+    g_street->init(*g_resources, 8.0f, 15.0f, (float)options.viewDistance);
+
+    g_hand = new Hand();
+    g_hand->init(*g_resources, "Resources/arm/arm.obj");
+
+    g_watch = new Watch();
+    g_watch->init(*g_resources);
+    g_watch->setEcgSampleRate(options.ecgSampleRate);
+    if (!options.sensorLogPath.empty()) {
+        g_sensorLog = new SensorLog();
+        if (g_sensorLog->open(options.sensorLogPath.c_str())) {
+            g_watch->setSensorLog(g_sensorLog);
+        } else {
+            delete g_sensorLog;
+            g_sensorLog = nullptr;
+        }
+    }
+    g_hand->attachTransforms(g_transforms);
+    g_watch->attachTransforms(g_transforms, g_hand->getHandNode());
+
+    g_digitRenderer = new DigitRenderer();
+    g_digitRenderer->init();
+
+    g_hud = new PerformanceHud();
+
+    if (g_inputReplay) {
+        g_watch->setRandomSeed(logHeader.seed);
+        g_street->setCitySeed(logHeader.seed);
+        g_watch->setClock(logHeader.hours, logHeader.minutes, logHeader.seconds);
+        g_watch->setScreen((WatchScreen)logHeader.screen);
+    } else {
+        if (options.headless && !options.idle) g_watch->setScreen(WATCH_SCREEN_HEART_RATE);
+        logHeader.seed = std::random_device()();
+        logHeader.width = g_width;
+        logHeader.height = g_height;
+        g_watch->getClock(logHeader.hours, logHeader.minutes, logHeader.seconds);
+        logHeader.screen = g_watch->getCurrentScreen();
+        g_watch->setRandomSeed(logHeader.seed);
+        g_street->setCitySeed(logHeader.seed);
+
+        if (!options.recordPath.empty()) {
+            g_inputRecorder = new InputLogWriter();
+            if (!g_inputRecorder->open(options.recordPath.c_str(), logHeader)) {
+                delete g_inputRecorder;
+                g_inputRecorder = nullptr;
+            }
+        }
+    }
+
+    int result = 0;
+    if (options.headless) {
+        result = runHeadless(window, shader, options);
+    } else {
+        runWindowed(window, shader, pacer);
     }
 
     // Cleanup
+    if (g_inputRecorder) {
+        std::cout << "Recorded " << g_inputRecorder->getFrameCount() << " frames to " << options.recordPath << std::endl;
+    }
+    delete g_inputRecorder;
+    delete g_inputReplay;
     delete g_camera;
     delete g_sun;
     delete g_street;
     delete g_hand;
     delete g_watch;
+    delete g_sensorLog;
     delete g_digitRenderer;
+    delete g_hud;
+    delete g_resources;
+    shutdownTextureStreaming();
+    JobSystem::get().stop();
+
+    if (!options.tracePath.empty()) Profiler::get().exportChromeTrace(options.tracePath.c_str());
+    Profiler::get().shutdownGpu();
 
     glDeleteProgram(shader);
+    delete g_shaders;
     glfwDestroyWindow(window);
     glfwTerminate();
 
-    return 0;
+    return result;
 }
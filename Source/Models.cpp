@@ -1,5 +1,6 @@
 #include "../Header/Models.h"
 #include "../Header/ShaderUniforms.h"
+#include "../Header/RenderStats.h"
 #include <fstream>
 #include <iostream>
 #include <unordered_map>
@@ -63,17 +64,21 @@ void Mesh::setupMesh() {
 void Mesh::draw() const {
     glBindVertexArray(VAO);
     glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    RenderStats::get().countDraw(indices.size() / 3);
     glBindVertexArray(0);
 }
 
 void Mesh::cleanup() {
+    if (VAO == 0) return;
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
+    VAO = VBO = EBO = 0;
 }
 
-Model::Model(const std::string& path) {
-    loadModel(path);
+Model::Model(const std::string& path, bool upload)
+    : boundsMin(0.0f), boundsMax(0.0f) {
+    loadModel(path, upload);
 }
 
 Model::~Model() {
@@ -82,7 +87,7 @@ Model::~Model() {
     }
 }
 
-void Model::loadModel(const std::string& path) {
+void Model::loadModel(const std::string& path, bool upload) {
     size_t lastSlash = path.find_last_of("/\\");
     directory = (lastSlash != std::string::npos) ? path.substr(0, lastSlash) : ".";
 
@@ -258,6 +263,14 @@ void Model::loadModel(const std::string& path) {
         }
     }
 
+    if (!positions.empty()) {
+        boundsMin = boundsMax = positions[0];
+        for (const auto& pos : positions) {
+            boundsMin = glm::min(boundsMin, pos);
+            boundsMax = glm::max(boundsMax, pos);
+        }
+    }
+
     std::unordered_map<std::string, glm::vec3> materialColors;
     if (!mtlFile.empty()) {
         materialColors = loadMTL(directory + "/" + mtlFile);
@@ -274,7 +287,7 @@ void Model::loadModel(const std::string& path) {
         mesh.vertices = std::move(grp.vertices);
         mesh.indices  = std::move(grp.indices);
         mesh.color    = materialColors.count(name) ? materialColors[name] : glm::vec3(0.8f);
-        mesh.setupMesh();
+        if (upload) mesh.setupMesh();
         meshes.push_back(std::move(mesh));
     }
 }
@@ -285,6 +298,14 @@ void Model::draw() const {
     }
 }
 
+size_t Model::getMemoryBytes() const {
+    size_t bytes = 0;
+    for (const auto& mesh : meshes) {
+        bytes += mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(unsigned int);
+    }
+    return bytes;
+}
+
 void Model::drawWithMaterials(const ShaderUniforms& uniforms) const {
     for (const auto& mesh : meshes) {
         glm::vec3 kD = mesh.color;
@@ -0,0 +1,192 @@
+#include "../Header/OcclusionCuller.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define OCCLUSION_SSE2 1
+#endif
+
+// Vertices closer than this (clip w) are treated as crossing the near plane
+static const float kNearW = 0.1f;
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+    : width((width + 3) & ~3),
+      height(height),
+      viewProj(1.0f),
+      occluderTriangles(0) {
+    depth.assign((size_t)this->width * this->height, 1.0f);
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& vp) {
+    viewProj = vp;
+    std::fill(depth.begin(), depth.end(), 1.0f);
+    hiz.clear();
+    hizSize.clear();
+    occluderTriangles = 0;
+}
+
+void OcclusionCuller::addOccluder(const glm::vec3& boxMin, const glm::vec3& boxMax) {
+    glm::vec4 c[8];
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 p((i & 1) ? boxMax.x : boxMin.x,
+                    (i & 2) ? boxMax.y : boxMin.y,
+                    (i & 4) ? boxMax.z : boxMin.z);
+        c[i] = viewProj * glm::vec4(p, 1.0f);
+    }
+
+    // 12 outward facing, counter-clockwise triangles
+    static const int tris[36] = {
+        0, 4, 6,  0, 6, 2,   // -X
+        1, 3, 7,  1, 7, 5,   // +X
+        0, 1, 5,  0, 5, 4,   // -Y
+        2, 6, 7,  2, 7, 3,   // +Y
+        0, 2, 3,  0, 3, 1,   // -Z
+        4, 5, 7,  4, 7, 6    // +Z
+    };
+    for (int t = 0; t < 36; t += 3) {
+        rasterizeTriangle(c[tris[t]], c[tris[t + 1]], c[tris[t + 2]]);
+    }
+}
+
+void OcclusionCuller::rasterizeTriangle(const glm::vec4& c0, const glm::vec4& c1, const glm::vec4& c2) {
+    // Occluders only need to be conservative, so skip anything touching the near plane
+    if (c0.w < kNearW || c1.w < kNearW || c2.w < kNearW) return;
+
+    float x0 = (c0.x / c0.w * 0.5f + 0.5f) * width, y0 = (c0.y / c0.w * 0.5f + 0.5f) * height, z0 = c0.z / c0.w * 0.5f + 0.5f;
+    float x1 = (c1.x / c1.w * 0.5f + 0.5f) * width, y1 = (c1.y / c1.w * 0.5f + 0.5f) * height, z1 = c1.z / c1.w * 0.5f + 0.5f;
+    float x2 = (c2.x / c2.w * 0.5f + 0.5f) * width, y2 = (c2.y / c2.w * 0.5f + 0.5f) * height, z2 = c2.z / c2.w * 0.5f + 0.5f;
+
+    // Back faces are hidden by the front faces of the same box
+    float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+    if (area <= 0.0f) return;
+
+    int minX = std::max(0, (int)std::floor(std::min({ x0, x1, x2 })));
+    int maxX = std::min(width - 1, (int)std::ceil(std::max({ x0, x1, x2 })));
+    int minY = std::max(0, (int)std::floor(std::min({ y0, y1, y2 })));
+    int maxY = std::min(height - 1, (int)std::ceil(std::max({ y0, y1, y2 })));
+    if (minX > maxX || minY > maxY) return;
+
+    occluderTriangles++;
+
+    // Edge equations E(x, y) = A*x + B*y + C, positive inside
+    float a0 = y1 - y2, b0 = x2 - x1, e0 = x1 * y2 - x2 * y1;
+    float a1 = y2 - y0, b1 = x0 - x2, e1 = x2 * y0 - x0 * y2;
+    float a2 = y0 - y1, b2 = x1 - x0, e2 = x0 * y1 - x1 * y0;
+
+    // Depth plane from barycentrics
+    float invArea = 1.0f / area;
+    float za = (a0 * z0 + a1 * z1 + a2 * z2) * invArea;
+    float zb = (b0 * z0 + b1 * z1 + b2 * z2) * invArea;
+    float zc = (e0 * z0 + e1 * z1 + e2 * z2) * invArea;
+
+    int startX = minX & ~3;
+
+#ifdef OCCLUSION_SSE2
+    const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 vA0 = _mm_set1_ps(a0), vA1 = _mm_set1_ps(a1), vA2 = _mm_set1_ps(a2), vZA = _mm_set1_ps(za);
+
+    for (int y = minY; y <= maxY; y++) {
+        float py = y + 0.5f;
+        __m128 row0 = _mm_set1_ps(b0 * py + e0);
+        __m128 row1 = _mm_set1_ps(b1 * py + e1);
+        __m128 row2 = _mm_set1_ps(b2 * py + e2);
+        __m128 rowZ = _mm_set1_ps(zb * py + zc);
+        float* dst = &depth[(size_t)y * width];
+
+        for (int x = startX; x <= maxX; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+            __m128 w0 = _mm_add_ps(_mm_mul_ps(vA0, px), row0);
+            __m128 w1 = _mm_add_ps(_mm_mul_ps(vA1, px), row1);
+            __m128 w2 = _mm_add_ps(_mm_mul_ps(vA2, px), row2);
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)), _mm_cmpge_ps(w2, zero));
+            if (_mm_movemask_ps(inside) == 0) continue;
+
+            __m128 z = _mm_add_ps(_mm_mul_ps(vZA, px), rowZ);
+            __m128 cur = _mm_loadu_ps(dst + x);
+            __m128 closer = _mm_min_ps(cur, z);
+            _mm_storeu_ps(dst + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, cur)));
+        }
+    }
+#else
+    for (int y = minY; y <= maxY; y++) {
+        float py = y + 0.5f;
+        float* dst = &depth[(size_t)y * width];
+        for (int x = startX; x <= maxX; x++) {
+            float px = x + 0.5f;
+            if (a0 * px + b0 * py + e0 < 0.0f) continue;
+            if (a1 * px + b1 * py + e1 < 0.0f) continue;
+            if (a2 * px + b2 * py + e2 < 0.0f) continue;
+            float z = za * px + zb * py + zc;
+            if (z < dst[x]) dst[x] = z;
+        }
+    }
+#endif
+}
+
+void OcclusionCuller::buildHierarchy() {
+    hiz.clear();
+    hizSize.clear();
+    hiz.push_back(depth);
+    hizSize.push_back(glm::ivec2(width, height));
+
+    while (hizSize.back().x > 1 || hizSize.back().y > 1) {
+        const std::vector<float>& src = hiz.back();
+        glm::ivec2 srcSize = hizSize.back();
+        glm::ivec2 dstSize((srcSize.x + 1) / 2, (srcSize.y + 1) / 2);
+        std::vector<float> dst((size_t)dstSize.x * dstSize.y);
+
+        for (int y = 0; y < dstSize.y; y++) {
+            int sy0 = y * 2, sy1 = std::min(sy0 + 1, srcSize.y - 1);
+            for (int x = 0; x < dstSize.x; x++) {
+                int sx0 = x * 2, sx1 = std::min(sx0 + 1, srcSize.x - 1);
+                float m = std::max(std::max(src[sy0 * srcSize.x + sx0], src[sy0 * srcSize.x + sx1]),
+                                   std::max(src[sy1 * srcSize.x + sx0], src[sy1 * srcSize.x + sx1]));
+                dst[y * dstSize.x + x] = m;
+            }
+        }
+        hiz.push_back(std::move(dst));
+        hizSize.push_back(dstSize);
+    }
+}
+
+bool OcclusionCuller::isVisible(const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+    if (hiz.empty()) return true;
+
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, minZ = 1e30f;
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 p((i & 1) ? boxMax.x : boxMin.x,
+                    (i & 2) ? boxMax.y : boxMin.y,
+                    (i & 4) ? boxMax.z : boxMin.z);
+        glm::vec4 c = viewProj * glm::vec4(p, 1.0f);
+        if (c.w < kNearW) return true;
+
+        float sx = (c.x / c.w * 0.5f + 0.5f) * width;
+        float sy = (c.y / c.w * 0.5f + 0.5f) * height;
+        float sz = c.z / c.w * 0.5f + 0.5f;
+        minX = std::min(minX, sx); maxX = std::max(maxX, sx);
+        minY = std::min(minY, sy); maxY = std::max(maxY, sy);
+        minZ = std::min(minZ, sz);
+    }
+
+    // Outside the view frustum
+    if (maxX < 0.0f || maxY < 0.0f || minX > (float)width || minY > (float)height || minZ > 1.0f) return false;
+
+    int x0 = std::max(0, (int)minX), x1 = std::min(width - 1, (int)maxX);
+    int y0 = std::max(0, (int)minY), y1 = std::min(height - 1, (int)maxY);
+
+    // Pick the level where the rectangle covers at most a few texels
+    int level = 0;
+    int extent = std::max(x1 - x0, y1 - y0);
+    while ((extent >> level) > 4 && level + 1 < (int)hiz.size()) level++;
+
+    const std::vector<float>& lvl = hiz[level];
+    glm::ivec2 size = hizSize[level];
+    for (int y = y0 >> level; y <= (y1 >> level); y++) {
+        for (int x = x0 >> level; x <= (x1 >> level); x++) {
+            if (minZ <= lvl[y * size.x + x]) return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,89 @@
+#include "../Header/PerformanceHud.h"
+#include <algorithm>
+#include <cstdio>
+
+// Bars are scaled so this frame time fills the graph
+const float GRAPH_MAX_MS = 33.3f;
+const float BUDGET_MS = 1000.0f / 60.0f;
+
+PerformanceHud::PerformanceHud(int historySize)
+    : visible(false),
+      historySize(historySize),
+      head(0), count(0),
+      frameHistory(historySize, 0.0f),
+      cpuHistory(historySize, 0.0f),
+      lastGpuMs(0.0),
+      lastCounters() {
+    sorted.reserve(historySize);
+}
+
+void PerformanceHud::addFrame(double frameMs, double cpuMs, double gpuMs, const RenderStats::Counters& counters) {
+    frameHistory[head] = (float)frameMs;
+    cpuHistory[head] = (float)cpuMs;
+    head = (head + 1) % historySize;
+    count = std::min(count + 1, historySize);
+    lastGpuMs = gpuMs;
+    lastCounters = counters;
+}
+
+void PerformanceHud::render(DigitRenderer& digits, unsigned int shader, int screenWidth, int screenHeight) {
+    if (!visible || count == 0) return;
+
+    // Sliding window statistics over the recorded frames
+    double frameSum = 0.0;
+    sorted.clear();
+    for (int i = 0; i < count; i++) {
+        frameSum += frameHistory[i];
+        sorted.push_back(cpuHistory[i]);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    float p50 = sorted[(sorted.size() - 1) / 2];
+    float p99 = sorted[(size_t)((sorted.size() - 1) * 0.99f)];
+    double fps = frameSum > 0.0 ? 1000.0 * count / frameSum : 0.0;
+    float cpuMs = cpuHistory[(head + historySize - 1) % historySize];
+
+    float panelWidth = 300.0f, panelHeight = 230.0f, margin = 20.0f;
+    float left = screenWidth - margin - panelWidth;
+    float top = screenHeight - margin;
+    float textScale = 14.0f, lineHeight = 20.0f;
+    glm::vec3 textColor(0.0f, 1.0f, 0.5f);
+
+    digits.beginBatch();
+    digits.drawRect(left, top - panelHeight, panelWidth, panelHeight, glm::vec3(0.1f, 0.1f, 0.14f), shader);
+
+    char line[64];
+    float y = top - 10.0f - textScale;
+    snprintf(line, sizeof(line), "FPS %.0f", fps);
+    digits.drawText(line, left + 10.0f, y, textScale, textColor, shader); y -= lineHeight;
+    snprintf(line, sizeof(line), "CPU %.2f GPU %.2f", cpuMs, lastGpuMs);
+    digits.drawText(line, left + 10.0f, y, textScale, textColor, shader); y -= lineHeight;
+    snprintf(line, sizeof(line), "P50 %.2f P99 %.2f", p50, p99);
+    digits.drawText(line, left + 10.0f, y, textScale, textColor, shader); y -= lineHeight;
+    snprintf(line, sizeof(line), "DRAW %d UNIF %d", lastCounters.drawCalls, lastCounters.uniformUploads);
+    digits.drawText(line, left + 10.0f, y, textScale, textColor, shader); y -= lineHeight;
+    snprintf(line, sizeof(line), "TRIS %lld", lastCounters.triangles);
+    digits.drawText(line, left + 10.0f, y, textScale, textColor, shader); y -= lineHeight;
+
+    // Scrolling CPU frame-time graph, oldest frame on the left
+    float graphHeight = y - (top - panelHeight) - 15.0f;
+    float graphBottom = top - panelHeight + 10.0f;
+    float barWidth = (panelWidth - 20.0f) / historySize;
+    for (int i = 0; i < count; i++) {
+        int index = (head + historySize - count + i) % historySize;
+        float ms = cpuHistory[index];
+        float h = std::min(ms / GRAPH_MAX_MS, 1.0f) * graphHeight;
+
+        glm::vec3 color(0.0f, 0.8f, 0.3f);
+        if (ms > BUDGET_MS) color = glm::vec3(0.9f, 0.8f, 0.0f);
+        if (ms > 2.0f * BUDGET_MS) color = glm::vec3(0.9f, 0.1f, 0.1f);
+
+        float x = left + 10.0f + (historySize - count + i) * barWidth;
+        digits.drawRect(x, graphBottom, std::max(barWidth - 1.0f, 1.0f), std::max(h, 1.0f), color, shader);
+    }
+
+    // 60 Hz budget line
+    float budgetY = graphBottom + (BUDGET_MS / GRAPH_MAX_MS) * graphHeight;
+    digits.drawRect(left + 10.0f, budgetY, panelWidth - 20.0f, 1.0f, glm::vec3(0.6f), shader);
+
+    digits.flushBatch(shader);
+}
@@ -0,0 +1,71 @@
+#include "../Header/PickScene.h"
+#include <algorithm>
+#include <cmath>
+
+const float PICK_MAX_DISTANCE = 1000.0f;
+
+void PickScene::add(int object, const TriangleBvh* bvh, const glm::mat4& model) {
+    if (!bvh || bvh->getNodeCount() == 0) return;
+
+    Target target;
+    target.object = object;
+    target.bvh = bvh;
+    target.inverseModel = glm::inverse(model);
+
+    // World box around the eight transformed corners of the local box
+    glm::vec3 localMin = bvh->getBoundsMin(), localMax = bvh->getBoundsMax();
+    target.boxMin = glm::vec3(1e30f);
+    target.boxMax = glm::vec3(-1e30f);
+    for (int c = 0; c < 8; c++) {
+        glm::vec3 corner((c & 1) ? localMax.x : localMin.x,
+                         (c & 2) ? localMax.y : localMin.y,
+                         (c & 4) ? localMax.z : localMin.z);
+        glm::vec3 world = glm::vec3(model * glm::vec4(corner, 1.0f));
+        target.boxMin = glm::min(target.boxMin, world);
+        target.boxMax = glm::max(target.boxMax, world);
+    }
+    targets.push_back(target);
+}
+
+static bool rayHitsBox(const glm::vec3& origin, const glm::vec3& invDir, const glm::vec3& boxMin,
+                       const glm::vec3& boxMax, float maxDistance) {
+    glm::vec3 t0 = (boxMin - origin) * invDir;
+    glm::vec3 t1 = (boxMax - origin) * invDir;
+    glm::vec3 tMin = glm::min(t0, t1), tMax = glm::max(t0, t1);
+    float tNear = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+    float tFar = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+    return tNear <= tFar;
+}
+
+bool PickScene::pick(const glm::vec3& origin, const glm::vec3& direction, PickHit& hit) const {
+    float length = glm::length(direction);
+    if (length <= 0.0f) return false;
+    glm::vec3 dir = direction / length;
+
+    glm::vec3 safeDir = dir;
+    for (int i = 0; i < 3; i++) {
+        if (fabsf(safeDir[i]) < 1e-20f) safeDir[i] = safeDir[i] < 0.0f ? -1e-20f : 1e-20f;
+    }
+    glm::vec3 invDir = glm::vec3(1.0f) / safeDir;
+
+    float best = PICK_MAX_DISTANCE;
+    bool found = false;
+    for (const Target& target : targets) {
+        if (!rayHitsBox(origin, invDir, target.boxMin, target.boxMax, best)) continue;
+
+        // The local direction is left unnormalized so distances stay in world units
+        glm::vec3 localOrigin = glm::vec3(target.inverseModel * glm::vec4(origin, 1.0f));
+        glm::vec3 localDir = glm::vec3(target.inverseModel * glm::vec4(dir, 0.0f));
+        BvhHit bvhHit;
+        if (!target.bvh->intersect(localOrigin, localDir, best, bvhHit)) continue;
+
+        best = bvhHit.distance;
+        found = true;
+        hit.object = target.object;
+        hit.triangle = bvhHit.triangle;
+        hit.distance = bvhHit.distance;
+        hit.uv = bvhHit.uv;
+    }
+    if (found) hit.position = origin + dir * hit.distance;
+    return found;
+}
@@ -0,0 +1,197 @@
+#include "../Header/Profiler.h"
+#include <GL/glew.h>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+static uint64_t steadyNanoseconds() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Profiler& Profiler::get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler()
+    : enabled(true),
+      writeIndex(0),
+      slots(RING_SIZE),
+      epoch(steadyNanoseconds()),
+      activeGpuPass(-1),
+      frameIndex(0),
+      gpuFrameAccumMs(0.0),
+      lastGpuFrameMs(0.0),
+      droppedGpuQueries(0) {
+    for (auto& slot : slots) slot.sequence.store(0, std::memory_order_relaxed);
+}
+
+uint64_t Profiler::now() const {
+    // Never 0, which ProfileScope uses for "not recording"
+    return steadyNanoseconds() - epoch + 1;
+}
+
+uint32_t Profiler::currentThread() {
+    static std::atomic<uint32_t> nextThread(0);
+    thread_local uint32_t thread = nextThread.fetch_add(1, std::memory_order_relaxed);
+    return thread;
+}
+
+void Profiler::setThreadName(const char* name) {
+    std::lock_guard<std::mutex> lock(threadNameMutex);
+    threadNames.push_back({ currentThread(), name });
+}
+
+void Profiler::push(const Event& e) {
+    uint64_t index = writeIndex.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots[index & (RING_SIZE - 1)];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event = e;
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::recordCpu(const char* name, uint64_t start, uint64_t end) {
+    if (!isEnabled()) return;
+    push({ name, start, end - start, 0.0, currentThread(), EVENT_CPU });
+}
+
+void Profiler::counter(const char* name, double value) {
+    if (!isEnabled()) return;
+    push({ name, now(), 0, value, currentThread(), EVENT_COUNTER });
+}
+
+void Profiler::beginGpuPass(const char* name) {
+    if (!isEnabled() || activeGpuPass >= 0) return;
+
+    int pass = -1;
+    for (int i = 0; i < (int)gpuPasses.size(); i++) {
+        if (gpuPasses[i].name == name) { pass = i; break; }
+    }
+    if (pass < 0) {
+        GpuPass p = {};
+        p.name = name;
+        glGenQueries(2, p.queries);
+        gpuPasses.push_back(p);
+        pass = (int)gpuPasses.size() - 1;
+    }
+
+    GpuPass& p = gpuPasses[pass];
+    int buffer = (int)(frameIndex & 1);
+    if (p.pending[buffer]) {
+        // Still unread from two frames ago; reusing the query discards it
+        droppedGpuQueries++;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, p.queries[buffer]);
+    p.cpuStart[buffer] = now();
+    p.pending[buffer] = true;
+    activeGpuPass = pass;
+}
+
+void Profiler::endGpuPass() {
+    if (activeGpuPass < 0) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    activeGpuPass = -1;
+}
+
+void Profiler::beginFrame() {
+    // Queries from this buffer were issued two frames ago and are normally done
+    int buffer = (int)(frameIndex & 1);
+    double frameMs = 0.0;
+    bool any = false;
+
+    for (auto& p : gpuPasses) {
+        if (!p.pending[buffer]) continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(p.queries[buffer], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(p.queries[buffer], GL_QUERY_RESULT, &elapsed);
+        p.pending[buffer] = false;
+
+        // GL_TIME_ELAPSED has no timestamp; the GPU track is anchored at CPU submission
+        push({ p.name, p.cpuStart[buffer], (uint64_t)elapsed, 0.0, GPU_THREAD, EVENT_GPU });
+        frameMs += elapsed / 1000000.0;
+        any = true;
+    }
+
+    if (any) {
+        lastGpuFrameMs = frameMs;
+        counter("GPU frame ms", frameMs);
+    }
+}
+
+void Profiler::endFrame() {
+    frameIndex++;
+}
+
+void Profiler::shutdownGpu() {
+    for (auto& p : gpuPasses) glDeleteQueries(2, p.queries);
+    gpuPasses.clear();
+    activeGpuPass = -1;
+    if (droppedGpuQueries > 0) {
+        std::cout << "Profiler: " << droppedGpuQueries << " GPU timings were not ready in time and were dropped" << std::endl;
+    }
+}
+
+static void writeJsonString(FILE* file, const char* text) {
+    fputc('"', file);
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') fputc('\\', file);
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+bool Profiler::exportChromeTrace(const char* path) const {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        std::cout << "Failed to write trace: " << path << std::endl;
+        return false;
+    }
+
+    uint64_t end = writeIndex.load(std::memory_order_acquire);
+    uint64_t begin = end > RING_SIZE ? end - RING_SIZE : 0;
+    int written = 0;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"GPU\"}}", GPU_THREAD);
+    {
+        std::lock_guard<std::mutex> lock(threadNameMutex);
+        for (const auto& t : threadNames) {
+            fprintf(file, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", t.first);
+            writeJsonString(file, t.second.c_str());
+            fprintf(file, "}}");
+        }
+    }
+
+    for (uint64_t i = begin; i < end; i++) {
+        const Slot& slot = slots[i & (RING_SIZE - 1)];
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        Event e = slot.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+
+        // Skip slots being written or already overwritten by a newer event
+        if (before != i + 1 || after != before) continue;
+
+        fprintf(file, ",\n{\"name\":");
+        writeJsonString(file, e.name);
+        if (e.type == EVENT_COUNTER) {
+            fprintf(file, ",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%.4f}}",
+                    e.thread, e.start / 1000.0, e.value);
+        } else {
+            fprintf(file, ",\"ph\":\"X\",\"cat\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    e.type == EVENT_GPU ? "gpu" : "cpu", e.thread, e.start / 1000.0, e.duration / 1000.0);
+        }
+        written++;
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    std::cout << "Wrote " << written << " trace events to " << path << std::endl;
+    return true;
+}
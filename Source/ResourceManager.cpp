@@ -0,0 +1,256 @@
+#include "../Header/ResourceManager.h"
+#include "../Header/MappedFile.h"
+#include "../Header/Models.h"
+#include "../Header/Util.h"
+#include <GL/glew.h>
+#include <iostream>
+#include <iomanip>
+
+ResourceHandle::ResourceHandle(ResourceManager* manager, int id)
+    : manager(manager), id(id) {
+}
+
+ResourceHandle::ResourceHandle(const ResourceHandle& other)
+    : manager(other.manager), id(other.id) {
+    if (manager) manager->addRef(id);
+}
+
+ResourceHandle::ResourceHandle(ResourceHandle&& other) noexcept
+    : manager(other.manager), id(other.id) {
+    other.manager = nullptr;
+    other.id = -1;
+}
+
+ResourceHandle& ResourceHandle::operator=(const ResourceHandle& other) {
+    if (this != &other) {
+        if (other.manager) other.manager->addRef(other.id);
+        reset();
+        manager = other.manager;
+        id = other.id;
+    }
+    return *this;
+}
+
+ResourceHandle& ResourceHandle::operator=(ResourceHandle&& other) noexcept {
+    if (this != &other) {
+        reset();
+        manager = other.manager;
+        id = other.id;
+        other.manager = nullptr;
+        other.id = -1;
+    }
+    return *this;
+}
+
+ResourceHandle::~ResourceHandle() {
+    reset();
+}
+
+void ResourceHandle::reset() {
+    if (manager) manager->release(id);
+    manager = nullptr;
+    id = -1;
+}
+
+unsigned int ResourceHandle::texture() const {
+    return manager ? manager->entries[id].texture : 0;
+}
+
+Model* ResourceHandle::model() const {
+    return manager ? manager->entries[id].model : nullptr;
+}
+
+ResourceManager::ResourceManager() {}
+
+ResourceManager::~ResourceManager() {
+    for (const auto& e : entries) {
+        if (e.refCount > 0) {
+            std::cout << "Resource still referenced at shutdown: " << e.name << std::endl;
+        }
+    }
+}
+
+bool ResourceManager::hashFile(const std::string& path, uint64_t& outHash) {
+    auto it = pathHashes.find(path);
+    if (it != pathHashes.end()) {
+        outHash = it->second;
+        return true;
+    }
+
+    MappedFile file;
+    if (!file.open(path.c_str())) return false;
+
+    // FNV-1a over the file content
+    uint64_t hash = 14695981039346656037ull;
+    const unsigned char* p = file.data();
+    for (size_t i = 0; i < file.size(); i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ull;
+    }
+
+    pathHashes[path] = hash;
+    outHash = hash;
+    return true;
+}
+
+int ResourceManager::allocateEntry() {
+    if (!freeSlots.empty()) {
+        int id = freeSlots.back();
+        freeSlots.pop_back();
+        return id;
+    }
+    entries.push_back(Entry());
+    return (int)entries.size() - 1;
+}
+
+void ResourceManager::addRef(int id) {
+    entries[id].refCount++;
+}
+
+void ResourceManager::release(int id) {
+    Entry& e = entries[id];
+    if (--e.refCount > 0) return;
+
+    if (e.owned) {
+        if (e.texture) {
+            cancelTextureUpload(e.texture);
+            glDeleteTextures(1, &e.texture);
+        }
+        delete e.model;
+    }
+    if (byHash.count(e.contentHash) && byHash[e.contentHash] == id) byHash.erase(e.contentHash);
+
+    e = Entry();
+    freeSlots.push_back(id);
+}
+
+ResourceHandle ResourceManager::acquireTexture(const std::string& path, bool async) {
+    uint64_t hash = 0;
+    bool hashed = hashFile(path, hash);
+
+    if (hashed) {
+        auto it = byHash.find(hash);
+        if (it != byHash.end() && entries[it->second].type == RESOURCE_TEXTURE) {
+            addRef(it->second);
+            return ResourceHandle(this, it->second);
+        }
+    }
+
+    unsigned int texture = async ? loadImageToTextureAsync(path.c_str()) : loadImageToTexture(path.c_str());
+
+    int id = allocateEntry();
+    Entry& e = entries[id];
+    e.name = path;
+    e.type = RESOURCE_TEXTURE;
+    e.contentHash = hash;
+    e.refCount = 1;
+    e.owned = true;
+    e.texture = texture;
+    e.model = nullptr;
+    if (hashed) byHash[hash] = id;
+    return ResourceHandle(this, id);
+}
+
+ResourceHandle ResourceManager::acquireModel(const std::string& path) {
+    uint64_t hash = 0;
+    bool hashed = hashFile(path, hash);
+
+    if (hashed) {
+        auto it = byHash.find(hash);
+        if (it != byHash.end() && entries[it->second].type == RESOURCE_MODEL) {
+            addRef(it->second);
+            return ResourceHandle(this, it->second);
+        }
+    }
+
+    Model* model = new Model(path);
+
+    int id = allocateEntry();
+    Entry& e = entries[id];
+    e.name = path;
+    e.type = RESOURCE_MODEL;
+    e.contentHash = hash;
+    e.refCount = 1;
+    e.owned = true;
+    e.texture = 0;
+    e.model = model;
+    if (hashed) byHash[hash] = id;
+    return ResourceHandle(this, id);
+}
+
+ResourceHandle ResourceManager::trackTexture(const std::string& name, unsigned int texture) {
+    int id = allocateEntry();
+    Entry& e = entries[id];
+    e.name = name;
+    e.type = RESOURCE_TEXTURE;
+    e.contentHash = 0;
+    e.refCount = 1;
+    e.owned = false;
+    e.texture = texture;
+    e.model = nullptr;
+    return ResourceHandle(this, id);
+}
+
+size_t ResourceManager::textureBytes(unsigned int texture) const {
+    if (!texture) return 0;
+
+    size_t total = 0;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    for (int level = 0; level < 16; level++) {
+        GLint w = 0, h = 0, format = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &w);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &h);
+        if (w == 0 || h == 0) break;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_INTERNAL_FORMAT, &format);
+
+        size_t bpp = 4;
+        if (format == GL_RED || format == GL_R8) bpp = 1;
+        else if (format == GL_RG || format == GL_RG8) bpp = 2;
+        else if (format == GL_RGB || format == GL_RGB8) bpp = 3;
+        total += (size_t)w * h * bpp;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return total;
+}
+
+std::vector<ResourceManager::ResourceInfo> ResourceManager::snapshot() const {
+    std::vector<ResourceInfo> result;
+    for (const auto& e : entries) {
+        if (e.refCount <= 0) continue;
+
+        ResourceInfo info;
+        info.name = e.name;
+        info.type = e.type;
+        info.contentHash = e.contentHash;
+        info.refCount = e.refCount;
+        if (e.type == RESOURCE_TEXTURE) {
+            // Pixel data is released after upload, only the GL copy remains
+            info.cpuBytes = 0;
+            info.gpuBytes = textureBytes(e.texture);
+        } else {
+            // Meshes keep their vertex and index arrays next to the GL buffers
+            info.cpuBytes = e.model ? e.model->getMemoryBytes() : 0;
+            info.gpuBytes = info.cpuBytes;
+        }
+        result.push_back(info);
+    }
+    return result;
+}
+
+void ResourceManager::printSnapshot() const {
+    std::vector<ResourceInfo> infos = snapshot();
+    size_t totalCpu = 0, totalGpu = 0;
+
+    std::cout << "Resident resources:" << std::endl;
+    for (const auto& info : infos) {
+        std::cout << "  " << (info.type == RESOURCE_TEXTURE ? "tex   " : "model ")
+                  << std::setw(4) << info.refCount << " refs  "
+                  << std::setw(8) << info.cpuBytes / 1024 << " KB cpu  "
+                  << std::setw(8) << info.gpuBytes / 1024 << " KB gpu  "
+                  << info.name << std::endl;
+        totalCpu += info.cpuBytes;
+        totalGpu += info.gpuBytes;
+    }
+    std::cout << "  total " << infos.size() << " resources, "
+              << totalCpu / 1024 << " KB cpu, " << totalGpu / 1024 << " KB gpu" << std::endl;
+}
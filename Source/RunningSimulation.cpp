@@ -1,84 +1,178 @@
 #include "../Header/RunningSimulation.h"
+#include "../Header/Profiler.h"
 #include <iostream>
 #include <algorithm>
 
-RunningSimulation::RunningSimulation(float segmentLength, int numSegments)
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMULATION_SSE2 1
+#endif
+
+void addToAll(float* values, int count, float delta) {
+    int i = 0;
+#ifdef SIMULATION_SSE2
+    __m128 d = _mm_set1_ps(delta);
+    for (; i + 16 <= count; i += 16) {
+        _mm_storeu_ps(values + i,      _mm_add_ps(_mm_loadu_ps(values + i),      d));
+        _mm_storeu_ps(values + i + 4,  _mm_add_ps(_mm_loadu_ps(values + i + 4),  d));
+        _mm_storeu_ps(values + i + 8,  _mm_add_ps(_mm_loadu_ps(values + i + 8),  d));
+        _mm_storeu_ps(values + i + 12, _mm_add_ps(_mm_loadu_ps(values + i + 12), d));
+    }
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(values + i, _mm_add_ps(_mm_loadu_ps(values + i), d));
+    }
+#endif
+    for (; i < count; i++) values[i] += delta;
+}
+
+// Chunks behind the camera are kept this long so nothing vanishes in view
+const float RETIRE_DISTANCE = 16.0f;
+// Chunks are requested this far beyond the view distance, giving the job
+// system a few seconds before they are needed
+const int PREFETCH_CHUNKS = 2;
+
+RunningSimulation::RunningSimulation(float segmentLength, int numSegments, float viewDistance, uint32_t seed)
     : isRunning(false),
       speed(8.0f),
       segmentLength(segmentLength),
       numSegments(numSegments),
-      buildingSpacing(4.0f) {
+      viewDistance(viewDistance),
+      lastMovement(0.0f),
+      segmentHead(0),
+      generator(seed),
+      distance(0.0),
+      buildingHead(0),
+      firstBuilding(0),
+      nextChunk(0) {
     reset();
 }
 
+RunningSimulation::~RunningSimulation() {
+    waitForPendingChunks();
+    for (ChunkRequest* request : freeRequests) delete request;
+}
+
 void RunningSimulation::reset() {
     segmentPositions.clear();
     for (int i = 0; i < numSegments; i++) {
         segmentPositions.push_back(-i * segmentLength);
     }
+    segmentHead = 0;
 
+    waitForPendingChunks();
     buildings.clear();
-    float roadHalfWidth = 4.0f;
-    int numBuildingsPerSide = 40;
-
-    for (int i = 0; i < numBuildingsPerSide; i++) {
-        float zPos = -2.0f - i * buildingSpacing;
-
-        Building b1;
-        b1.position = glm::vec3(-roadHalfWidth - 3.0f, 0.0f, zPos);
-        b1.scale = 3.5f + (i % 3) * 0.5f;
-        b1.type = i % 4;
-        buildings.push_back(b1);
-
-        Building b2;
-        b2.position = glm::vec3(roadHalfWidth + 3.0f, 0.0f, zPos);
-        b2.scale = 3.5f + ((i + 1) % 3) * 0.5f;
-        b2.type = (i + 2) % 4;
-        buildings.push_back(b2);
+    buildingHead = 0;
+    sideStreets.clear();
+    activeChunks.clear();
+    firstBuilding = 0;
+    distance = 0.0;
+
+    // Start one chunk back so the street behind the camera is built up too
+    nextChunk = -1;
+    streamChunks();
+}
+
+void RunningSimulation::setSeed(uint32_t seed) {
+    // Pending jobs still read the old generator
+    waitForPendingChunks();
+    generator = CityGenerator(seed);
+    reset();
+}
+
+void RunningSimulation::waitForPendingChunks() {
+    for (ChunkRequest* request : pendingChunks) {
+        JobSystem::get().wait(request->done);
+        freeRequests.push_back(request);
+    }
+    pendingChunks.clear();
+}
+
+void RunningSimulation::generateChunkJob(void* data, int, int) {
+    ChunkRequest* request = (ChunkRequest*)data;
+    request->generator->generate(request->index, request->chunk);
+}
+
+void RunningSimulation::streamChunks() {
+    // Retire chunks that are entirely behind the camera by advancing the head
+    while (!activeChunks.empty() &&
+           (activeChunks.front().index + 1) * (double)CITY_CHUNK_LENGTH < distance - RETIRE_DISTANCE) {
+        const ActiveChunk& chunk = activeChunks.front();
+        buildingHead += chunk.buildingCount;
+        firstBuilding += chunk.buildingCount;
+        sideStreets.erase(sideStreets.begin(), sideStreets.begin() + chunk.sideStreetCount);
+        activeChunks.pop_front();
+    }
+    if (buildingHead > 0 && buildingHead >= buildings.size() - buildingHead) {
+        buildings.eraseFront(buildingHead);
+        buildingHead = 0;
+    }
+
+    // Request chunks ahead. Requests are reused, so memory only depends on the view distance.
+    while (nextChunk * (double)CITY_CHUNK_LENGTH < distance + viewDistance + PREFETCH_CHUNKS * CITY_CHUNK_LENGTH) {
+        ChunkRequest* request;
+        if (freeRequests.empty()) {
+            request = new ChunkRequest();
+        } else {
+            request = freeRequests.back();
+            freeRequests.pop_back();
+        }
+        request->index = nextChunk++;
+        request->generator = &generator;
+        JobSystem::get().run(generateChunkJob, request, 0, 0, &request->done);
+        pendingChunks.push_back(request);
+    }
+
+    // Activate chunks once their start comes within the view distance. Only
+    // waits if the runner outpaced the prefetch; which chunks are active
+    // never depends on job timing, so replays stay deterministic.
+    while (!pendingChunks.empty() &&
+           pendingChunks.front()->index * (double)CITY_CHUNK_LENGTH < distance + viewDistance) {
+        ChunkRequest* request = pendingChunks.front();
+        if (!request->done.isDone()) {
+            PROFILE_SCOPE("Wait for city chunk");
+            JobSystem::get().wait(request->done);
+        }
+
+        const CityChunk& chunk = request->chunk;
+        float chunkOffset = (float)(distance - chunk.index * (double)CITY_CHUNK_LENGTH);
+        buildings.append(chunk.buildings, chunkOffset);
+        for (SideStreet street : chunk.sideStreets) {
+            street.z += chunkOffset;
+            sideStreets.push_back(street);
+        }
+        activeChunks.push_back({ chunk.index, chunk.buildings.size(), (int)chunk.sideStreets.size() });
+
+        pendingChunks.pop_front();
+        freeRequests.push_back(request);
     }
 }
 
 void RunningSimulation::update(double deltaTime, bool running) {
     isRunning = running;
+    lastMovement = 0.0f;
     
     if (!isRunning) return;
     
     float movement = speed * (float)deltaTime;
+    lastMovement = movement;
     
-    for (float& pos : segmentPositions) {
-        pos += movement;
-    }
-    
-    float minZ = segmentPositions[0];
-    for (float pos : segmentPositions) {
-        if (pos < minZ) minZ = pos;
-    }
-    
-    for (float& pos : segmentPositions) {
-        if (pos > segmentLength + 5.0f) {
-            pos = minZ - segmentLength;
+    addToAll(segmentPositions.data(), (int)segmentPositions.size(), movement);
 
-            minZ = pos;
-        }
+    // The back of the ring is the element just before the head
+    int segmentCount = (int)segmentPositions.size();
+    for (int n = 0; n < segmentCount && segmentPositions[segmentHead] > segmentLength + 5.0f; n++) {
+        int back = (segmentHead + segmentCount - 1) % segmentCount;
+        segmentPositions[segmentHead] = segmentPositions[back] - segmentLength;
+        segmentHead = (segmentHead + 1) % segmentCount;
     }
 
-    // Move buildings
-    for (auto& b : buildings) {
-        b.position.z += movement;
-    }
+    // Move the live buildings; retired ones in front of the head are left alone
+    float* z = buildings.z.data() + buildingHead;
+    JobSystem::get().parallelFor(buildings.size() - buildingHead, 16384, [z, movement](int begin, int end) {
+        addToAll(z + begin, end - begin, movement);
+    });
+    for (auto& street : sideStreets) street.z += movement;
 
-    // Find furthest back building to append after
-    float minBuildingZ = 0.0f;
-    if (!buildings.empty()) minBuildingZ = buildings[0].position.z;
-    for (const auto& b : buildings) {
-        if (b.position.z < minBuildingZ) minBuildingZ = b.position.z;
-    }
-
-    // Recycle buildings
-    for (auto& b : buildings) {
-        if (b.position.z > 5.0f) {
-            b.position.z = minBuildingZ - buildingSpacing;
-            minBuildingZ = b.position.z;
-        }
-    }
+    distance += movement;
+    streamChunks();
 }
@@ -0,0 +1,252 @@
+#include "../Header/SensorLog.h"
+#include <cstring>
+#include <cstdio>
+#include <iostream>
+
+static const char SENSOR_LOG_MAGIC[4] = { 'S', 'W', 'S', 'L' };
+static const uint32_t SENSOR_LOG_VERSION = 1;
+
+struct SensorLogRecord {
+    uint32_t timeMs;
+    uint16_t heartRate;
+    uint16_t pace;
+    uint8_t battery;
+    uint8_t padding[3];
+};
+static_assert(sizeof(SensorLogRecord) == 12, "SensorLogRecord is written to disk as is");
+
+// The mapping is not null-terminated, so numbers are parsed by hand up to end
+static bool parseNumber(const char*& p, const char* end, double& out) {
+    bool negative = p < end && *p == '-';
+    if (negative) p++;
+    if (p >= end || *p < '0' || *p > '9') return false;
+
+    double value = 0.0;
+    while (p < end && *p >= '0' && *p <= '9') value = value * 10.0 + (*p++ - '0');
+    if (p < end && *p == '.') {
+        p++;
+        double scale = 0.1;
+        while (p < end && *p >= '0' && *p <= '9') {
+            value += (*p++ - '0') * scale;
+            scale *= 0.1;
+        }
+    }
+    out = negative ? -value : value;
+    return true;
+}
+
+SensorLog::SensorLog()
+    : binary(false), dataStart(0), firstTimeMs(0), durationMs(0), recordCount(0),
+      scanOffset(0), scanPrevious(0), scanTime(0), positioned(false), current(), next(), hasNext(false), cursor(0) {
+}
+
+bool SensorLog::open(const char* path) {
+    close();
+    if (!file.open(path)) {
+        std::cout << "Failed to open sensor log: " << path << std::endl;
+        return false;
+    }
+
+    binary = file.size() >= 8 && memcmp(file.data(), SENSOR_LOG_MAGIC, 4) == 0;
+    dataStart = 0;
+    if (binary) {
+        uint32_t version;
+        memcpy(&version, file.data() + 4, sizeof(version));
+        if (version != SENSOR_LOG_VERSION) {
+            std::cout << "Unsupported sensor log version " << version << ": " << path << std::endl;
+            close();
+            return false;
+        }
+        dataStart = 8;
+    }
+
+    // Only the ends are read here; seeks find their way in later
+    size_t offset = dataStart;
+    SensorSample first, last;
+    if (!readRecord(offset, first)) {
+        std::cout << "Sensor log has no samples: " << path << std::endl;
+        close();
+        return false;
+    }
+    firstTimeMs = first.timeMs;
+    if (binary) {
+        recordCount = (file.size() - dataStart) / sizeof(SensorLogRecord);
+        size_t lastOffset = dataStart + (recordCount - 1) * sizeof(SensorLogRecord);
+        readRecord(lastOffset, last);
+    } else {
+        readLastCsvLine(last);
+        index.push_back(dataStart);
+        scanOffset = offset;
+        scanPrevious = dataStart;
+        scanTime = 0;
+    }
+
+    durationMs = last.timeMs > firstTimeMs ? last.timeMs - firstTimeMs : 0;
+    std::cout << "Sensor log " << path << ": " << durationMs / 1000 << " s (";
+    if (binary) std::cout << recordCount << " samples, binary)" << std::endl;
+    else std::cout << "CSV)" << std::endl;
+    return true;
+}
+
+void SensorLog::close() {
+    file.close();
+    recordCount = 0;
+    index.clear();
+    binary = false;
+    durationMs = 0;
+    positioned = false;
+    hasNext = false;
+}
+
+bool SensorLog::readRecord(size_t& offset, SensorSample& out) const {
+    if (!binary) return readCsvLine(offset, out);
+
+    if (offset + sizeof(SensorLogRecord) > file.size()) return false;
+    SensorLogRecord record;
+    memcpy(&record, file.data() + offset, sizeof(record));
+    offset += sizeof(record);
+    out.timeMs = record.timeMs;
+    out.heartRate = record.heartRate;
+    out.pace = record.pace;
+    out.battery = record.battery;
+    return true;
+}
+
+bool SensorLog::readCsvLine(size_t& offset, SensorSample& out) const {
+    const char* begin = (const char*)file.data();
+    const char* end = begin + file.size();
+
+    while (offset < file.size()) {
+        const char* p = begin + offset;
+        const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+        if (!lineEnd) lineEnd = end;
+        offset = (size_t)(lineEnd - begin) + (lineEnd < end ? 1 : 0);
+
+        double fields[4];
+        int parsed = 0;
+        while (parsed < 4 && parseNumber(p, lineEnd, fields[parsed])) {
+            parsed++;
+            while (p < lineEnd && (*p == ',' || *p == ' ' || *p == '\t')) p++;
+        }
+        if (parsed < 4) continue;
+
+        out.timeMs = (int64_t)(fields[0] * 1000.0 + 0.5);
+        out.heartRate = (int)fields[1];
+        out.pace = (int)fields[2];
+        out.battery = (int)fields[3];
+        return true;
+    }
+    return false;
+}
+
+// Steps back a line at a time from the end until one parses
+bool SensorLog::readLastCsvLine(SensorSample& out) const {
+    const char* begin = (const char*)file.data();
+    size_t end = file.size();
+    while (end > dataStart) {
+        size_t start = end - 1;
+        while (start > dataStart && begin[start - 1] != '\n') start--;
+        // Every line after this one already failed, so a sample is from this one
+        size_t offset = start;
+        if (readCsvLine(offset, out)) return true;
+        end = start;
+    }
+    return false;
+}
+
+void SensorLog::extendIndex(int64_t slot) {
+    SensorSample sample;
+    while ((int64_t)index.size() <= slot) {
+        size_t recordOffset = scanOffset;
+        if (!readCsvLine(scanOffset, sample)) return;
+        int64_t time = sample.timeMs - firstTimeMs;
+        if (time < scanTime) continue;
+
+        // Intervals that start before this sample still have the previous one in effect
+        while ((int64_t)index.size() * INDEX_MS <= time) {
+            int64_t start = (int64_t)index.size() * INDEX_MS;
+            index.push_back(start == time ? recordOffset : scanPrevious);
+        }
+        scanPrevious = recordOffset;
+        scanTime = time;
+    }
+}
+
+void SensorLog::seek(int64_t timeMs) {
+    if (binary) {
+        // Last record at or before timeMs, or the first one
+        size_t low = 0, high = recordCount;
+        while (high - low > 1) {
+            size_t middle = (low + high) / 2;
+            size_t offset = dataStart + middle * sizeof(SensorLogRecord);
+            SensorSample sample;
+            readRecord(offset, sample);
+            if (sample.timeMs - firstTimeMs <= timeMs) low = middle;
+            else high = middle;
+        }
+        cursor = dataStart + low * sizeof(SensorLogRecord);
+    } else {
+        int64_t slot = timeMs / INDEX_MS;
+        if (slot < 0) slot = 0;
+        extendIndex(slot);
+        if (slot >= (int64_t)index.size()) slot = (int64_t)index.size() - 1;
+        cursor = index[(size_t)slot];
+    }
+
+    readRecord(cursor, current);
+    current.timeMs -= firstTimeMs;
+    positioned = true;
+    advance();
+}
+
+void SensorLog::advance() {
+    // Skips samples that go back in time, like the CSV index does
+    hasNext = false;
+    SensorSample sample;
+    while (readRecord(cursor, sample)) {
+        sample.timeMs -= firstTimeMs;
+        if (sample.timeMs >= current.timeMs) {
+            next = sample;
+            hasNext = true;
+            return;
+        }
+    }
+}
+
+bool SensorLog::sampleAt(int64_t timeMs, SensorSample& out) {
+    if (!isOpen()) return false;
+
+    // Going back, or far enough ahead that decoding every sample in between
+    // would cost more than starting over from the index
+    if (!positioned || timeMs < current.timeMs || (hasNext && timeMs - next.timeMs > INDEX_MS)) {
+        seek(timeMs);
+    }
+    while (hasNext && next.timeMs <= timeMs) {
+        current = next;
+        advance();
+    }
+    out = current;
+    return true;
+}
+
+bool SensorLog::writeBinary(const char* path, const std::vector<SensorSample>& samples) {
+    FILE* out = fopen(path, "wb");
+    if (!out) {
+        std::cout << "Failed to open sensor log for writing: " << path << std::endl;
+        return false;
+    }
+
+    fwrite(SENSOR_LOG_MAGIC, 1, 4, out);
+    fwrite(&SENSOR_LOG_VERSION, sizeof(SENSOR_LOG_VERSION), 1, out);
+    for (const SensorSample& sample : samples) {
+        SensorLogRecord record = {};
+        record.timeMs = (uint32_t)sample.timeMs;
+        record.heartRate = (uint16_t)sample.heartRate;
+        record.pace = (uint16_t)sample.pace;
+        record.battery = (uint8_t)sample.battery;
+        fwrite(&record, sizeof(record), 1, out);
+    }
+    bool ok = ferror(out) == 0;
+    fclose(out);
+    return ok;
+}
@@ -0,0 +1,358 @@
+#include "../Header/ShaderManager.h"
+#include "../Header/MappedFile.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+static const char PROGRAM_CACHE_MAGIC[4] = { 'S', 'G', 'L', 'P' };
+static const uint32_t PROGRAM_CACHE_VERSION = 1;
+static const char* DEFAULT_CACHE_DIR = "shadercache";
+
+// How often sources are compared when inotify is not available
+static const double POLL_INTERVAL = 0.5;
+
+struct ProgramCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t size;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Hashes the terminator too, so "ab" + "c" and "a" + "bc" differ
+static uint64_t fnv1a(uint64_t hash, const std::string& text) {
+    return fnv1a(hash, text.c_str(), text.size() + 1);
+}
+
+static uint64_t hashSources(const std::string& vsSource, const std::string& fsSource) {
+    return fnv1a(fnv1a(14695981039346656037ull, vsSource), fsSource);
+}
+
+static bool readSource(const std::string& path, std::string& out) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "Could not read shader " << path << std::endl;
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    out = buffer.str();
+    return true;
+}
+
+// Logs are sized from GL_INFO_LOG_LENGTH so long ones are not cut off
+static std::string getShaderLog(unsigned int shader) {
+    int length = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+    if (length <= 0) return std::string();
+    std::string log((size_t)length, '\0');
+    glGetShaderInfoLog(shader, length, &length, &log[0]);
+    log.resize((size_t)length);
+    return log;
+}
+
+static std::string getProgramLog(unsigned int program) {
+    int length = 0;
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+    if (length <= 0) return std::string();
+    std::string log((size_t)length, '\0');
+    glGetProgramInfoLog(program, length, &length, &log[0]);
+    log.resize((size_t)length);
+    return log;
+}
+
+static unsigned int compileStage(GLenum type, const char* stage, const std::string& source, const std::string& path) {
+    unsigned int shader = glCreateShader(type);
+    const char* text = source.c_str();
+    glShaderSource(shader, 1, &text, NULL);
+    glCompileShader(shader);
+
+    int success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        std::cout << "ERROR::SHADER::" << stage << "::COMPILATION_FAILED " << path << "\n" << getShaderLog(shader) << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static std::string getGlString(GLenum name) {
+    const char* value = (const char*)glGetString(name);
+    return value ? value : "";
+}
+
+ShaderManager::ShaderManager()
+    : cacheDir(DEFAULT_CACHE_DIR),
+      binarySupported(false),
+      hotReload(false),
+      notifyFd(-1),
+      nextPollTime(0.0) {
+    driver = getGlString(GL_VENDOR) + "\n" + getGlString(GL_RENDERER) + "\n" + getGlString(GL_VERSION);
+
+    // Core in 4.1; a 3.3 context only has it through the extension
+    if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+        int formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        binarySupported = formats > 0;
+    }
+    if (!binarySupported) std::cout << "Program binaries not supported, shaders are compiled on every launch" << std::endl;
+}
+
+ShaderManager::~ShaderManager() {
+#ifdef __linux__
+    if (notifyFd >= 0) close(notifyFd);
+#endif
+}
+
+unsigned int ShaderManager::load(const char* vsPath, const char* fsPath, ShaderReloadCallback onReload, void* data) {
+    Program program;
+    program.vsPath = vsPath;
+    program.fsPath = fsPath;
+    program.onReload = onReload;
+    program.data = data;
+    if (!readSource(program.vsPath, program.vsSource) || !readSource(program.fsPath, program.fsSource)) return 0;
+    program.seenHash = hashSources(program.vsSource, program.fsSource);
+
+    auto start = Clock::now();
+    program.id = glCreateProgram();
+    uint64_t key = getCacheKey(program.vsSource, program.fsSource);
+
+    if (binarySupported && loadBinary(program, key)) {
+        std::cout << "Shader " << vsPath << " + " << fsPath << ": cache hit, " << millisecondsSince(start) << " ms" << std::endl;
+    } else {
+        if (!buildFromSource(program, program.vsSource, program.fsSource)) {
+            glDeleteProgram(program.id);
+            return 0;
+        }
+        if (binarySupported) saveBinary(program, key);
+    }
+
+    programs.push_back(program);
+    if (hotReload) {
+        watch(program.vsPath);
+        watch(program.fsPath);
+    }
+    if (onReload) onReload(data, program.id);
+    return program.id;
+}
+
+std::string ShaderManager::getCachePath(const Program& program) const {
+    uint64_t hash = fnv1a(14695981039346656037ull, program.vsPath);
+    hash = fnv1a(hash, program.fsPath);
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.glprog", (unsigned long long)hash);
+    return cacheDir + "/" + name;
+}
+
+uint64_t ShaderManager::getCacheKey(const std::string& vsSource, const std::string& fsSource) const {
+    return fnv1a(hashSources(vsSource, fsSource), driver);
+}
+
+bool ShaderManager::loadBinary(const Program& program, uint64_t key) {
+    std::string path = getCachePath(program);
+    MappedFile file;
+    if (!file.open(path.c_str())) return false;
+
+    ProgramCacheHeader header;
+    if (file.size() < sizeof(header)) return false;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, PROGRAM_CACHE_MAGIC, 4) != 0 || header.version != PROGRAM_CACHE_VERSION ||
+        header.key != key || header.size != file.size() - sizeof(header)) {
+        return false;
+    }
+
+    glProgramBinary(program.id, header.format, file.data() + sizeof(header), (GLsizei)header.size);
+    int success = 0;
+    glGetProgramiv(program.id, GL_LINK_STATUS, &success);
+    if (!success) std::cout << "Cached shader binary rejected by the driver: " << path << std::endl;
+    return success != 0;
+}
+
+void ShaderManager::saveBinary(const Program& program, uint64_t key) {
+    int length = 0;
+    glGetProgramiv(program.id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<unsigned char> binary((size_t)length);
+    GLenum format = 0;
+    glGetProgramBinary(program.id, length, &length, &format, binary.data());
+
+    ProgramCacheHeader header;
+    memcpy(header.magic, PROGRAM_CACHE_MAGIC, 4);
+    header.version = PROGRAM_CACHE_VERSION;
+    header.key = key;
+    header.format = format;
+    header.size = (uint32_t)length;
+
+    // Written aside and renamed over, so a crash never leaves a torn cache file
+    std::error_code ec;
+    std::filesystem::create_directories(cacheDir, ec);
+    std::string path = getCachePath(program);
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cout << "Failed to write shader cache: " << path << std::endl;
+            return;
+        }
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)binary.data(), length);
+        if (!out) return;
+    }
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) std::cout << "Failed to write shader cache: " << path << std::endl;
+}
+
+bool ShaderManager::buildFromSource(const Program& program, const std::string& vsSource, const std::string& fsSource) {
+    auto start = Clock::now();
+    unsigned int vertexShader = compileStage(GL_VERTEX_SHADER, "VERTEX", vsSource, program.vsPath);
+    unsigned int fragmentShader = compileStage(GL_FRAGMENT_SHADER, "FRAGMENT", fsSource, program.fsPath);
+    double compileMs = millisecondsSince(start);
+    if (!vertexShader || !fragmentShader) {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return false;
+    }
+
+    start = Clock::now();
+    if (binarySupported) glProgramParameteri(program.id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(program.id, vertexShader);
+    glAttachShader(program.id, fragmentShader);
+    glLinkProgram(program.id);
+
+    int success;
+    glGetProgramiv(program.id, GL_LINK_STATUS, &success);
+    double linkMs = millisecondsSince(start);
+
+    // The linked program does not need the shader objects any more
+    glDetachShader(program.id, vertexShader);
+    glDetachShader(program.id, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    if (!success) {
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED " << program.vsPath << " + " << program.fsPath << "\n"
+                  << getProgramLog(program.id) << std::endl;
+        return false;
+    }
+    std::cout << "Shader " << program.vsPath << " + " << program.fsPath << ": compiled in " << compileMs
+              << " ms, linked in " << linkMs << " ms" << std::endl;
+    return true;
+}
+
+bool ShaderManager::reload(Program& program) {
+    std::string vsSource, fsSource;
+    if (!readSource(program.vsPath, vsSource) || !readSource(program.fsPath, fsSource)) return false;
+
+    // Only edits count: touching a file, or saving the same broken version
+    // again, does not rebuild
+    uint64_t hash = hashSources(vsSource, fsSource);
+    if (hash == program.seenHash) return false;
+    program.seenHash = hash;
+
+    if (!buildFromSource(program, vsSource, fsSource)) {
+        // A failed compile never reached the program; a failed link left it
+        // without an executable, so the last good sources go back in
+        int linked = 0;
+        glGetProgramiv(program.id, GL_LINK_STATUS, &linked);
+        if (!linked) buildFromSource(program, program.vsSource, program.fsSource);
+        std::cout << "Keeping the previous version of " << program.vsPath << " + " << program.fsPath << std::endl;
+        return false;
+    }
+
+    program.vsSource = vsSource;
+    program.fsSource = fsSource;
+    if (binarySupported) saveBinary(program, getCacheKey(vsSource, fsSource));
+    if (program.onReload) program.onReload(program.data, program.id);
+    return true;
+}
+
+void ShaderManager::enableHotReload() {
+    if (hotReload) return;
+    hotReload = true;
+#ifdef __linux__
+    notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (notifyFd < 0) std::cout << "inotify not available, polling shader files instead" << std::endl;
+#endif
+    for (const Program& program : programs) {
+        watch(program.vsPath);
+        watch(program.fsPath);
+    }
+}
+
+void ShaderManager::watch(const std::string& path) {
+#ifdef __linux__
+    if (notifyFd < 0) return;
+
+    // Editors often save by renaming a new file over the old one, which a
+    // watch on the file itself would not survive, so the directory is watched
+    std::string dir = std::filesystem::path(path).parent_path().string();
+    if (dir.empty()) dir = ".";
+    if (std::find(watchedDirs.begin(), watchedDirs.end(), dir) != watchedDirs.end()) return;
+
+    if (inotify_add_watch(notifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cout << "Failed to watch shader directory " << dir << ", polling instead" << std::endl;
+        close(notifyFd);
+        notifyFd = -1;
+        return;
+    }
+    watchedDirs.push_back(dir);
+#else
+    (void)path;
+#endif
+}
+
+bool ShaderManager::filesChanged() {
+#ifdef __linux__
+    if (notifyFd >= 0) {
+        // Which file it was does not matter: any write in a watched directory
+        // has every program compare its sources. Timestamps would not do,
+        // two saves within one filesystem clock tick share one.
+        alignas(inotify_event) char buffer[4096];
+        bool changed = false;
+        while (read(notifyFd, buffer, sizeof(buffer)) > 0) changed = true;
+        return changed;
+    }
+#endif
+    double now = std::chrono::duration<double>(Clock::now().time_since_epoch()).count();
+    if (now < nextPollTime) return false;
+    nextPollTime = now + POLL_INTERVAL;
+    return true;
+}
+
+int ShaderManager::pollChanges() {
+    if (!hotReload || !filesChanged()) return 0;
+
+    int relinked = 0;
+    for (Program& program : programs) {
+        if (reload(program)) relinked++;
+    }
+    return relinked;
+}
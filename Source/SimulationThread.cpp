@@ -0,0 +1,92 @@
+#include "../Header/SimulationThread.h"
+#include "../Header/Profiler.h"
+
+SimulationThread::SimulationThread()
+    : jobHead(0), jobTail(0), publishedCount(0), step(nullptr) {
+}
+
+SimulationThread::~SimulationThread() {
+    stop();
+}
+
+void SimulationThread::start(StepFunction stepFunction) {
+    step = stepFunction;
+    worker = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop() {
+    if (!worker.joinable()) return;
+
+    SimulationJob job;
+    job.input.deltaTime = 0.0;
+    job.input.heldKeys = 0;
+    job.advance = false;
+    job.quit = true;
+    submit(job);
+    worker.join();
+}
+
+void SimulationThread::submit(SimulationJob& job) {
+    uint32_t head = jobHead.load(std::memory_order_relaxed);
+    uint32_t tail = jobTail.load(std::memory_order_acquire);
+    while (head - tail >= QUEUE_SIZE) {
+        jobTail.wait(tail, std::memory_order_acquire);
+        tail = jobTail.load(std::memory_order_acquire);
+    }
+
+    SimulationJob& slot = jobs[head % QUEUE_SIZE];
+    slot.input.deltaTime = job.input.deltaTime;
+    slot.input.heldKeys = job.input.heldKeys;
+    slot.input.events.swap(job.input.events);
+    slot.advance = job.advance;
+    slot.quit = job.quit;
+    job.input.events.clear();
+
+    jobHead.store(head + 1, std::memory_order_release);
+    jobHead.notify_one();
+}
+
+const SceneSnapshot& SimulationThread::acquire(uint64_t minFrame) {
+    uint64_t count = publishedCount.load(std::memory_order_acquire);
+    while (count <= minFrame) {
+        PROFILE_SCOPE("Wait for snapshot");
+        publishedCount.wait(count, std::memory_order_acquire);
+        count = publishedCount.load(std::memory_order_acquire);
+    }
+    return snapshots.read();
+}
+
+void SimulationThread::run() {
+    Profiler::get().setThreadName("Simulation");
+
+    uint64_t frame = 0;
+    for (;;) {
+        uint32_t tail = jobTail.load(std::memory_order_relaxed);
+        uint32_t head = jobHead.load(std::memory_order_acquire);
+        if (tail == head) {
+            jobHead.wait(head, std::memory_order_acquire);
+            continue;
+        }
+
+        const SimulationJob& job = jobs[tail % QUEUE_SIZE];
+        bool advance = job.advance;
+        bool quit = job.quit;
+        if (!quit) {
+            SceneSnapshot& out = snapshots.writeSlot();
+            step(job, out);
+            out.frame = frame;
+        }
+
+        // The slot may be reused as soon as the tail moves
+        jobTail.store(tail + 1, std::memory_order_release);
+        jobTail.notify_one();
+        if (quit) break;
+
+        if (advance) {
+            snapshots.publish();
+            frame++;
+            publishedCount.store(frame, std::memory_order_release);
+            publishedCount.notify_one();
+        }
+    }
+}
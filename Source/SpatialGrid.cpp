@@ -0,0 +1,376 @@
+#include "../Header/SpatialGrid.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+SpatialGrid::SpatialGrid(float cellSize, int bucketCount)
+    : cellSize(cellSize),
+      inverseCellSize(1.0f / cellSize),
+      bucketMask(0),
+      origin(0.0f),
+      freeEntries(-1),
+      entryCount(0) {
+    // Round up to a power of two so the hash is a mask
+    int size = 1;
+    while (size < bucketCount) size <<= 1;
+    bucketMask = size - 1;
+    buckets.assign(size, -1);
+    usedMin = glm::vec3(1e30f);
+    usedMax = glm::vec3(-1e30f);
+}
+
+glm::ivec2 SpatialGrid::cellOf(float x, float z) const {
+    return glm::ivec2((int)floorf(x * inverseCellSize), (int)floorf(z * inverseCellSize));
+}
+
+int SpatialGrid::bucketOf(const glm::ivec2& cell) const {
+    // Neighbouring cells must not share buckets: the xor of two products
+    // collided on about a third of the cells a frustum query walks
+    uint32_t h = (uint32_t)cell.x * 0x9E3779B1u + (uint32_t)cell.y * 0x85EBCA77u;
+    h ^= h >> 16;
+    h *= 0x7FEB352Du;
+    return (int)((h ^ (h >> 15)) & (uint32_t)bucketMask);
+}
+
+void SpatialGrid::link(int handle) {
+    Object& object = objects[handle];
+    object.cellMin = cellOf(object.boxMin.x, object.boxMin.z);
+    object.cellMax = cellOf(object.boxMax.x, object.boxMax.z);
+    object.firstEntry = -1;
+
+    for (int cz = object.cellMin.y; cz <= object.cellMax.y; cz++) {
+        for (int cx = object.cellMin.x; cx <= object.cellMax.x; cx++) {
+            int index;
+            if (freeEntries >= 0) {
+                index = freeEntries;
+                freeEntries = entries[index].next;
+            } else {
+                index = (int)entries.size();
+                entries.emplace_back();
+            }
+
+            Entry& entry = entries[index];
+            entry.object = handle;
+            entry.cell = glm::ivec2(cx, cz);
+            entry.objectCellMin = object.cellMin;
+            entry.bucket = bucketOf(entry.cell);
+            entry.prev = -1;
+            entry.next = buckets[entry.bucket];
+            if (entry.next >= 0) entries[entry.next].prev = index;
+            buckets[entry.bucket] = index;
+
+            entry.nextOfObject = object.firstEntry;
+            object.firstEntry = index;
+            entryCount++;
+        }
+    }
+
+    // Keep bucket lists about one entry long
+    if (entryCount > (int)buckets.size()) rehash((int)buckets.size() * 2);
+
+    usedMin = glm::min(usedMin, object.boxMin);
+    usedMax = glm::max(usedMax, object.boxMax);
+}
+
+void SpatialGrid::unlink(int handle) {
+    Object& object = objects[handle];
+    int index = object.firstEntry;
+    while (index >= 0) {
+        Entry& entry = entries[index];
+        if (entry.prev >= 0) entries[entry.prev].next = entry.next;
+        else buckets[entry.bucket] = entry.next;
+        if (entry.next >= 0) entries[entry.next].prev = entry.prev;
+
+        int nextOfObject = entry.nextOfObject;
+        entryCount--;
+        entry.object = -1;
+        entry.next = freeEntries;
+        freeEntries = index;
+        index = nextOfObject;
+    }
+    object.firstEntry = -1;
+}
+
+void SpatialGrid::rehash(int bucketCount) {
+    bucketMask = bucketCount - 1;
+    buckets.assign(bucketCount, -1);
+    for (int index = 0; index < (int)entries.size(); index++) {
+        Entry& entry = entries[index];
+        if (entry.object < 0) continue;
+        entry.bucket = bucketOf(entry.cell);
+        entry.prev = -1;
+        entry.next = buckets[entry.bucket];
+        if (entry.next >= 0) entries[entry.next].prev = index;
+        buckets[entry.bucket] = index;
+    }
+}
+
+int SpatialGrid::insert(const glm::vec3& boxMin, const glm::vec3& boxMax, int userData) {
+    int handle;
+    if (!freeObjects.empty()) {
+        handle = freeObjects.back();
+        freeObjects.pop_back();
+    } else {
+        handle = (int)objects.size();
+        objects.emplace_back();
+    }
+
+    Object& object = objects[handle];
+    object.boxMin = boxMin;
+    object.boxMax = boxMax;
+    object.userData = userData;
+    link(handle);
+    return handle;
+}
+
+void SpatialGrid::move(int handle, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+    Object& object = objects[handle];
+    object.boxMin = boxMin;
+    object.boxMax = boxMax;
+
+    // Moves within the same cells only touch the object
+    if (cellOf(boxMin.x, boxMin.z) == object.cellMin && cellOf(boxMax.x, boxMax.z) == object.cellMax) {
+        usedMin = glm::min(usedMin, boxMin);
+        usedMax = glm::max(usedMax, boxMax);
+        return;
+    }
+    unlink(handle);
+    link(handle);
+}
+
+void SpatialGrid::remove(int handle) {
+    unlink(handle);
+    freeObjects.push_back(handle);
+}
+
+void SpatialGrid::clear() {
+    std::fill(buckets.begin(), buckets.end(), -1);
+    entries.clear();
+    objects.clear();
+    freeObjects.clear();
+    freeEntries = -1;
+    entryCount = 0;
+    usedMin = glm::vec3(1e30f);
+    usedMax = glm::vec3(-1e30f);
+}
+
+template<typename F>
+void SpatialGrid::forEachInCells(const glm::ivec2& cellMin, const glm::ivec2& cellMax, const F& visit) const {
+    if (usedMin.x > usedMax.x) return;
+
+    // Never walk cells outside everything that was ever inserted
+    glm::ivec2 rangeMin = glm::max(cellMin, cellOf(usedMin.x, usedMin.z));
+    glm::ivec2 rangeMax = glm::min(cellMax, cellOf(usedMax.x, usedMax.z));
+
+    for (int cz = rangeMin.y; cz <= rangeMax.y; cz++) {
+        for (int cx = rangeMin.x; cx <= rangeMax.x; cx++) {
+            glm::ivec2 cell(cx, cz);
+            for (int index = buckets[bucketOf(cell)]; index >= 0; index = entries[index].next) {
+                const Entry& entry = entries[index];
+                if (entry.cell != cell) continue;
+
+                // Report an object only from the first of its cells inside the range
+                if (cx != std::max(entry.objectCellMin.x, rangeMin.x) || cz != std::max(entry.objectCellMin.y, rangeMin.y)) continue;
+                visit(objects[entry.object]);
+            }
+        }
+    }
+}
+
+template<typename F>
+void SpatialGrid::forEachInSpans(int firstRow, const std::vector<glm::ivec2>& spans, const F& visit) const {
+    int rowCount = (int)spans.size();
+    for (int r = 0; r < rowCount; r++) {
+        int cz = firstRow + r;
+        for (int cx = spans[r].x; cx <= spans[r].y; cx++) {
+            glm::ivec2 cell(cx, cz);
+            for (int index = buckets[bucketOf(cell)]; index >= 0; index = entries[index].next) {
+                const Entry& entry = entries[index];
+                if (entry.cell != cell) continue;
+                const Object& object = objects[entry.object];
+
+                // An object's own first cell always comes first; otherwise find
+                // the first of its cells that the spans cover
+                if (cell != entry.objectCellMin) {
+                    bool first = false;
+                    for (int oz = std::max(entry.objectCellMin.y, firstRow); oz <= cz; oz++) {
+                        const glm::ivec2& span = spans[oz - firstRow];
+                        int x0 = std::max(span.x, entry.objectCellMin.x);
+                        if (x0 > std::min(span.y, object.cellMax.x)) continue;
+                        first = oz == cz && x0 == cx;
+                        break;
+                    }
+                    if (!first) continue;
+                }
+                visit(object);
+            }
+        }
+    }
+}
+
+void SpatialGrid::queryAabb(const glm::vec3& boxMin, const glm::vec3& boxMax, std::vector<int>& out) const {
+    glm::vec3 localMin = boxMin - origin;
+    glm::vec3 localMax = boxMax - origin;
+    forEachInCells(cellOf(localMin.x, localMin.z), cellOf(localMax.x, localMax.z), [&](const Object& object) {
+        if (object.boxMin.x <= localMax.x && object.boxMin.y <= localMax.y && object.boxMin.z <= localMax.z &&
+            localMin.x <= object.boxMax.x && localMin.y <= object.boxMax.y && localMin.z <= object.boxMax.z) {
+            out.push_back(object.userData);
+        }
+    });
+}
+
+void SpatialGrid::queryRadius(const glm::vec3& center, float radius, std::vector<int>& out) const {
+    glm::vec3 local = center - origin;
+    glm::vec3 extent(radius);
+    glm::vec3 localMin = local - extent;
+    glm::vec3 localMax = local + extent;
+    float radiusSq = radius * radius;
+    forEachInCells(cellOf(localMin.x, localMin.z), cellOf(localMax.x, localMax.z), [&](const Object& object) {
+        glm::vec3 closest = glm::clamp(local, object.boxMin, object.boxMax);
+        glm::vec3 d = closest - local;
+        if (glm::dot(d, d) <= radiusSq) out.push_back(object.userData);
+    });
+}
+
+void SpatialGrid::queryFrustum(const glm::mat4& viewProj, std::vector<int>& out, float maxDistance) const {
+    if (usedMin.x > usedMax.x) return;
+
+    // Planes in grid space: shifting by the origin folds into the matrix
+    glm::mat4 m = glm::translate(viewProj, origin);
+    glm::vec4 rowX(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 rowY(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 rowZ(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 rowW(m[0][3], m[1][3], m[2][3], m[3][3]);
+    glm::vec4 planes[6] = { rowW + rowX, rowW - rowX, rowW + rowY, rowW - rowY, rowW + rowZ, rowW - rowZ };
+
+    // Corners, far ones pulled in to maxDistance from the near plane
+    glm::vec3 nearNormal(planes[4]);
+    float nearScale = 1.0f / glm::length(nearNormal);
+    glm::mat4 inverse = glm::inverse(m);
+    glm::vec3 corners[8];
+    for (int i = 0; i < 8; i++) {
+        glm::vec4 corner = inverse * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f, 1.0f);
+        corners[i] = glm::vec3(corner) / corner.w;
+    }
+    if (maxDistance > 0.0f) {
+        float farDistance = (glm::dot(nearNormal, corners[4]) + planes[4].w) * nearScale;
+        if (farDistance > maxDistance) {
+            float t = maxDistance / farDistance;
+            for (int i = 0; i < 4; i++) corners[i + 4] = corners[i] + (corners[i + 4] - corners[i]) * t;
+            // The far plane moves with them: distance from the near plane <= maxDistance
+            planes[5] = glm::vec4(-nearNormal, maxDistance / nearScale - planes[4].w);
+        }
+    }
+
+    glm::vec2 cornerMin(1e30f), cornerMax(-1e30f);
+    for (const glm::vec3& corner : corners) {
+        cornerMin = glm::min(cornerMin, glm::vec2(corner.x, corner.z));
+        cornerMax = glm::max(cornerMax, glm::vec2(corner.x, corner.z));
+    }
+    glm::ivec2 rangeMin = glm::max(cellOf(cornerMin.x, cornerMin.y), cellOf(usedMin.x, usedMin.z));
+    glm::ivec2 rangeMax = glm::min(cellOf(cornerMax.x, cornerMax.y), cellOf(usedMax.x, usedMax.z));
+    if (rangeMin.x > rangeMax.x || rangeMin.y > rangeMax.y) return;
+
+    // Outside if the corner furthest along a plane's normal is behind it
+    auto boxVisible = [&](const glm::vec3& boxMin, const glm::vec3& boxMax) {
+        for (const glm::vec4& plane : planes) {
+            glm::vec3 p(plane.x >= 0.0f ? boxMax.x : boxMin.x,
+                        plane.y >= 0.0f ? boxMax.y : boxMin.y,
+                        plane.z >= 0.0f ? boxMax.z : boxMin.z);
+            if (plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w < 0.0f) return false;
+        }
+        return true;
+    };
+
+    // Rasterize the footprint: per row of cells, the run whose columns are
+    // not entirely behind one plane. Each plane keeps a contiguous run of a
+    // row, so their intersection is one run too.
+    std::vector<glm::ivec2> spans(rangeMax.y - rangeMin.y + 1);
+    for (int cz = rangeMin.y; cz <= rangeMax.y; cz++) {
+        auto columnVisible = [&](int cx) {
+            return boxVisible(glm::vec3(cx * cellSize, usedMin.y, cz * cellSize),
+                              glm::vec3((cx + 1) * cellSize, usedMax.y, (cz + 1) * cellSize));
+        };
+        int x0 = rangeMin.x, x1 = rangeMax.x;
+        while (x0 <= x1 && !columnVisible(x0)) x0++;
+        while (x1 > x0 && !columnVisible(x1)) x1--;
+        spans[cz - rangeMin.y] = glm::ivec2(x0, x1);
+    }
+
+    forEachInSpans(rangeMin.y, spans, [&](const Object& object) {
+        if (boxVisible(object.boxMin, object.boxMax)) out.push_back(object.userData);
+    });
+}
+
+// Slab test, clipped to [0, tLimit]
+static bool rayBox(const glm::vec3& o, const glm::vec3& invDir, const glm::vec3& boxMin, const glm::vec3& boxMax,
+                   float tLimit, float& tEnter, float& tExit) {
+    glm::vec3 t0 = (boxMin - o) * invDir;
+    glm::vec3 t1 = (boxMax - o) * invDir;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    tEnter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tLimit));
+    return tEnter <= tExit;
+}
+
+bool SpatialGrid::raycast(const glm::vec3& rayOrigin, const glm::vec3& direction, float maxDistance,
+                          int& outUserData, float& outDistance) const {
+    if (usedMin.x > usedMax.x) return false;
+
+    glm::vec3 o = rayOrigin - origin;
+    glm::vec3 invDir(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+    // Only walk the part of the ray inside the used area
+    float tStart, tEnd;
+    if (!rayBox(o, invDir, usedMin, usedMax, maxDistance, tStart, tEnd)) return false;
+
+    // Amanatides-Woo walk over the xz cells
+    glm::vec3 start = o + direction * tStart;
+    glm::ivec2 cell = cellOf(start.x, start.z);
+    int stepX = direction.x > 0.0f ? 1 : -1;
+    int stepZ = direction.z > 0.0f ? 1 : -1;
+    float nextX = (cell.x + (stepX > 0 ? 1 : 0)) * cellSize;
+    float nextZ = (cell.y + (stepZ > 0 ? 1 : 0)) * cellSize;
+    float tMaxX = direction.x != 0.0f ? tStart + (nextX - start.x) * invDir.x : 1e30f;
+    float tMaxZ = direction.z != 0.0f ? tStart + (nextZ - start.z) * invDir.z : 1e30f;
+    float tDeltaX = direction.x != 0.0f ? cellSize * fabsf(invDir.x) : 1e30f;
+    float tDeltaZ = direction.z != 0.0f ? cellSize * fabsf(invDir.z) : 1e30f;
+
+    bool found = false;
+    float best = maxDistance;
+    int bestUserData = 0;
+    float tCell = tStart;
+    while (tCell <= tEnd) {
+        for (int index = buckets[bucketOf(cell)]; index >= 0; index = entries[index].next) {
+            const Entry& entry = entries[index];
+            if (entry.cell != cell) continue;
+            const Object& object = objects[entry.object];
+            float tEnter, tExit;
+            if (rayBox(o, invDir, object.boxMin, object.boxMax, best, tEnter, tExit) && (!found || tEnter < best)) {
+                found = true;
+                best = tEnter;
+                bestUserData = object.userData;
+            }
+        }
+
+        // A hit inside this cell cannot be beaten by later cells
+        float tExit = std::min(tMaxX, tMaxZ);
+        if (found && best <= tExit) break;
+
+        if (tMaxX < tMaxZ) {
+            cell.x += stepX;
+            tMaxX += tDeltaX;
+        } else {
+            cell.y += stepZ;
+            tMaxZ += tDeltaZ;
+        }
+        tCell = tExit;
+    }
+
+    if (!found) return false;
+    outUserData = bestUserData;
+    outDistance = best;
+    return true;
+}
@@ -1,9 +1,20 @@
 #include "../Header/Street.h"
 #include "../Header/Util.h"
+#include "../Header/Profiler.h"
+#include "../Header/JobSystem.h"
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+// Occluder selection for the software occlusion pass
+const float OCCLUDER_DISTANCE = 40.0f;
+const int MAX_OCCLUDERS = 16;
+const float OCCLUDER_SHRINK_XZ = 0.8f;
+const float OCCLUDER_SHRINK_Y = 0.9f;
 
 Street::Street()
-    : simulation(nullptr), roadTexture(0) {
+    : roadWidth(0.0f), simulation(nullptr), gridEnd(0), buildingReach(0.0f), buildingTop(0.0f), renderOffset(0.0f) {
     // Initialize cached materials
     materials.groundKD = glm::vec3(0.2f, 0.6f, 0.15f);
     materials.groundKA = glm::vec3(0.1f, 0.25f, 0.08f);
@@ -24,35 +35,244 @@ Street::Street()
 Street::~Street() {
     groundPlane.cleanup();
     roadSegment.cleanup();
-    for (auto* building : buildingModels) {
-        delete building;
-    }
     delete simulation;
 }
 
-void Street::init(float roadWidth, float segmentLength, int numSegments) {
+void Street::init(ResourceManager& resources, float roadWidth, float segmentLength, float viewDistance) {
+    this->roadWidth = roadWidth;
+
     // Create geometry
     groundPlane = Geometry::createGroundPlane(200.0f, 400.0f, 50);
     roadSegment = Geometry::createRoadSegment(roadWidth, segmentLength);
 
-    roadTexture = loadImageToTexture("Resources/road.jpg");
+    roadTexture = resources.acquireTexture("Resources/road.jpg");
 
-    buildingModels.push_back(new Model("Resources/ChonkyBuilding/chonky_buildingA.obj"));
-    buildingModels.push_back(new Model("Resources/Skyscraper/skyscraperE.obj"));
-    buildingModels.push_back(new Model("Resources/TallBuilding/tall_buildingC.obj"));
-    buildingModels.push_back(new Model("Resources/Large Building/large_buildingE.obj"));
+    buildingModels.push_back(resources.acquireModel("Resources/ChonkyBuilding/chonky_buildingA.obj"));
+    buildingModels.push_back(resources.acquireModel("Resources/Skyscraper/skyscraperE.obj"));
+    buildingModels.push_back(resources.acquireModel("Resources/TallBuilding/tall_buildingC.obj"));
+    buildingModels.push_back(resources.acquireModel("Resources/Large Building/large_buildingE.obj"));
+
+    buildingBvhs.resize(buildingModels.size());
+    for (size_t i = 0; i < buildingModels.size(); i++) {
+        if (!buildingModels[i].valid()) continue;
+        buildingBvhs[i].addModel(*buildingModels[i].model());
+        buildingBvhs[i].build();
+    }
 
     // Initialize simulation
-    simulation = new RunningSimulation(segmentLength, numSegments);
+    int numSegments = (int)ceilf((viewDistance + 20.0f) / segmentLength);
+    simulation = new RunningSimulation(segmentLength, numSegments, viewDistance);
+    syncGrid();
 }
 
 void Street::update(double deltaTime, bool isRunning) {
+    PROFILE_SCOPE("Street::update");
     if (simulation) {
         simulation->update(deltaTime, isRunning);
+        syncGrid();
+    }
+}
+
+void Street::setCitySeed(uint32_t seed) {
+    if (!simulation) return;
+    simulation->setSeed(seed);
+
+    // Serial numbers restart with the new city
+    buildingGrid.clear();
+    gridHandles.clear();
+    gridEnd = 0;
+    buildingReach = 0.0f;
+    buildingTop = 0.0f;
+    syncGrid();
+}
+
+void Street::syncGrid() {
+    BuildingView buildings = simulation->getBuildings();
+    int64_t first = simulation->getFirstBuildingSerial();
+    int64_t gridFirst = gridEnd - (int64_t)gridHandles.size();
+
+    for (; gridFirst < first && !gridHandles.empty(); gridFirst++) {
+        buildingGrid.remove(gridHandles.front());
+        gridHandles.pop_front();
+    }
+
+    // Stored relative to the distance run, which is where they stay
+    glm::vec3 toTrack(0.0f, 0.0f, -(float)simulation->getDistance() - renderOffset);
+    for (int64_t end = first + buildings.size(); gridEnd < end; gridEnd++) {
+        glm::vec3 bMin, bMax;
+        getBuildingBounds(buildings, (int)(gridEnd - first), bMin, bMax);
+        buildingReach = std::max(buildingReach, std::max(-bMin.x, bMax.x));
+        buildingTop = std::max(buildingTop, bMax.y);
+        gridHandles.push_back(buildingGrid.insert(bMin + toTrack, bMax + toTrack, (int)gridEnd));
+    }
+}
+
+void Street::setRenderAlpha(float alpha) {
+    // Everything moves by the same amount per step, so one offset covers it.
+    // Recycled pieces jump far behind the camera where the error is invisible.
+    renderOffset = simulation ? -(1.0f - alpha) * simulation->getLastMovement() : 0.0f;
+}
+
+void Street::getBuildingBounds(const BuildingView& buildings, int i, glm::vec3& outMin, glm::vec3& outMax) const {
+    const Model* model = buildingModels[buildings.type[i]].model();
+    glm::vec3 localMin = model->getBoundsMin() * buildings.scale[i];
+    glm::vec3 localMax = model->getBoundsMax() * buildings.scale[i];
+    glm::vec3 center = (localMin + localMax) * 0.5f;
+    glm::vec3 half = (localMax - localMin) * 0.5f;
+
+    // Box around the box rotated about y
+    float c = cosf(buildings.rotation[i]);
+    float s = sinf(buildings.rotation[i]);
+    glm::vec3 position(buildings.x[i] + center.x * c + center.z * s,
+                       buildings.y[i] + center.y,
+                       buildings.z[i] + renderOffset - center.x * s + center.z * c);
+    glm::vec3 extent(fabsf(c) * half.x + fabsf(s) * half.z, half.y, fabsf(s) * half.x + fabsf(c) * half.z);
+    outMin = position - extent;
+    outMax = position + extent;
+}
+
+float Street::getCullDistance(const BuildingView& buildings, const glm::vec3& cameraPos) const {
+    if (buildings.size() == 0) return 0.0f;
+
+    // The far plane usually lies well past both ends of the street. Street
+    // order is chunk order, so the end buildings are within a chunk of them.
+    glm::vec3 backMin, backMax, frontMin, frontMax;
+    getBuildingBounds(buildings, 0, backMin, backMax);
+    getBuildingBounds(buildings, (int)buildings.size() - 1, frontMin, frontMax);
+    float zMin = std::min(backMin.z, frontMin.z) - CITY_CHUNK_LENGTH;
+    float zMax = std::max(backMax.z, frontMax.z) + CITY_CHUNK_LENGTH;
+
+    // Distance to the furthest corner of everything built
+    glm::vec3 far(fabsf(cameraPos.x) + buildingReach,
+                  std::max(fabsf(cameraPos.y), fabsf(buildingTop - cameraPos.y)),
+                  std::max(fabsf(cameraPos.z - zMin), fabsf(zMax - cameraPos.z)));
+    return glm::length(far);
+}
+
+glm::mat4 Street::getBuildingMatrix(const BuildingView& buildings, int i) const {
+    glm::vec3 position(buildings.x[i], buildings.y[i], buildings.z[i] + renderOffset);
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+    model = glm::rotate(model, buildings.rotation[i], glm::vec3(0.0f, 1.0f, 0.0f));
+    return glm::scale(model, glm::vec3(buildings.scale[i]));
+}
+
+void Street::addPickTargets(PickScene& scene, int firstObject) const {
+    if (!simulation) return;
+    BuildingView buildings = simulation->getBuildings();
+    for (int i = 0; i < (int)buildings.size(); i++) {
+        scene.add(firstObject + i, &buildingBvhs[buildings.type[i]], getBuildingMatrix(buildings, i));
     }
 }
 
-void Street::render(const ShaderUniforms& uniforms) const {
+void Street::buildDrawList(const glm::mat4& viewProj, const glm::vec3& cameraPos, StreetDrawList& out) {
+    PROFILE_SCOPE("Street::buildDrawList");
+    BuildingView buildings = simulation->getBuildings();
+    occlusionCuller.beginFrame(viewProj);
+
+    int first = (int)simulation->getFirstBuildingSerial();
+    buildingGrid.setOrigin(glm::vec3(0.0f, 0.0f, (float)simulation->getDistance() + renderOffset));
+
+    // Nearest buildings act as occluders for everything behind them
+    std::vector<std::pair<float, int>> occluders;
+    queryResults.clear();
+    buildingGrid.queryRadius(cameraPos, OCCLUDER_DISTANCE, queryResults);
+    for (int serial : queryResults) {
+        int i = serial - first;
+        float dist = glm::length(buildings.position(i) + glm::vec3(0.0f, 0.0f, renderOffset) - cameraPos);
+        if (dist < OCCLUDER_DISTANCE) occluders.push_back({ dist, i });
+    }
+    std::sort(occluders.begin(), occluders.end());
+    if ((int)occluders.size() > MAX_OCCLUDERS) occluders.resize(MAX_OCCLUDERS);
+
+    for (const auto& occ : occluders) {
+        glm::vec3 bMin, bMax;
+        getBuildingBounds(buildings, occ.second, bMin, bMax);
+
+        // Shrink the proxy so it stays inside the real silhouette
+        glm::vec3 center = (bMin + bMax) * 0.5f;
+        glm::vec3 half = (bMax - bMin) * 0.5f;
+        half.x *= OCCLUDER_SHRINK_XZ;
+        half.z *= OCCLUDER_SHRINK_XZ;
+        glm::vec3 proxyMin = center - half;
+        glm::vec3 proxyMax = center + half;
+        proxyMax.y = bMin.y + (bMax.y - bMin.y) * OCCLUDER_SHRINK_Y;
+
+        occlusionCuller.addOccluder(proxyMin, proxyMax);
+    }
+    occlusionCuller.buildHierarchy();
+
+    out.segments.clear();
+    for (float zPos : simulation->getSegmentPositions()) out.segments.push_back(zPos + renderOffset);
+
+    // Side streets start at the road edge and run away from it
+    out.sideStreets.clear();
+    float roadEdge = roadWidth * 0.5f;
+    for (const SideStreet& street : simulation->getSideStreets()) {
+        for (int side = -1; side <= 1; side += 2) {
+            if (street.side != 0 && street.side != side) continue;
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(side * roadEdge, 0.01f, street.z + renderOffset));
+            out.sideStreets.push_back(glm::rotate(model, glm::radians(-90.0f * side), glm::vec3(0.0f, 1.0f, 0.0f)));
+        }
+    }
+
+    // Only buildings in the frustum reach the occlusion test. Street order
+    // keeps the draw list independent of the grid's internal layout.
+    queryResults.clear();
+    buildingGrid.queryFrustum(viewProj, queryResults, getCullDistance(buildings, cameraPos));
+    for (int& serial : queryResults) serial -= first;
+    std::sort(queryResults.begin(), queryResults.end());
+
+    // Visibility tests only read the finished hierarchy, so ranges run in parallel
+    int count = (int)queryResults.size();
+    candidates.resize(count);
+    candidateVisible.resize(count);
+    JobSystem::get().parallelFor(count, 64, [&](int begin, int end) {
+        for (int c = begin; c < end; c++) {
+            int i = queryResults[c];
+            glm::vec3 bMin, bMax;
+            getBuildingBounds(buildings, i, bMin, bMax);
+            candidateVisible[c] = occlusionCuller.isVisible(bMin, bMax) ? 1 : 0;
+            if (!candidateVisible[c]) continue;
+
+            int type = buildings.type[i];
+            glm::vec3 position(buildings.x[i], buildings.y[i], buildings.z[i] + renderOffset);
+            StreetDrawList::Building& draw = candidates[c];
+            draw.index = i;
+            draw.type = type;
+
+            // Model in the high bits, distance below; non-negative floats order like their bits
+            float dist = glm::length(position - cameraPos);
+            uint32_t distBits;
+            memcpy(&distBits, &dist, sizeof(distBits));
+            draw.sortKey = ((uint64_t)type << 32) | distBits;
+        }
+    });
+
+    out.buildings.clear();
+    for (int c = 0; c < count; c++) {
+        if (candidateVisible[c]) out.buildings.push_back(candidates[c]);
+    }
+    std::sort(out.buildings.begin(), out.buildings.end(),
+              [](const StreetDrawList::Building& a, const StreetDrawList::Building& b) { return a.sortKey < b.sortKey; });
+
+    // Gather in draw order, then build every matrix in one batch
+    instanceInputs.clear();
+    for (const StreetDrawList::Building& draw : out.buildings) {
+        int i = draw.index;
+        instanceInputs.x.push_back(buildings.x[i]);
+        instanceInputs.y.push_back(buildings.y[i]);
+        instanceInputs.z.push_back(buildings.z[i] + renderOffset);
+        instanceInputs.rotation.push_back(buildings.rotation[i]);
+        instanceInputs.scale.push_back(buildings.scale[i]);
+    }
+    out.instances.resize(out.buildings.size());
+    composeYawTransforms(instanceInputs.x.data(), instanceInputs.y.data(), instanceInputs.z.data(),
+                         instanceInputs.rotation.data(), instanceInputs.scale.data(),
+                         (int)out.instances.size(), out.instances.data());
+}
+
+void Street::render(const ShaderUniforms& uniforms, const StreetDrawList& drawList) const {
+    PROFILE_SCOPE("Street::render");
     // Render ground plane
     glm::mat4 groundModel = glm::mat4(1.0f);
     uniforms.setModelMatrix(groundModel);
@@ -62,27 +282,35 @@ void Street::render(const ShaderUniforms& uniforms) const {
 
     // Render road segments
     uniforms.setMaterial(materials.roadKD, materials.roadKA, materials.roadKS, materials.roadShine);
-    uniforms.setTexture(true, roadTexture);
+    uniforms.setTexture(true, roadTexture.texture());
 
-    for (float zPos : simulation->getSegmentPositions()) {
+    for (float zPos : drawList.segments) {
         glm::mat4 segmentModel = glm::mat4(1.0f);
         segmentModel = glm::translate(segmentModel, glm::vec3(0.0f, 0.01f, zPos));
         uniforms.setModelMatrix(segmentModel);
         roadSegment.draw();
     }
+    for (const auto& model : drawList.sideStreets) {
+        uniforms.setModelMatrix(model);
+        roadSegment.draw();
+    }
     uniforms.setTexture(false);
 
     // Render buildings with per-material colors from MTL
-    const auto& buildings = simulation->getBuildings();
-    for (const auto& b : buildings) {
-        glm::mat4 bModel = glm::mat4(1.0f);
-        bModel = glm::translate(bModel, b.position);
-        bModel = glm::scale(bModel, glm::vec3(b.scale));
-        uniforms.setModelMatrix(bModel);
-        buildingModels[b.type]->drawWithMaterials(uniforms);
+    for (size_t k = 0; k < drawList.buildings.size(); k++) {
+        uniforms.setModelMatrix(drawList.instances[k].model);
+        buildingModels[drawList.buildings[k].type].model()->drawWithMaterials(uniforms);
     }
 }
 
 const std::vector<float>& Street::getSegmentPositions() const {
     return simulation->getSegmentPositions();
 }
+
+BuildingView Street::getBuildings() const {
+    return simulation->getBuildings();
+}
+
+float Street::getRunningSpeed() const {
+    return simulation->getIsRunning() ? simulation->getSpeed() : 0.0f;
+}
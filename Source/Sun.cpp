@@ -4,7 +4,6 @@
 
 Sun::Sun()
     : meshReady(false),
-      texture(0),
       position(-20.0f, 50.0f, -70.0f),
       scale(10.0f),
       ambient(0.35f, 0.35f, 0.35f),
@@ -16,10 +15,10 @@ Sun::~Sun() {
     if (meshReady) sunMesh.cleanup();
 }
 
-void Sun::init(const char* texturePath) {
+void Sun::init(ResourceManager& resources, const char* texturePath) {
     sunMesh = Geometry::createSphere(32, 32);
     meshReady = true;
-    texture = loadImageToTexture(texturePath);
+    texture = resources.acquireTexture(texturePath);
 }
 
 void Sun::render(const ShaderUniforms& uniforms) const {
@@ -38,7 +37,7 @@ void Sun::render(const ShaderUniforms& uniforms) const {
         1.0f
     );
 
-    uniforms.setTexture(true, texture);
+    uniforms.setTexture(true, texture.texture());
     sunMesh.draw();
     uniforms.setTexture(false);
 }
@@ -0,0 +1,184 @@
+#include "../Header/TextureAtlas.h"
+#include "../Header/TextureCache.h"
+#include "../Header/stb_image.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <iostream>
+
+static int alignUp(int value, int alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+TextureAtlas::TextureAtlas(int padding, int maxImageSize)
+    : padding(padding),
+      maxImageSize(maxImageSize),
+      atlasWidth(0), atlasHeight(0),
+      texture(0) {
+}
+
+TextureAtlas::~TextureAtlas() {
+    if (texture) glDeleteTextures(1, &texture);
+}
+
+int TextureAtlas::addImage(const std::string& name, const char* filePath) {
+    int w, h, channels;
+    unsigned char* data = stbi_load(filePath, &w, &h, &channels, 4);
+    if (!data) {
+        std::cout << "Texture access failed: " << filePath << std::endl;
+        return -1;
+    }
+
+    Image img;
+    img.name = name;
+    img.width = w;
+    img.height = h;
+    img.pixels.assign(data, data + (size_t)w * h * 4);
+    img.x = img.y = 0;
+    stbi_image_free(data);
+
+    // UI icons are drawn tiny, halve oversized sources with a box filter
+    while (img.width > maxImageSize || img.height > maxImageSize) {
+        std::vector<unsigned char> half;
+        downsampleImage(img.pixels.data(), img.width, img.height, 4, half, img.width, img.height);
+        img.pixels.swap(half);
+    }
+
+    int id = (int)images.size();
+    images.push_back(std::move(img));
+    lookup[name] = id;
+    return id;
+}
+
+int TextureAtlas::findRegion(const std::string& name) const {
+    auto it = lookup.find(name);
+    return it != lookup.end() ? it->second : -1;
+}
+
+int TextureAtlas::findPosition(const std::vector<SkylineNode>& skyline, int w, int h, int limitW, int limitH, int& outX, int& outY) const {
+    int bestIndex = -1;
+    int bestY = limitH, bestX = limitW;
+
+    for (int i = 0; i < (int)skyline.size(); i++) {
+        int x = skyline[i].x;
+        if (x + w > limitW) break;
+
+        // Resting height is the tallest node under the rectangle
+        int y = 0, covered = 0;
+        for (int j = i; j < (int)skyline.size() && covered < w; j++) {
+            y = std::max(y, skyline[j].y);
+            covered += skyline[j].width;
+        }
+        if (y + h > limitH) continue;
+
+        if (y < bestY || (y == bestY && x < bestX)) {
+            bestIndex = i;
+            bestY = y;
+            bestX = x;
+        }
+    }
+
+    outX = bestX;
+    outY = bestY;
+    return bestIndex;
+}
+
+bool TextureAtlas::pack(int width, int height) {
+    std::vector<int> order(images.size());
+    for (int i = 0; i < (int)order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [this](int a, int b) { return images[a].height > images[b].height; });
+
+    std::vector<SkylineNode> skyline = { { 0, 0, width } };
+
+    for (int id : order) {
+        Image& img = images[id];
+        int w = alignUp(img.width + 2 * padding, padding);
+        int h = alignUp(img.height + 2 * padding, padding);
+
+        int x, y;
+        int index = findPosition(skyline, w, h, width, height, x, y);
+        if (index < 0) return false;
+
+        img.x = x;
+        img.y = y;
+
+        // Raise the skyline under the new rectangle
+        SkylineNode node = { x, y + h, w };
+        skyline.insert(skyline.begin() + index, node);
+        for (int i = index + 1; i < (int)skyline.size(); ) {
+            int overlap = (node.x + node.width) - skyline[i].x;
+            if (overlap <= 0) break;
+            if (overlap >= skyline[i].width) {
+                skyline.erase(skyline.begin() + i);
+            } else {
+                skyline[i].x += overlap;
+                skyline[i].width -= overlap;
+                break;
+            }
+        }
+        for (int i = 0; i + 1 < (int)skyline.size(); ) {
+            if (skyline[i].y == skyline[i + 1].y) {
+                skyline[i].width += skyline[i + 1].width;
+                skyline.erase(skyline.begin() + i + 1);
+            } else {
+                i++;
+            }
+        }
+    }
+    return true;
+}
+
+bool TextureAtlas::build() {
+    if (images.empty()) return false;
+
+    int width = 128, height = 128;
+    while (!pack(width, height)) {
+        if (width > height) height *= 2;
+        else width *= 2;
+        if (width > 4096 || height > 4096) {
+            std::cout << "Texture atlas overflow" << std::endl;
+            return false;
+        }
+    }
+    atlasWidth = width;
+    atlasHeight = height;
+
+    // Copy each image and extrude its border into the padding
+    std::vector<unsigned char> pixels((size_t)width * height * 4, 0);
+    regions.resize(images.size());
+    for (int id = 0; id < (int)images.size(); id++) {
+        const Image& img = images[id];
+        int w = alignUp(img.width + 2 * padding, padding);
+        int h = alignUp(img.height + 2 * padding, padding);
+
+        for (int y = 0; y < h; y++) {
+            int sy = std::max(0, std::min(img.height - 1, y - padding));
+            for (int x = 0; x < w; x++) {
+                int sx = std::max(0, std::min(img.width - 1, x - padding));
+                const unsigned char* src = &img.pixels[((size_t)sy * img.width + sx) * 4];
+                unsigned char* dst = &pixels[((size_t)(img.y + y) * width + (img.x + x)) * 4];
+                dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = src[3];
+            }
+        }
+
+        regions[id].uvMin = glm::vec2((float)(img.x + padding) / width, (float)(img.y + padding) / height);
+        regions[id].uvMax = glm::vec2((float)(img.x + padding + img.width) / width, (float)(img.y + padding + img.height) / height);
+    }
+
+    int maxLevel = 0;
+    while ((2 << maxLevel) <= padding) maxLevel++;
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, maxLevel);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Source pixels are no longer needed once uploaded
+    for (auto& img : images) std::vector<unsigned char>().swap(img.pixels);
+    return true;
+}
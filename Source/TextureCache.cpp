@@ -0,0 +1,230 @@
+#include "../Header/TextureCache.h"
+#include <GL/glew.h>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <iostream>
+
+static const char STEX_MAGIC[4] = { 'S', 'T', 'E', 'X' };
+static const uint32_t STEX_VERSION = 1;
+
+struct StexHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width, height;
+    uint32_t channels;
+    uint32_t glFormat;
+    uint32_t levelCount;
+    uint32_t reserved;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+};
+
+struct StexLevel {
+    uint32_t width, height;
+    uint64_t offset, size;
+};
+
+static bool getSourceStamp(const char* sourcePath, uint64_t& size, int64_t& time) {
+    std::error_code ec;
+    size = (uint64_t)std::filesystem::file_size(sourcePath, ec);
+    if (ec) return false;
+    time = (int64_t)std::filesystem::last_write_time(sourcePath, ec).time_since_epoch().count();
+    return !ec;
+}
+
+static unsigned int formatForChannels(int channels) {
+    switch (channels) {
+        case 1: return GL_RED;
+        case 2: return GL_RG;
+        case 3: return GL_RGB;
+        default: return GL_RGBA;
+    }
+}
+
+std::string getCookedTexturePath(const char* sourcePath) {
+    return std::string(sourcePath) + ".stex";
+}
+
+void downsampleImage(const unsigned char* src, int width, int height, int channels, std::vector<unsigned char>& dst, int& outWidth, int& outHeight) {
+    outWidth = std::max(1, width / 2);
+    outHeight = std::max(1, height / 2);
+    dst.resize((size_t)outWidth * outHeight * channels);
+
+    for (int y = 0; y < outHeight; y++) {
+        int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+        for (int x = 0; x < outWidth; x++) {
+            int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+            for (int c = 0; c < channels; c++) {
+                int sum = src[((size_t)y0 * width + x0) * channels + c] + src[((size_t)y0 * width + x1) * channels + c]
+                        + src[((size_t)y1 * width + x0) * channels + c] + src[((size_t)y1 * width + x1) * channels + c];
+                dst[((size_t)y * outWidth + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+bool loadCookedTexture(const char* sourcePath, CookedTexture& out) {
+    std::string cachePath = getCookedTexturePath(sourcePath);
+    MappedFile file;
+    if (!file.open(cachePath.c_str())) return false;
+    if (file.size() < sizeof(StexHeader)) return false;
+
+    StexHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, STEX_MAGIC, 4) != 0 || header.version != STEX_VERSION) return false;
+    if (header.levelCount == 0 || header.levelCount > 32) return false;
+
+    // Stale when the source image changed after cooking
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    if (getSourceStamp(sourcePath, sourceSize, sourceTime) &&
+        (sourceSize != header.sourceSize || sourceTime != header.sourceTime)) {
+        return false;
+    }
+
+    size_t tableEnd = sizeof(StexHeader) + header.levelCount * sizeof(StexLevel);
+    if (file.size() < tableEnd) return false;
+
+    // Only what cookTexture writes is uploaded; anything else is decoded again
+    if ((header.channels != 3 && header.channels != 4) || header.glFormat != formatForChannels((int)header.channels)) return false;
+    if (header.width == 0 || header.height == 0) return false;
+
+    out.width = (int)header.width;
+    out.height = (int)header.height;
+    out.channels = (int)header.channels;
+    out.glFormat = header.glFormat;
+    out.levels.clear();
+
+    // Each level halves the one before and holds exactly its pixels
+    size_t dataSize = file.size() - tableEnd;
+    uint32_t expectedWidth = header.width, expectedHeight = header.height;
+    for (uint32_t i = 0; i < header.levelCount; i++) {
+        StexLevel level;
+        memcpy(&level, file.data() + sizeof(StexHeader) + i * sizeof(StexLevel), sizeof(level));
+        if (level.width != expectedWidth || level.height != expectedHeight) return false;
+        if (level.size != (uint64_t)level.width * level.height * header.channels) return false;
+        if (level.offset > dataSize || level.size > dataSize - level.offset) return false;
+        out.levels.push_back({ (int)level.width, (int)level.height, (size_t)level.offset, (size_t)level.size });
+        expectedWidth = std::max(1u, expectedWidth / 2);
+        expectedHeight = std::max(1u, expectedHeight / 2);
+    }
+
+    out.data = file.data() + tableEnd;
+    out.dataSize = dataSize;
+    out.file = std::move(file);
+    out.storage.clear();
+    return true;
+}
+
+bool cookTexture(const char* sourcePath, const unsigned char* pixels, int width, int height, int channels, bool dropAlpha, CookedTexture& out) {
+    std::vector<unsigned char> level0(pixels, pixels + (size_t)width * height * channels);
+
+    // Grey sources are stored as RGB(A) so they sample grey rather than red
+    if (channels <= 2) {
+        int expanded = channels + 2;
+        std::vector<unsigned char> color((size_t)width * height * expanded);
+        for (size_t p = 0, n = (size_t)width * height; p < n; p++) {
+            unsigned char grey = level0[p * channels];
+            color[p * expanded + 0] = grey;
+            color[p * expanded + 1] = grey;
+            color[p * expanded + 2] = grey;
+            if (expanded == 4) color[p * expanded + 3] = level0[p * 2 + 1];
+        }
+        level0.swap(color);
+        channels = expanded;
+    }
+
+    // Fully opaque RGBA sources lose nothing by being stored as RGB
+    if (dropAlpha && channels == 4) {
+        bool opaque = true;
+        for (size_t i = 3; i < level0.size() && opaque; i += 4) opaque = level0[i] == 255;
+        if (opaque) {
+            std::vector<unsigned char> rgb((size_t)width * height * 3);
+            for (size_t p = 0, n = (size_t)width * height; p < n; p++) {
+                rgb[p * 3 + 0] = level0[p * 4 + 0];
+                rgb[p * 3 + 1] = level0[p * 4 + 1];
+                rgb[p * 3 + 2] = level0[p * 4 + 2];
+            }
+            level0.swap(rgb);
+            channels = 3;
+        }
+    }
+
+    out.width = width;
+    out.height = height;
+    out.channels = channels;
+    out.glFormat = formatForChannels(channels);
+    out.levels.clear();
+    out.file.close();
+    out.storage = level0;
+    out.levels.push_back({ width, height, 0, level0.size() });
+
+    std::vector<unsigned char> current = std::move(level0), next;
+    int w = width, h = height;
+    while (w > 1 || h > 1) {
+        int nw, nh;
+        downsampleImage(current.data(), w, h, channels, next, nw, nh);
+        out.levels.push_back({ nw, nh, out.storage.size(), next.size() });
+        out.storage.insert(out.storage.end(), next.begin(), next.end());
+        current.swap(next);
+        w = nw;
+        h = nh;
+    }
+    out.data = out.storage.data();
+    out.dataSize = out.storage.size();
+
+    // Write the container; a failed write only means no cache next time
+    StexHeader header = {};
+    memcpy(header.magic, STEX_MAGIC, 4);
+    header.version = STEX_VERSION;
+    header.width = (uint32_t)width;
+    header.height = (uint32_t)height;
+    header.channels = (uint32_t)channels;
+    header.glFormat = out.glFormat;
+    header.levelCount = (uint32_t)out.levels.size();
+    getSourceStamp(sourcePath, header.sourceSize, header.sourceTime);
+
+    std::string cachePath = getCookedTexturePath(sourcePath);
+    std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return true;
+
+    file.write((const char*)&header, sizeof(header));
+    for (const auto& level : out.levels) {
+        StexLevel entry = { (uint32_t)level.width, (uint32_t)level.height, (uint64_t)level.offset, (uint64_t)level.size };
+        file.write((const char*)&entry, sizeof(entry));
+    }
+    file.write((const char*)out.storage.data(), out.storage.size());
+    if (!file) {
+        file.close();
+        std::filesystem::remove(cachePath);
+        std::cout << "Failed to write texture cache: " << cachePath << std::endl;
+    }
+    return true;
+}
+
+void setCookedTextureParameters(const CookedTexture& tex) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)tex.levels.size() - 1);
+}
+
+unsigned int uploadCookedTexture(const CookedTexture& tex, unsigned int texture) {
+    if (texture == 0) glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    setCookedTextureParameters(tex);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int i = 0; i < (int)tex.levels.size(); i++) {
+        const CookedTexture::Level& level = tex.levels[i];
+        glTexImage2D(GL_TEXTURE_2D, i, tex.glFormat, level.width, level.height, 0, tex.glFormat, GL_UNSIGNED_BYTE, tex.data + level.offset);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
@@ -0,0 +1,160 @@
+#include "../Header/TextureStreamer.h"
+#include "../Header/stb_image.h"
+#include "../Header/Profiler.h"
+#include <GL/glew.h>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+TextureStreamer::TextureStreamer()
+    : inFlight(0),
+      pbo(0),
+      nextTicket(0) {
+}
+
+TextureStreamer::~TextureStreamer() {
+    // Decodes still running write into this object
+    JobSystem::get().wait(decodeJobs);
+
+    for (auto& item : decoded) delete item.texture;
+    if (pbo) glDeleteBuffers(1, &pbo);
+}
+
+unsigned int TextureStreamer::load(const char* filePath) {
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // White placeholder leaves the material colour untouched
+    unsigned char white[4] = { 255, 255, 255, 255 };
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inFlight++;
+    }
+    uint32_t ticket = ++nextTicket;
+    pending[texture] = ticket;
+    DecodeTask* task = new DecodeTask{ this, { filePath, texture, ticket } };
+    // Background: a decode must never run inside a simulation-thread wait()
+    JobSystem::get().runBackground(decodeJob, task, 0, 1, &decodeJobs);
+    return texture;
+}
+
+void TextureStreamer::cancel(unsigned int texture) {
+    pending.erase(texture);
+}
+
+void TextureStreamer::decodeJob(void* data, int, int) {
+    DecodeTask* task = (DecodeTask*)data;
+    task->streamer->decode(task->request);
+    delete task;
+}
+
+void TextureStreamer::decode(const Request& request) {
+    PROFILE_SCOPE("TextureStreamer::decode");
+    auto start = std::chrono::steady_clock::now();
+    Decoded item;
+    item.request = request;
+    item.texture = new CookedTexture();
+    item.cacheHit = loadCookedTexture(request.path.c_str(), *item.texture);
+
+    if (!item.cacheHit) {
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(request.path.c_str(), &width, &height, &channels, 0);
+        if (pixels) {
+            cookTexture(request.path.c_str(), pixels, width, height, channels, true, *item.texture);
+            stbi_image_free(pixels);
+        } else {
+            delete item.texture;
+            item.texture = nullptr;
+        }
+    }
+    item.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    decoded.push_back(item);
+}
+
+void TextureStreamer::processUploads(int maxUploads) {
+    PROFILE_SCOPE("TextureStreamer::upload");
+    for (int i = 0; i < maxUploads; i++) {
+        Decoded item;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (decoded.empty()) return;
+            item = decoded.front();
+            decoded.pop_front();
+            inFlight--;
+        }
+        upload(item);
+    }
+}
+
+void TextureStreamer::upload(Decoded& item) {
+    // The owner may have released the texture while it was being decoded,
+    // and its name may already belong to another texture
+    auto it = pending.find(item.request.texture);
+    bool live = it != pending.end() && it->second == item.request.ticket;
+    if (live) pending.erase(it);
+    if (!live) {
+        delete item.texture;
+        item.texture = nullptr;
+        return;
+    }
+
+    if (!item.texture) {
+        std::cout << "Texture access failed: " << item.request.path << std::endl;
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    const CookedTexture& tex = *item.texture;
+
+    if (!pbo) glGenBuffers(1, &pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+
+    // Orphan the previous storage so the driver never waits on an earlier upload
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, tex.dataSize, nullptr, GL_STREAM_DRAW);
+    const unsigned char* source = nullptr;
+    void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, tex.dataSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (dst) {
+        memcpy(dst, tex.data, tex.dataSize);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    } else {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        source = tex.data;
+    }
+
+    // Every mip level comes from the cooked chain, no glGenerateMipmap
+    glBindTexture(GL_TEXTURE_2D, item.request.texture);
+    setCookedTextureParameters(tex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int i = 0; i < (int)tex.levels.size(); i++) {
+        const CookedTexture::Level& level = tex.levels[i];
+        const void* pixels = source ? (const void*)(source + level.offset) : (const void*)(uintptr_t)level.offset;
+        glTexImage2D(GL_TEXTURE_2D, i, tex.glFormat, level.width, level.height, 0, tex.glFormat, GL_UNSIGNED_BYTE, pixels);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    delete item.texture;
+    item.texture = nullptr;
+
+    double uploadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Texture " << item.request.path << (item.cacheHit ? ": cache hit " : ": decode ") << item.decodeMs
+              << " ms, upload " << uploadMs << " ms" << std::endl;
+}
+
+bool TextureStreamer::isIdle() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return inFlight == 0;
+}
@@ -0,0 +1,244 @@
+#include "../Header/TimeSeries.h"
+#include <algorithm>
+#include <climits>
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t code) {
+    return (int64_t)(code >> 1) ^ -(int64_t)(code & 1);
+}
+
+static int bitWidth(uint64_t value) {
+    int bits = 0;
+    while (value) { bits++; value >>= 1; }
+    return bits;
+}
+
+// Fields may straddle two words; the words must start out zeroed
+static void packBits(uint64_t* words, size_t bit, uint64_t value, int bits) {
+    if (bits == 0) return;
+    size_t word = bit >> 6;
+    int shift = (int)(bit & 63);
+    words[word] |= value << shift;
+    if (shift + bits > 64) words[word + 1] |= value >> (64 - shift);
+}
+
+static uint64_t unpackBits(const uint64_t* words, size_t bit, int bits) {
+    if (bits == 0) return 0;
+    size_t word = bit >> 6;
+    int shift = (int)(bit & 63);
+    uint64_t value = words[word] >> shift;
+    if (shift + bits > 64) value |= words[word + 1] << (64 - shift);
+    return bits == 64 ? value : value & ((1ull << bits) - 1);
+}
+
+TimeSeries::TimeSeries()
+    : openCount(0),
+      levels(1),
+      count(0) {
+}
+
+void TimeSeries::clear() {
+    blocks.clear();
+    words.clear();
+    openCount = 0;
+    bucketTimes.clear();
+    levels.assign(1, std::vector<Aggregate>());
+    count = 0;
+}
+
+void TimeSeries::append(int64_t time, int32_t value) {
+    if (openCount == BLOCK_SAMPLES) sealOpenBlock();
+    openTimes[openCount] = time;
+    openValues[openCount] = value;
+    openCount++;
+    addToPyramid(time, value);
+    count++;
+}
+
+int64_t TimeSeries::getFirstTime() const {
+    if (!blocks.empty()) return blocks[0].firstTime;
+    return openCount > 0 ? openTimes[0] : 0;
+}
+
+int64_t TimeSeries::getLastTime() const {
+    // The open block is only emptied by the append that refills it
+    return openCount > 0 ? openTimes[openCount - 1] : 0;
+}
+
+void TimeSeries::sealOpenBlock() {
+    Block block;
+    block.firstTime = openTimes[0];
+    block.firstDelta = openCount > 1 ? openTimes[1] - openTimes[0] : 0;
+    block.firstValue = openValues[0];
+    block.count = (uint16_t)openCount;
+
+    uint64_t timeCodes[BLOCK_SAMPLES], valueCodes[BLOCK_SAMPLES];
+    uint64_t timeBits = 0, valueBits = 0;
+    for (int i = 2; i < openCount; i++) {
+        int64_t delta = openTimes[i] - openTimes[i - 1];
+        int64_t previous = openTimes[i - 1] - openTimes[i - 2];
+        timeCodes[i] = zigzag(delta - previous);
+        timeBits |= timeCodes[i];
+    }
+    for (int i = 1; i < openCount; i++) {
+        valueCodes[i] = zigzag((int64_t)openValues[i] - openValues[i - 1]);
+        valueBits |= valueCodes[i];
+    }
+    block.timeBits = (uint8_t)bitWidth(timeBits);
+    block.valueBits = (uint8_t)bitWidth(valueBits);
+
+    // Timestamps first, then values, in one run of bits
+    size_t timeCount = openCount > 2 ? openCount - 2 : 0;
+    size_t valueCount = openCount > 1 ? openCount - 1 : 0;
+    size_t totalBits = timeCount * block.timeBits + valueCount * block.valueBits;
+    block.firstWord = (uint32_t)words.size();
+    words.resize(words.size() + (totalBits + 63) / 64, 0);
+
+    uint64_t* out = words.data() + block.firstWord;
+    size_t bit = 0;
+    for (int i = 2; i < openCount; i++, bit += block.timeBits) packBits(out, bit, timeCodes[i], block.timeBits);
+    for (int i = 1; i < openCount; i++, bit += block.valueBits) packBits(out, bit, valueCodes[i], block.valueBits);
+
+    blocks.push_back(block);
+    openCount = 0;
+}
+
+void TimeSeries::decodeBlock(const Block& block, int64_t* times, int32_t* values) const {
+    const uint64_t* in = words.data() + block.firstWord;
+    int n = block.count;
+    size_t bit = 0;
+
+    times[0] = block.firstTime;
+    if (n > 1) times[1] = block.firstTime + block.firstDelta;
+    int64_t delta = block.firstDelta;
+    for (int i = 2; i < n; i++, bit += block.timeBits) {
+        delta += unzigzag(unpackBits(in, bit, block.timeBits));
+        times[i] = times[i - 1] + delta;
+    }
+
+    values[0] = block.firstValue;
+    for (int i = 1; i < n; i++, bit += block.valueBits) {
+        values[i] = (int32_t)(values[i - 1] + unzigzag(unpackBits(in, bit, block.valueBits)));
+    }
+}
+
+void TimeSeries::read(int64_t from, int64_t to, std::vector<TimeSeriesSample>& out) const {
+    out.clear();
+    if (count == 0 || from >= to) return;
+
+    // Start at the last block that begins at or before from
+    auto firstAfter = std::upper_bound(blocks.begin(), blocks.end(), from,
+                                       [](int64_t t, const Block& b) { return t < b.firstTime; });
+    size_t first = firstAfter == blocks.begin() ? 0 : (size_t)(firstAfter - blocks.begin()) - 1;
+
+    int64_t times[BLOCK_SAMPLES];
+    int32_t values[BLOCK_SAMPLES];
+    for (size_t b = first; b < blocks.size() && blocks[b].firstTime < to; b++) {
+        decodeBlock(blocks[b], times, values);
+        for (int i = 0; i < blocks[b].count; i++) {
+            if (times[i] >= from && times[i] < to) out.push_back({ times[i], values[i] });
+        }
+    }
+    for (int i = 0; i < openCount; i++) {
+        if (openTimes[i] >= from && openTimes[i] < to) out.push_back({ openTimes[i], openValues[i] });
+    }
+}
+
+void TimeSeries::addToPyramid(int64_t time, int32_t value) {
+    int bucket = count / BUCKET_SAMPLES;
+    if (bucket == (int)bucketTimes.size()) bucketTimes.push_back(time);
+
+    for (size_t level = 0; ; level++) {
+        if (level == levels.size()) {
+            // A new top level starts as the merge of the two buckets below,
+            // which already include this sample
+            const Aggregate& a = levels[level - 1][0];
+            const Aggregate& b = levels[level - 1][1];
+            Aggregate top = { std::min(a.min, b.min), std::max(a.max, b.max), a.sum + b.sum };
+            levels.push_back(std::vector<Aggregate>(1, top));
+        } else {
+            std::vector<Aggregate>& buckets = levels[level];
+            int index = bucket >> level;
+            if (index == (int)buckets.size()) {
+                Aggregate single = { value, value, value };
+                buckets.push_back(single);
+            } else {
+                Aggregate& a = buckets[index];
+                a.min = std::min(a.min, value);
+                a.max = std::max(a.max, value);
+                a.sum += value;
+            }
+        }
+        if (levels[level].size() == 1) break;
+    }
+}
+
+TimeSeries::Aggregate TimeSeries::aggregateBuckets(int first, int end, int& samples) const {
+    // Samples covered are all of them up to the end bucket, minus those before the first
+    samples = std::min(count, end * BUCKET_SAMPLES) - first * BUCKET_SAMPLES;
+
+    // Bottom-up segment tree walk: take an odd edge bucket at each level, then go up
+    Aggregate result = { INT32_MAX, INT32_MIN, 0 };
+    for (size_t level = 0; first < end; level++) {
+        const std::vector<Aggregate>& buckets = levels[level];
+        if (first & 1) {
+            const Aggregate& a = buckets[first++];
+            result.min = std::min(result.min, a.min);
+            result.max = std::max(result.max, a.max);
+            result.sum += a.sum;
+        }
+        if (end & 1) {
+            const Aggregate& a = buckets[--end];
+            result.min = std::min(result.min, a.min);
+            result.max = std::max(result.max, a.max);
+            result.sum += a.sum;
+        }
+        first >>= 1;
+        end >>= 1;
+    }
+    return result;
+}
+
+void TimeSeries::summarize(int64_t from, int64_t to, int columns, TimeSeriesBucket* out) const {
+    int64_t firstTime = getFirstTime(), lastTime = getLastTime();
+    auto searchFrom = bucketTimes.begin();
+
+    for (int c = 0; c < columns; c++) {
+        TimeSeriesBucket& column = out[c];
+        column.min = column.max = 0;
+        column.average = 0.0f;
+        column.count = 0;
+
+        int64_t start = from + (to - from) * c / columns;
+        int64_t end = from + (to - from) * (c + 1) / columns;
+        if (count == 0 || end <= start || start > lastTime || end <= firstTime) continue;
+
+        // Lowest-level buckets overlapping the column: from the one holding
+        // start through the last one that begins before end
+        auto startAfter = std::upper_bound(searchFrom, bucketTimes.end(), start);
+        auto endAt = std::lower_bound(startAfter, bucketTimes.end(), end);
+        int first = startAfter == bucketTimes.begin() ? 0 : (int)(startAfter - bucketTimes.begin()) - 1;
+        int last = (int)(endAt - bucketTimes.begin());
+        searchFrom = bucketTimes.begin() + first;
+        if (last <= first) continue;
+
+        int samples = 0;
+        Aggregate a = aggregateBuckets(first, last, samples);
+        column.min = a.min;
+        column.max = a.max;
+        column.average = (float)((double)a.sum / samples);
+        column.count = samples;
+    }
+}
+
+size_t TimeSeries::getMemoryBytes() const {
+    size_t bytes = sizeof(*this);
+    bytes += blocks.capacity() * sizeof(Block);
+    bytes += words.capacity() * sizeof(uint64_t);
+    bytes += bucketTimes.capacity() * sizeof(int64_t);
+    for (const std::vector<Aggregate>& level : levels) bytes += level.capacity() * sizeof(Aggregate);
+    return bytes;
+}
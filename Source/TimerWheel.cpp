@@ -0,0 +1,183 @@
+#include "../Header/TimerWheel.h"
+#include <algorithm>
+#include <bit>
+#include <climits>
+
+TimerWheel::TimerWheel()
+    : activeCount(0),
+      overflowHead(-1),
+      current(0),
+      nextEvent(INT64_MAX) {
+    for (int level = 0; level < LEVELS; level++) {
+        for (int slot = 0; slot < SLOTS; slot++) heads[level][slot] = -1;
+        occupied[level] = 0;
+    }
+}
+
+int TimerWheel::schedule(int64_t deadline, TimerCallback callback, void* data) {
+    return schedulePeriodic(deadline, 0, callback, data);
+}
+
+int TimerWheel::schedulePeriodic(int64_t firstDeadline, int64_t period, TimerCallback callback, void* data) {
+    int id;
+    if (!freeTimers.empty()) {
+        id = freeTimers.back();
+        freeTimers.pop_back();
+    } else {
+        id = (int)timers.size();
+        timers.push_back(Timer());
+    }
+
+    Timer& timer = timers[id];
+    timer.deadline = firstDeadline;
+    timer.period = period > 0 ? period : 0;
+    timer.callback = callback;
+    timer.data = data;
+    timer.active = true;
+    activeCount++;
+    place(id);
+    return id;
+}
+
+void TimerWheel::cancel(int id) {
+    if (id < 0 || id >= (int)timers.size() || !timers[id].active) return;
+    Timer& timer = timers[id];
+    timer.active = false;
+    activeCount--;
+
+    // Timers already collected as due are freed by advance when it reaches them
+    if (timer.level < 0) return;
+    unlink(id);
+    timer.level = -1;
+    freeTimers.push_back(id);
+}
+
+void TimerWheel::setPeriod(int id, int64_t period) {
+    if (id < 0 || id >= (int)timers.size() || !timers[id].active) return;
+    timers[id].period = period > 0 ? period : 0;
+}
+
+void TimerWheel::pushFront(int& head, int id) {
+    timers[id].prev = -1;
+    timers[id].next = head;
+    if (head >= 0) timers[head].prev = id;
+    head = id;
+}
+
+void TimerWheel::unlink(int id) {
+    Timer& timer = timers[id];
+    int& head = timer.level == LEVELS ? overflowHead : heads[timer.level][timer.slot];
+    if (timer.prev >= 0) timers[timer.prev].next = timer.next;
+    else head = timer.next;
+    if (timer.next >= 0) timers[timer.next].prev = timer.prev;
+    if (timer.level < LEVELS && head < 0) occupied[timer.level] &= ~(1ull << timer.slot);
+}
+
+void TimerWheel::place(int id) {
+    Timer& timer = timers[id];
+    int64_t deadline = std::max(timer.deadline, current);
+
+    // The lowest level whose slot span holds both now and the deadline
+    int level = 0;
+    while (level < LEVELS && (deadline >> (SLOT_BITS * (level + 1))) != (current >> (SLOT_BITS * (level + 1)))) level++;
+
+    int64_t event;
+    if (level == LEVELS) {
+        timer.level = LEVELS;
+        pushFront(overflowHead, id);
+        event = ((current >> (SLOT_BITS * LEVELS)) + 1) << (SLOT_BITS * LEVELS);
+    } else {
+        int slot = (int)((deadline >> (SLOT_BITS * level)) & (SLOTS - 1));
+        timer.level = (int8_t)level;
+        timer.slot = (uint8_t)slot;
+        pushFront(heads[level][slot], id);
+        occupied[level] |= 1ull << slot;
+        event = (deadline >> (SLOT_BITS * level)) << (SLOT_BITS * level);
+    }
+    nextEvent = std::min(nextEvent, event);
+}
+
+int64_t TimerWheel::findNextEvent(int& level, int& slot) const {
+    // Occupied slots always lie ahead of the current one, and every slot on
+    // a level comes before every slot on the levels above it
+    for (level = 0; level < LEVELS; level++) {
+        int currentSlot = (int)((current >> (SLOT_BITS * level)) & (SLOTS - 1));
+        uint64_t ahead = occupied[level] & (~0ull << currentSlot);
+        if (!ahead) continue;
+        slot = std::countr_zero(ahead);
+        int64_t span = (current >> (SLOT_BITS * (level + 1))) << (SLOT_BITS * (level + 1));
+        return span | ((int64_t)slot << (SLOT_BITS * level));
+    }
+    slot = 0;
+    if (overflowHead >= 0) return ((current >> (SLOT_BITS * LEVELS)) + 1) << (SLOT_BITS * LEVELS);
+    return INT64_MAX;
+}
+
+int TimerWheel::advance(int64_t now) {
+    // The usual frame: nothing is due yet
+    if (now < nextEvent) return 0;
+
+    int ran = 0;
+    while (true) {
+        int level, slot;
+        nextEvent = findNextEvent(level, slot);
+        if (nextEvent > now) break;
+        current = nextEvent;
+
+        if (level == LEVELS) {
+            // A new top-level span begins: overflow timers move onto the wheel if they fit now
+            int id = overflowHead;
+            overflowHead = -1;
+            while (id >= 0) {
+                int next = timers[id].next;
+                place(id);
+                id = next;
+            }
+            continue;
+        }
+
+        int id = heads[level][slot];
+        heads[level][slot] = -1;
+        occupied[level] &= ~(1ull << slot);
+        if (level > 0) {
+            // The slot's span has begun; its timers spread over the levels below
+            while (id >= 0) {
+                int next = timers[id].next;
+                place(id);
+                id = next;
+            }
+            continue;
+        }
+
+        // Callbacks may schedule or cancel, so the slot is detached first
+        due.clear();
+        for (; id >= 0; id = timers[id].next) {
+            due.push_back(id);
+            timers[id].level = -1;
+        }
+        for (int d : due) {
+            Timer& timer = timers[d];
+            if (!timer.active) {
+                freeTimers.push_back(d);
+                continue;
+            }
+            int64_t deadline = timer.deadline;
+            TimerCallback callback = timer.callback;
+            void* data = timer.data;
+            if (timer.period > 0) {
+                timer.deadline += timer.period;
+                place(d);
+            } else {
+                timer.active = false;
+                activeCount--;
+                freeTimers.push_back(d);
+            }
+            callback(data, deadline);
+            ran++;
+        }
+    }
+
+    // Nothing is due before the next event, so the wheel can move up to now
+    current = now;
+    return ran;
+}
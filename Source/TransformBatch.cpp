@@ -0,0 +1,205 @@
+#include "../Header/TransformBatch.h"
+#include "../Header/CpuFeatures.h"
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#define TRANSFORM_SSE2 1
+#endif
+#ifdef SIMD_HAS_AVX2
+#include <immintrin.h>
+#define TRANSFORM_AVX2 1
+#endif
+#if defined(TRANSFORM_AVX2) && defined(__GNUC__) && !defined(__AVX__)
+// The eight-wide instantiations of the block templates pass __m256 around,
+// but they only ever exist inlined into AVX2_TARGET loops
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+// Each kernel is written once against a set of lane operations and
+// instantiated for 1, 4 and 8 instances at a time. A block computes seven
+// columns (four model, three normal) for every lane, then stores them
+// instance by instance. The widest width the CPU runs is picked per call.
+
+struct ScalarOps {
+    typedef float V;
+    static const int WIDTH = 1;
+    static V load(const float* p) { return *p; }
+    static V set1(float v) { return v; }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    static V mul(V a, V b) { return a * b; }
+    static V div(V a, V b) { return a / b; }
+    static void store(InstanceTransform* out, V (&columns)[7][4]) {
+        float* dst = (float*)out;
+        for (int c = 0; c < 7; c++) {
+            for (int k = 0; k < 4; k++) dst[c * 4 + k] = columns[c][k];
+        }
+    }
+};
+
+#ifdef TRANSFORM_SSE2
+struct SseOps {
+    typedef __m128 V;
+    static const int WIDTH = 4;
+    static V load(const float* p) { return _mm_loadu_ps(p); }
+    static V set1(float v) { return _mm_set1_ps(v); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm_div_ps(a, b); }
+    // Lanes hold one component of four instances; transposing turns them into columns
+    static void store(InstanceTransform* out, V (&columns)[7][4]) {
+        for (int c = 0; c < 7; c++) {
+            __m128 r0 = columns[c][0], r1 = columns[c][1], r2 = columns[c][2], r3 = columns[c][3];
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps((float*)(out + 0) + c * 4, r0);
+            _mm_storeu_ps((float*)(out + 1) + c * 4, r1);
+            _mm_storeu_ps((float*)(out + 2) + c * 4, r2);
+            _mm_storeu_ps((float*)(out + 3) + c * 4, r3);
+        }
+    }
+};
+#endif
+
+#ifdef TRANSFORM_AVX2
+struct AvxOps {
+    typedef __m256 V;
+    static const int WIDTH = 8;
+    AVX2_TARGET static V load(const float* p) { return _mm256_loadu_ps(p); }
+    AVX2_TARGET static V set1(float v) { return _mm256_set1_ps(v); }
+    AVX2_TARGET static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    AVX2_TARGET static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    AVX2_TARGET static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    AVX2_TARGET static V div(V a, V b) { return _mm256_div_ps(a, b); }
+    // Stored as two groups of four
+    AVX2_TARGET static void store(InstanceTransform* out, V (&columns)[7][4]) {
+        __m128 low[7][4], high[7][4];
+        for (int c = 0; c < 7; c++) {
+            for (int k = 0; k < 4; k++) {
+                low[c][k] = _mm256_castps256_ps128(columns[c][k]);
+                high[c][k] = _mm256_extractf128_ps(columns[c][k], 1);
+            }
+        }
+        SseOps::store(out, low);
+        SseOps::store(out + 4, high);
+    }
+};
+#endif
+
+template<typename Ops>
+static SIMD_INLINE void composeTrsBlock(const TrsArrays& in, int i, InstanceTransform* out) {
+    typedef typename Ops::V V;
+    V zero = Ops::set1(0.0f), one = Ops::set1(1.0f), two = Ops::set1(2.0f);
+
+    // Quaternion to rotation matrix
+    V qx = Ops::load(in.rotationX + i), qy = Ops::load(in.rotationY + i);
+    V qz = Ops::load(in.rotationZ + i), qw = Ops::load(in.rotationW + i);
+    V x2 = Ops::mul(qx, two), y2 = Ops::mul(qy, two), z2 = Ops::mul(qz, two);
+    V xx = Ops::mul(qx, x2), yy = Ops::mul(qy, y2), zz = Ops::mul(qz, z2);
+    V xy = Ops::mul(qx, y2), xz = Ops::mul(qx, z2), yz = Ops::mul(qy, z2);
+    V wx = Ops::mul(qw, x2), wy = Ops::mul(qw, y2), wz = Ops::mul(qw, z2);
+    V rotation[3][3] = {
+        { Ops::sub(one, Ops::add(yy, zz)), Ops::add(xy, wz), Ops::sub(xz, wy) },
+        { Ops::sub(xy, wz), Ops::sub(one, Ops::add(xx, zz)), Ops::add(yz, wx) },
+        { Ops::add(xz, wy), Ops::sub(yz, wx), Ops::sub(one, Ops::add(xx, yy)) }
+    };
+
+    bool uniform = in.scaleY == nullptr || in.scaleZ == nullptr;
+    V scale[3];
+    scale[0] = Ops::load(in.scaleX + i);
+    scale[1] = uniform ? scale[0] : Ops::load(in.scaleY + i);
+    scale[2] = uniform ? scale[0] : Ops::load(in.scaleZ + i);
+
+    V columns[7][4];
+    for (int c = 0; c < 3; c++) {
+        V inverse = uniform ? one : Ops::div(one, scale[c]);
+        for (int k = 0; k < 3; k++) {
+            columns[c][k] = Ops::mul(rotation[c][k], scale[c]);
+            columns[4 + c][k] = uniform ? rotation[c][k] : Ops::mul(rotation[c][k], inverse);
+        }
+        columns[c][3] = zero;
+        columns[4 + c][3] = zero;
+    }
+    columns[3][0] = Ops::load(in.positionX + i);
+    columns[3][1] = Ops::load(in.positionY + i);
+    columns[3][2] = Ops::load(in.positionZ + i);
+    columns[3][3] = one;
+
+    Ops::store(out + i, columns);
+}
+
+template<typename Ops>
+static SIMD_INLINE void composeYawBlock(const float* px, const float* py, const float* pz, const float* yaw,
+                            const float* scale, int i, InstanceTransform* out) {
+    typedef typename Ops::V V;
+
+    // Trig stays scalar so angles match glm::rotate exactly
+    float sines[Ops::WIDTH], cosines[Ops::WIDTH];
+    for (int lane = 0; lane < Ops::WIDTH; lane++) {
+        sines[lane] = sinf(yaw[i + lane]);
+        cosines[lane] = cosf(yaw[i + lane]);
+    }
+
+    V zero = Ops::set1(0.0f), one = Ops::set1(1.0f);
+    V sn = Ops::load(sines), cs = Ops::load(cosines);
+    V s = Ops::load(scale + i);
+    V snScaled = Ops::mul(sn, s), csScaled = Ops::mul(cs, s);
+
+    V columns[7][4] = {
+        { csScaled, zero, Ops::sub(zero, snScaled), zero },
+        { zero, s, zero, zero },
+        { snScaled, zero, csScaled, zero },
+        { Ops::load(px + i), Ops::load(py + i), Ops::load(pz + i), one },
+        { cs, zero, Ops::sub(zero, sn), zero },
+        { zero, one, zero, zero },
+        { sn, zero, cs, zero }
+    };
+    Ops::store(out + i, columns);
+}
+
+#ifdef TRANSFORM_AVX2
+// Whole blocks of eight; returns how many instances were done
+AVX2_TARGET static int composeTransformsAvx2(const TrsArrays& in, int count, InstanceTransform* out) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) composeTrsBlock<AvxOps>(in, i, out);
+    return i;
+}
+
+AVX2_TARGET static int composeYawTransformsAvx2(const float* positionX, const float* positionY, const float* positionZ,
+                                                const float* yaw, const float* scale, int count, InstanceTransform* out) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) composeYawBlock<AvxOps>(positionX, positionY, positionZ, yaw, scale, i, out);
+    return i;
+}
+#endif
+
+void composeTransforms(const TrsArrays& in, int count, InstanceTransform* out) {
+    int i = 0;
+    SimdLevel level = getSimdLevel();
+#ifdef TRANSFORM_AVX2
+    if (level >= SIMD_AVX2) i = composeTransformsAvx2(in, count, out);
+#endif
+#ifdef TRANSFORM_SSE2
+    if (level >= SIMD_SSE2) {
+        for (; i + 4 <= count; i += 4) composeTrsBlock<SseOps>(in, i, out);
+    }
+#endif
+    for (; i < count; i++) composeTrsBlock<ScalarOps>(in, i, out);
+}
+
+void composeYawTransforms(const float* positionX, const float* positionY, const float* positionZ,
+                          const float* yaw, const float* scale, int count, InstanceTransform* out) {
+    int i = 0;
+    SimdLevel level = getSimdLevel();
+#ifdef TRANSFORM_AVX2
+    if (level >= SIMD_AVX2) i = composeYawTransformsAvx2(positionX, positionY, positionZ, yaw, scale, count, out);
+#endif
+#ifdef TRANSFORM_SSE2
+    if (level >= SIMD_SSE2) {
+        for (; i + 4 <= count; i += 4) composeYawBlock<SseOps>(positionX, positionY, positionZ, yaw, scale, i, out);
+    }
+#endif
+    for (; i < count; i++) composeYawBlock<ScalarOps>(positionX, positionY, positionZ, yaw, scale, i, out);
+}
@@ -0,0 +1,50 @@
+#include "../Header/TransformHierarchy.h"
+#include <cstring>
+
+TransformHierarchy::TransformHierarchy()
+    : anyDirty(false), lastUpdateCount(0) {
+}
+
+int TransformHierarchy::addNode(int parent, const glm::mat4& local) {
+    int node = (int)parents.size();
+    parents.push_back(parent < node ? parent : -1);
+    localMatrices.push_back(local);
+    worldMatrices.push_back(local);
+    dirty.push_back(1);
+    anyDirty = true;
+    return node;
+}
+
+void TransformHierarchy::setLocal(int node, const glm::mat4& local) {
+    localMatrices[node] = local;
+    dirty[node] = 1;
+    anyDirty = true;
+}
+
+void TransformHierarchy::clear() {
+    parents.clear();
+    localMatrices.clear();
+    worldMatrices.clear();
+    dirty.clear();
+    anyDirty = false;
+    lastUpdateCount = 0;
+}
+
+int TransformHierarchy::update() {
+    lastUpdateCount = 0;
+    if (!anyDirty) return 0;
+
+    // Parents come first, so their flag is final by the time a child reads it
+    int count = (int)parents.size();
+    for (int i = 0; i < count; i++) {
+        int parent = parents[i];
+        if (parent >= 0 && dirty[parent]) dirty[i] = 1;
+        if (!dirty[i]) continue;
+
+        worldMatrices[i] = parent >= 0 ? worldMatrices[parent] * localMatrices[i] : localMatrices[i];
+        lastUpdateCount++;
+    }
+    memset(dirty.data(), 0, dirty.size());
+    anyDirty = false;
+    return lastUpdateCount;
+}
@@ -0,0 +1,399 @@
+#include "../Header/TriangleBvh.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BVH_SSE2 1
+#endif
+
+// SAH build parameters
+const int SAH_BINS = 12;
+const int MAX_LEAF_TRIANGLES = 16;
+const float TRAVERSAL_COST = 1.0f;   // relative to one triangle test
+
+static float surfaceArea(const glm::vec3& boxMin, const glm::vec3& boxMax) {
+    glm::vec3 d = glm::max(boxMax - boxMin, glm::vec3(0.0f));
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+TriangleBvh::TriangleBvh()
+    : boundsMin(0.0f), boundsMax(0.0f) {
+}
+
+void TriangleBvh::clear() {
+    positions.clear();
+    texCoords.clear();
+    nodes.clear();
+    packets.clear();
+    boundsMin = boundsMax = glm::vec3(0.0f);
+}
+
+void TriangleBvh::addMesh(const Mesh& mesh) {
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        for (int c = 0; c < 3; c++) {
+            const Vertex& v = mesh.vertices[mesh.indices[i + c]];
+            positions.push_back(v.position);
+            texCoords.push_back(v.texCoords);
+        }
+    }
+}
+
+void TriangleBvh::addModel(const Model& model) {
+    for (const auto& mesh : model.getMeshes()) addMesh(mesh);
+}
+
+void TriangleBvh::build() {
+    nodes.clear();
+    packets.clear();
+    int count = getTriangleCount();
+    if (count == 0) return;
+
+    std::vector<glm::vec3> centroids(count), bounds(count * 2);
+    std::vector<int> order(count);
+    for (int i = 0; i < count; i++) {
+        const glm::vec3* p = &positions[i * 3];
+        bounds[i * 2] = glm::min(glm::min(p[0], p[1]), p[2]);
+        bounds[i * 2 + 1] = glm::max(glm::max(p[0], p[1]), p[2]);
+        centroids[i] = (p[0] + p[1] + p[2]) / 3.0f;
+        order[i] = i;
+    }
+
+    std::vector<BuildNode> build;
+    build.reserve(count * 2 / 4 + 1);
+    buildRecursive(build, order, centroids, bounds, 0, count);
+    boundsMin = build[0].boxMin;
+    boundsMax = build[0].boxMax;
+
+    nodes.reserve(build.size() / 3 + 1);
+    packets.reserve(count / 4 + build.size());
+    flatten(build, order, 0);
+}
+
+int TriangleBvh::buildRecursive(std::vector<BuildNode>& build, std::vector<int>& order, const std::vector<glm::vec3>& centroids,
+                                const std::vector<glm::vec3>& bounds, int first, int count) {
+    int index = (int)build.size();
+    build.emplace_back();
+
+    glm::vec3 boxMin(1e30f), boxMax(-1e30f), centroidMin(1e30f), centroidMax(-1e30f);
+    for (int i = first; i < first + count; i++) {
+        int t = order[i];
+        boxMin = glm::min(boxMin, bounds[t * 2]);
+        boxMax = glm::max(boxMax, bounds[t * 2 + 1]);
+        centroidMin = glm::min(centroidMin, centroids[t]);
+        centroidMax = glm::max(centroidMax, centroids[t]);
+    }
+    build[index] = { boxMin, boxMax, -1, -1, first, count };
+    if (count <= 4) return index;
+
+    // Bin centroids along each axis and sweep for the cheapest split
+    float bestCost = 1e30f;
+    int bestAxis = -1, bestSplit = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        float extent = centroidMax[axis] - centroidMin[axis];
+        if (extent <= 0.0f) continue;
+        float binScale = SAH_BINS / extent;
+
+        glm::vec3 binMin[SAH_BINS], binMax[SAH_BINS];
+        int binCount[SAH_BINS] = {};
+        for (int b = 0; b < SAH_BINS; b++) {
+            binMin[b] = glm::vec3(1e30f);
+            binMax[b] = glm::vec3(-1e30f);
+        }
+        for (int i = first; i < first + count; i++) {
+            int t = order[i];
+            int b = std::min(SAH_BINS - 1, (int)((centroids[t][axis] - centroidMin[axis]) * binScale));
+            binCount[b]++;
+            binMin[b] = glm::min(binMin[b], bounds[t * 2]);
+            binMax[b] = glm::max(binMax[b], bounds[t * 2 + 1]);
+        }
+
+        // Right-to-left areas first, then one pass left to right
+        float rightArea[SAH_BINS];
+        int rightCount[SAH_BINS];
+        glm::vec3 accMin(1e30f), accMax(-1e30f);
+        int acc = 0;
+        for (int b = SAH_BINS - 1; b > 0; b--) {
+            accMin = glm::min(accMin, binMin[b]);
+            accMax = glm::max(accMax, binMax[b]);
+            acc += binCount[b];
+            rightArea[b] = surfaceArea(accMin, accMax);
+            rightCount[b] = acc;
+        }
+        accMin = glm::vec3(1e30f);
+        accMax = glm::vec3(-1e30f);
+        acc = 0;
+        for (int b = 0; b < SAH_BINS - 1; b++) {
+            accMin = glm::min(accMin, binMin[b]);
+            accMax = glm::max(accMax, binMax[b]);
+            acc += binCount[b];
+            if (acc == 0 || rightCount[b + 1] == 0) continue;
+            float cost = acc * surfaceArea(accMin, accMax) + rightCount[b + 1] * rightArea[b + 1];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = b + 1;
+            }
+        }
+    }
+
+    float area = surfaceArea(boxMin, boxMax);
+    float leafCost = count * area;
+    float splitCost = TRAVERSAL_COST * area + bestCost;
+    if (count <= MAX_LEAF_TRIANGLES && (bestAxis < 0 || splitCost >= leafCost)) return index;
+
+    int mid;
+    if (bestAxis >= 0) {
+        float binScale = SAH_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+        float axisMin = centroidMin[bestAxis];
+        int* split = std::partition(order.data() + first, order.data() + first + count, [&](int t) {
+            return std::min(SAH_BINS - 1, (int)((centroids[t][bestAxis] - axisMin) * binScale)) < bestSplit;
+        });
+        mid = (int)(split - order.data());
+    } else {
+        // Every centroid in one spot: any split is as good as another
+        mid = first + count / 2;
+    }
+
+    int left = buildRecursive(build, order, centroids, bounds, first, mid - first);
+    int right = buildRecursive(build, order, centroids, bounds, mid, first + count - mid);
+    build[index].left = left;
+    build[index].right = right;
+    return index;
+}
+
+int TriangleBvh::flatten(const std::vector<BuildNode>& build, const std::vector<int>& order, int index) {
+    // Pull grandchildren up until there are four children, biggest first
+    int kids[4];
+    int kidCount = 0;
+    if (build[index].left < 0) {
+        kids[kidCount++] = index;
+    } else {
+        kids[kidCount++] = build[index].left;
+        kids[kidCount++] = build[index].right;
+    }
+    while (kidCount < 4) {
+        int expand = -1;
+        float expandArea = -1.0f;
+        for (int k = 0; k < kidCount; k++) {
+            const BuildNode& kid = build[kids[k]];
+            if (kid.left < 0) continue;
+            float area = surfaceArea(kid.boxMin, kid.boxMax);
+            if (area > expandArea) {
+                expandArea = area;
+                expand = k;
+            }
+        }
+        if (expand < 0) break;
+        int node = kids[expand];
+        kids[expand] = build[node].left;
+        kids[kidCount++] = build[node].right;
+    }
+
+    int nodeIndex = (int)nodes.size();
+    nodes.emplace_back();
+    for (int k = 0; k < 4; k++) {
+        Node& node = nodes[nodeIndex];
+        if (k >= kidCount) {
+            node.minX[k] = node.minY[k] = node.minZ[k] = 1e30f;
+            node.maxX[k] = node.maxY[k] = node.maxZ[k] = -1e30f;
+            node.child[k] = 0;
+            node.packetCount[k] = -1;
+            continue;
+        }
+
+        const BuildNode& kid = build[kids[k]];
+        node.minX[k] = kid.boxMin.x;
+        node.minY[k] = kid.boxMin.y;
+        node.minZ[k] = kid.boxMin.z;
+        node.maxX[k] = kid.boxMax.x;
+        node.maxY[k] = kid.boxMax.y;
+        node.maxZ[k] = kid.boxMax.z;
+        if (kid.left < 0) {
+            node.child[k] = (int)packets.size();
+            node.packetCount[k] = (kid.count + 3) / 4;
+            emitLeaf(kid, order);
+        } else {
+            // Recursing grows nodes, so the reference is taken again afterwards
+            int child = flatten(build, order, kids[k]);
+            nodes[nodeIndex].child[k] = child;
+            nodes[nodeIndex].packetCount[k] = 0;
+        }
+    }
+    return nodeIndex;
+}
+
+void TriangleBvh::emitLeaf(const BuildNode& leaf, const std::vector<int>& order) {
+    for (int i = 0; i < leaf.count; i += 4) {
+        Packet packet = {};
+        for (int lane = 0; lane < 4; lane++) {
+            packet.triangle[lane] = -1;
+            if (i + lane >= leaf.count) continue;
+
+            int t = order[leaf.first + i + lane];
+            glm::vec3 v0 = positions[t * 3];
+            glm::vec3 e1 = positions[t * 3 + 1] - v0;
+            glm::vec3 e2 = positions[t * 3 + 2] - v0;
+            packet.v0x[lane] = v0.x; packet.v0y[lane] = v0.y; packet.v0z[lane] = v0.z;
+            packet.e1x[lane] = e1.x; packet.e1y[lane] = e1.y; packet.e1z[lane] = e1.z;
+            packet.e2x[lane] = e2.x; packet.e2y[lane] = e2.y; packet.e2z[lane] = e2.z;
+            packet.triangle[lane] = t;
+        }
+        packets.push_back(packet);
+    }
+}
+
+// Moller-Trumbore on four triangles at once
+void TriangleBvh::intersectPacket(const Packet& packet, const glm::vec3& origin, const glm::vec3& direction,
+                                  float& best, int& bestTriangle, glm::vec2& bestBarycentric) const {
+#ifdef BVH_SSE2
+    __m128 dx = _mm_set1_ps(direction.x), dy = _mm_set1_ps(direction.y), dz = _mm_set1_ps(direction.z);
+    __m128 e1x = _mm_load_ps(packet.e1x), e1y = _mm_load_ps(packet.e1y), e1z = _mm_load_ps(packet.e1z);
+    __m128 e2x = _mm_load_ps(packet.e2x), e2y = _mm_load_ps(packet.e2y), e2z = _mm_load_ps(packet.e2z);
+
+    // p = d x e2, det = e1 . p
+    __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+    __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+    __m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+    __m128 valid = _mm_cmpgt_ps(absDet, _mm_set1_ps(1e-12f));
+    __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), _mm_or_ps(_mm_and_ps(valid, det), _mm_andnot_ps(valid, _mm_set1_ps(1.0f))));
+
+    // s = o - v0, u = s . p / det
+    __m128 sx = _mm_sub_ps(_mm_set1_ps(origin.x), _mm_load_ps(packet.v0x));
+    __m128 sy = _mm_sub_ps(_mm_set1_ps(origin.y), _mm_load_ps(packet.v0y));
+    __m128 sz = _mm_sub_ps(_mm_set1_ps(origin.z), _mm_load_ps(packet.v0z));
+    __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+
+    // q = s x e1, v = d . q / det, t = e2 . q / det
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+    __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+    __m128 zero = _mm_setzero_ps();
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(v, zero));
+    valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(t, zero));
+    valid = _mm_and_ps(valid, _mm_cmplt_ps(t, _mm_set1_ps(best)));
+
+    int mask = _mm_movemask_ps(valid);
+    if (!mask) return;
+
+    alignas(16) float tLanes[4], uLanes[4], vLanes[4];
+    _mm_store_ps(tLanes, t);
+    _mm_store_ps(uLanes, u);
+    _mm_store_ps(vLanes, v);
+    for (int lane = 0; lane < 4; lane++) {
+        if (!(mask & (1 << lane)) || tLanes[lane] >= best) continue;
+        best = tLanes[lane];
+        bestTriangle = packet.triangle[lane];
+        bestBarycentric = glm::vec2(uLanes[lane], vLanes[lane]);
+    }
+#else
+    for (int lane = 0; lane < 4; lane++) {
+        glm::vec3 e1(packet.e1x[lane], packet.e1y[lane], packet.e1z[lane]);
+        glm::vec3 e2(packet.e2x[lane], packet.e2y[lane], packet.e2z[lane]);
+        glm::vec3 p = glm::cross(direction, e2);
+        float det = glm::dot(e1, p);
+        if (fabsf(det) <= 1e-12f) continue;
+        float invDet = 1.0f / det;
+
+        glm::vec3 s = origin - glm::vec3(packet.v0x[lane], packet.v0y[lane], packet.v0z[lane]);
+        float u = glm::dot(s, p) * invDet;
+        glm::vec3 q = glm::cross(s, e1);
+        float v = glm::dot(direction, q) * invDet;
+        float t = glm::dot(e2, q) * invDet;
+        if (u < 0.0f || v < 0.0f || u + v > 1.0f || t < 0.0f || t >= best) continue;
+
+        best = t;
+        bestTriangle = packet.triangle[lane];
+        bestBarycentric = glm::vec2(u, v);
+    }
+#endif
+}
+
+bool TriangleBvh::intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, BvhHit& hit) const {
+    if (nodes.empty()) return false;
+
+    // Keep the reciprocal finite so the slab test never computes 0 * inf
+    glm::vec3 safeDir = direction;
+    for (int i = 0; i < 3; i++) {
+        if (fabsf(safeDir[i]) < 1e-20f) safeDir[i] = safeDir[i] < 0.0f ? -1e-20f : 1e-20f;
+    }
+    glm::vec3 invDir = glm::vec3(1.0f) / safeDir;
+
+    float best = maxDistance;
+    int bestTriangle = -1;
+    glm::vec2 bestBarycentric(0.0f);
+
+    int stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const Node& node = nodes[stack[--stackSize]];
+
+        // Entry distance of the ray into each child box; misses stay above best
+        float entry[4];
+#ifdef BVH_SSE2
+        __m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+        __m128 ix = _mm_set1_ps(invDir.x), iy = _mm_set1_ps(invDir.y), iz = _mm_set1_ps(invDir.z);
+        __m128 tx0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX), ox), ix);
+        __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX), ox), ix);
+        __m128 ty0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY), oy), iy);
+        __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY), oy), iy);
+        __m128 tz0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ), oz), iz);
+        __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ), oz), iz);
+        __m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx0, tx1), _mm_min_ps(ty0, ty1)),
+                                  _mm_max_ps(_mm_min_ps(tz0, tz1), _mm_setzero_ps()));
+        __m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx0, tx1), _mm_max_ps(ty0, ty1)),
+                                 _mm_min_ps(_mm_max_ps(tz0, tz1), _mm_set1_ps(best)));
+        int mask = _mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+        _mm_storeu_ps(entry, tNear);
+        for (int k = 0; k < 4; k++) {
+            if (!(mask & (1 << k)) || node.packetCount[k] < 0) entry[k] = 1e30f;
+        }
+#else
+        for (int k = 0; k < 4; k++) {
+            entry[k] = 1e30f;
+            if (node.packetCount[k] < 0) continue;
+            glm::vec3 t0 = (glm::vec3(node.minX[k], node.minY[k], node.minZ[k]) - origin) * invDir;
+            glm::vec3 t1 = (glm::vec3(node.maxX[k], node.maxY[k], node.maxZ[k]) - origin) * invDir;
+            glm::vec3 tMin = glm::min(t0, t1), tMax = glm::max(t0, t1);
+            float tNear = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+            float tFar = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, best));
+            if (tNear <= tFar) entry[k] = tNear;
+        }
+#endif
+
+        // Visit hit children nearest first: leaves now, inner nodes via the stack
+        int slots[4] = { 0, 1, 2, 3 };
+        std::sort(slots, slots + 4, [&](int a, int b) { return entry[a] < entry[b]; });
+        int innerCount = 0;
+        int inner[4];
+        for (int s = 0; s < 4; s++) {
+            int k = slots[s];
+            if (entry[k] >= best) break;
+            if (node.packetCount[k] > 0) {
+                for (int p = 0; p < node.packetCount[k]; p++) {
+                    intersectPacket(packets[node.child[k] + p], origin, direction, best, bestTriangle, bestBarycentric);
+                }
+            } else {
+                inner[innerCount++] = node.child[k];
+            }
+        }
+        for (int s = innerCount - 1; s >= 0 && stackSize < 64; s--) stack[stackSize++] = inner[s];
+    }
+
+    if (bestTriangle < 0) return false;
+
+    const glm::vec2* uv = &texCoords[bestTriangle * 3];
+    hit.distance = best;
+    hit.triangle = bestTriangle;
+    hit.barycentric = bestBarycentric;
+    hit.uv = uv[0] * (1.0f - bestBarycentric.x - bestBarycentric.y) + uv[1] * bestBarycentric.x + uv[2] * bestBarycentric.y;
+    return true;
+}
@@ -3,31 +3,13 @@
 
 #include "../Header/stb_image.h"
 #include "../Header/Util.h"
+#include "../Header/TextureStreamer.h"
+#include "../Header/TextureCache.h"
 
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <vector>
-
-// Helper to read file content
-std::string readFile(const char* filePath) {
-    std::string content;
-    std::ifstream fileStream(filePath, std::ios::in);
-
-    if (!fileStream.is_open()) {
-        std::cerr << "Could not read file " << filePath << ". File does not exist." << std::endl;
-        return "";
-    }
-
-    std::string line = "";
-    while (!fileStream.eof()) {
-        std::getline(fileStream, line);
-        content.append(line + "\n");
-    }
-
-    fileStream.close();
-    return content;
-}
+#include <chrono>
+#include <thread>
 
 int endProgram(std::string message) {
     std::cerr << message << std::endl;
@@ -35,85 +17,63 @@ int endProgram(std::string message) {
     return -1;
 }
 
-unsigned int createShader(const char* vsPath, const char* fsPath) {
-    std::string vsString = readFile(vsPath);
-    std::string fsString = readFile(fsPath);
-    const char* vsSource = vsString.c_str();
-    const char* fsSource = fsString.c_str();
-
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vsSource, NULL);
-    glCompileShader(vertexShader);
-
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
+unsigned loadImageToTexture(const char* filePath) {
+    auto start = std::chrono::steady_clock::now();
 
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fsSource, NULL);
-    glCompileShader(fragmentShader);
+    // Cooked container with a precomputed mip chain skips decode and glGenerateMipmap
+    CookedTexture cooked;
+    bool cacheHit = loadCookedTexture(filePath, cooked);
 
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
+    if (!cacheHit) {
+        int TextureWidth;
+        int TextureHeight;
+        int TextureChannels;
+        unsigned char* ImageData = stbi_load(filePath, &TextureWidth, &TextureHeight, &TextureChannels, 0);
 
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
+        if (ImageData == NULL) {
+            std::cout << "Texture access failed: " << filePath << std::endl;
+            return 0; // Return 0 (invalid texture ID)
+        }
 
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        cookTexture(filePath, ImageData, TextureWidth, TextureHeight, TextureChannels, true, cooked);
+        stbi_image_free(ImageData);
     }
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    unsigned int Texture = uploadCookedTexture(cooked);
 
-    return shaderProgram;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Texture " << filePath << (cacheHit ? ": cache hit, " : ": decoded and cooked, ") << ms << " ms" << std::endl;
+    return Texture;
 }
 
-unsigned loadImageToTexture(const char* filePath) {
-    int TextureWidth;
-    int TextureHeight;
-    int TextureChannels;
-    unsigned char* ImageData = stbi_load(filePath, &TextureWidth, &TextureHeight, &TextureChannels, 0);
-
-    if (ImageData != NULL) {
-        // Create Texture
-        unsigned int Texture;
-        glGenTextures(1, &Texture);
-        glBindTexture(GL_TEXTURE_2D, Texture);
-
-        // Set parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        // Load data
-        GLint format = (TextureChannels == 4) ? GL_RGBA : GL_RGB;
-        glTexImage2D(GL_TEXTURE_2D, 0, format, TextureWidth, TextureHeight, 0, format, GL_UNSIGNED_BYTE, ImageData);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glBindTexture(GL_TEXTURE_2D, 0);
-        stbi_image_free(ImageData);
-        return Texture;
-    }
-    else {
-        std::cout << "Texture access failed: " << filePath << std::endl;
-        if (ImageData) stbi_image_free(ImageData);
-        return 0; // Return 0 (invalid texture ID)
+static TextureStreamer* textureStreamer = nullptr;
+
+unsigned loadImageToTextureAsync(const char* filePath) {
+    if (!textureStreamer) textureStreamer = new TextureStreamer();
+    return textureStreamer->load(filePath);
+}
+
+void cancelTextureUpload(unsigned texture) {
+    if (textureStreamer) textureStreamer->cancel(texture);
+}
+
+void processTextureUploads() {
+    if (textureStreamer) textureStreamer->processUploads();
+}
+
+void finishTextureUploads() {
+    if (!textureStreamer) return;
+    while (!textureStreamer->isIdle()) {
+        textureStreamer->processUploads(16);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
 }
 
+void shutdownTextureStreaming() {
+    delete textureStreamer;
+    textureStreamer = nullptr;
+}
+
 GLFWcursor* loadImageToCursor(const char* filePath) {
     int width, height, channels;
     unsigned char* data = stbi_load(filePath, &width, &height, &channels, 4); // Force RGBA
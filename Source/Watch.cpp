@@ -1,44 +1,84 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include "../Header/Watch.h"
 #include "../Header/Util.h"
+#include "../Header/Profiler.h"
+#include "../Header/RenderStats.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <algorithm>
 #include <cstdlib>
 #include <ctime>
 
+// Screen disc diameter, and the arrows' position and click radius in content units
+const float SCREEN_SIZE = 0.25f;
+const float ARROW_OFFSET = 0.14f;
+const float ARROW_HIT_RADIUS = 0.04f;
+
+// Seconds of ECG on screen, and the millivolt range mapped onto its height
+const float ECG_WINDOW_SECONDS = 3.0f;
+const float ECG_MIN_MV = -0.4f;
+const float ECG_MAX_MV = 1.2f;
+
 Watch::Watch()
     : digitRenderer(nullptr),
       currentScreen(WATCH_SCREEN_CLOCK),
       hours(12), minutes(30), seconds(0),
-      lastTimeUpdate(0.0),
       heartRate(70),
-      lastHeartUpdate(0.0),
-      ecgScrollOffset(0.0f),
       batteryPercent(100),
-      lastBatteryUpdate(0.0),
-      warningTexture(0), ecgTexture(0), batteryTexture(0), arrowTexture(0),
+      pace(0),
+      heartTimer(-1),
+      running(false), recorded(false),
+      rngState(1u),
+      sensorLog(nullptr),
+      uiAtlas(nullptr),
+      warningIcon(-1), batteryIcon(-1), arrowIcon(-1),
+      iconVAO(0), iconVBO(0),
+      ecgVAO(0), ecgVBO(0),
+      boundTexture(0),
       watchOffset(0.25f, -0.025f, -0.05f),
-      contentScale(0.55f) {
+      contentScale(0.55f),
+      watchNode(-1), screenNode(-1), prevArrowNode(-1), nextArrowNode(-1), lightNode(-1) {
+    timers.schedulePeriodic(1000, 1000, clockTick, this);
+    heartTimer = timers.schedulePeriodic(100, 100, heartTick, this);
+    timers.schedulePeriodic(10000, 10000, batteryTick, this);
 }
 
 Watch::~Watch() {
     watchBody.cleanup();
     watchScreen.cleanup();
+    if (iconVAO) glDeleteVertexArrays(1, &iconVAO);
+    if (iconVBO) glDeleteBuffers(1, &iconVBO);
+    if (ecgVAO) glDeleteVertexArrays(1, &ecgVAO);
+    if (ecgVBO) glDeleteBuffers(1, &ecgVBO);
+    delete uiAtlas;
     delete digitRenderer;
 }
 
-void Watch::init() {
+void Watch::init(ResourceManager& resources) {
     watchBody = Geometry::createWatchBody(0.3f, 0.04f, 32);
-    watchScreen = Geometry::createWatchScreen(0.25f, 32);
+    watchScreen = Geometry::createWatchScreen(SCREEN_SIZE, 32);
+    screenBvh.addMesh(watchScreen);
+    screenBvh.build();
 
     digitRenderer = new DigitRenderer();
     digitRenderer->init();
 
-    warningTexture = loadImageToTexture("Resources/textures/warning.png");
-    ecgTexture = loadImageToTexture("Resources/textures/ecg_wave.png");
-    batteryTexture = loadImageToTexture("Resources/textures/battery.png");
-    arrowTexture = loadImageToTexture("Resources/textures/arrow_right.png");
+    uiAtlas = new TextureAtlas();
+    warningIcon = uiAtlas->addImage("warning", "Resources/textures/warning.png");
+    batteryIcon = uiAtlas->addImage("battery", "Resources/textures/battery.png");
+    arrowIcon = uiAtlas->addImage("arrow_right", "Resources/textures/arrow_right.png");
+    uiAtlas->build();
+    buildIconQuads();
+    atlasTexture = resources.trackTexture("ui atlas", uiAtlas->getTexture());
+
+    // Storage comes later, sized to whatever part of the window is filled
+    glGenVertexArrays(1, &ecgVAO);
+    glGenBuffers(1, &ecgVBO);
+    glBindVertexArray(ecgVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, ecgVBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
 
     time_t now = time(nullptr);
     struct tm* lt = localtime(&now);
@@ -49,45 +89,84 @@ void Watch::init() {
     }
 }
 
-void Watch::update(double deltaTime, double currentTime, bool isRunning) {
-    if (currentTime - lastTimeUpdate >= 1.0) {
-        lastTimeUpdate = currentTime;
-        seconds++;
-        if (seconds >= 60) { seconds = 0; minutes++; }
-        if (minutes >= 60) { minutes = 0; hours++; }
-        if (hours >= 24) hours = 0;
+void Watch::update(double deltaTime, double currentTime, bool isRunning, float speed) {
+    PROFILE_SCOPE("Watch::update");
+
+    // A recorded workout replaces the made-up heart rate, battery and pace
+    running = isRunning;
+    pace = speed > 0.1f ? (int)(1000.0f / speed + 0.5f) : 0;
+    SensorSample sample;
+    recorded = sensorLog && sensorLog->sampleAt((int64_t)(currentTime * 1000.0), sample);
+    if (recorded) {
+        heartRate = sample.heartRate;
+        batteryPercent = sample.battery;
+        pace = sample.pace;
     }
 
-    if (currentTime - lastHeartUpdate >= (isRunning ? 0.05 : 0.1)) {
-        lastHeartUpdate = currentTime;
-        if (isRunning) {
-            if (heartRate < 220) heartRate++;
-        } else {
-            if (heartRate > 70) heartRate--;
-            else if (heartRate < 60) heartRate++;
-            else heartRate += (rand() % 3 - 1);
-        }
-    }
+    // The heart rate moves twice as often while running
+    timers.setPeriod(heartTimer, isRunning ? 50 : 100);
+    timers.advance((int64_t)(currentTime * 1000.0));
 
-    float ecgSpeed = 0.3f * (heartRate / 70.0f);
-    ecgScrollOffset += ecgSpeed * (float)deltaTime;
-    if (ecgScrollOffset > 100.0f) ecgScrollOffset -= 100.0f;
+    ecg.advance(deltaTime, heartRate);
+}
 
-    if (currentTime - lastBatteryUpdate >= 10.0) {
-        lastBatteryUpdate = currentTime;
-        if (batteryPercent > 0) batteryPercent--;
+void Watch::clockTick(void* data, int64_t deadline) {
+    // One call per second that passed, however late the frame
+    Watch* watch = (Watch*)data;
+    watch->seconds++;
+    if (watch->seconds >= 60) { watch->seconds = 0; watch->minutes++; }
+    if (watch->minutes >= 60) { watch->minutes = 0; watch->hours++; }
+    if (watch->hours >= 24) watch->hours = 0;
+
+    watch->heartRateHistory.append(deadline, watch->heartRate);
+    watch->batteryHistory.append(deadline, watch->batteryPercent);
+    watch->paceHistory.append(deadline, watch->pace);
+}
+
+void Watch::heartTick(void* data, int64_t) {
+    Watch* watch = (Watch*)data;
+    if (watch->recorded) return;
+    if (watch->running) {
+        if (watch->heartRate < 220) watch->heartRate++;
+    } else {
+        if (watch->heartRate > 70) watch->heartRate--;
+        else if (watch->heartRate < 60) watch->heartRate++;
+        else watch->heartRate += (watch->nextRandom(3) - 1);
     }
 }
 
-void Watch::render(const ShaderUniforms& uniforms, const glm::mat4& handMatrix, unsigned int shader) const {
-    glm::mat4 watchM = handMatrix;
-    watchM = glm::translate(watchM, watchOffset);
-    watchM = glm::rotate(watchM, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    watchM = glm::rotate(watchM, glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-    watchM = glm::scale(watchM, glm::vec3(0.35f));
+void Watch::batteryTick(void* data, int64_t) {
+    Watch* watch = (Watch*)data;
+    if (!watch->recorded && watch->batteryPercent > 0) watch->batteryPercent--;
+}
+
+int Watch::nextRandom(int range) {
+    // xorshift32, identical on every platform unlike rand()
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return (int)(rngState % (uint32_t)range);
+}
+
+WatchDisplay Watch::getDisplay() const {
+    WatchDisplay display;
+    display.screen = currentScreen;
+    display.hours = hours;
+    display.minutes = minutes;
+    display.seconds = seconds;
+    display.heartRate = heartRate;
+    display.batteryPercent = batteryPercent;
+    display.ecgEnd = ecg.getWritten();
+    return display;
+}
+
+void Watch::render(const ShaderUniforms& uniforms, const std::vector<glm::mat4>& transforms, unsigned int shader, const WatchDisplay& display) const {
+    PROFILE_SCOPE("Watch::render");
+    if (lightNode < 0 || lightNode >= (int)transforms.size()) return;
 
     glUniform1i(glGetUniformLocation(shader, "uUseWatchLight"), 0);
-    uniforms.setModelMatrix(watchM);
+    RenderStats::get().countUniforms();
+    uniforms.setModelMatrix(transforms[watchNode]);
     uniforms.setMaterial(
         glm::vec3(0.02f),  // kD - dark
         glm::vec3(0.01f),  // kA
@@ -98,15 +177,16 @@ void Watch::render(const ShaderUniforms& uniforms, const glm::mat4& handMatrix,
     watchBody.draw();
 
     glUniform1i(glGetUniformLocation(shader, "uUseWatchLight"), 1);
+    RenderStats::get().countUniforms();
 
-    glm::mat4 screenM = watchM;
-    screenM = glm::translate(screenM, glm::vec3(0.0f, 0.0f, 0.021f));
+    // Other passes bind their own textures between frames
+    boundTexture = 0;
 
-    renderContent(shader, screenM, 0.0);
+    renderContent(shader, transforms, display);
 }
 
-void Watch::renderContent(unsigned int shader, const glm::mat4& screenMatrix, double currentTime) const {
-    float s = contentScale;
+void Watch::renderContent(unsigned int shader, const std::vector<glm::mat4>& transforms, const WatchDisplay& display) const {
+    const glm::mat4& screenMatrix = transforms[screenNode];
 
     // Draw white circular background
     glm::mat4 bgModel = screenMatrix;
@@ -119,6 +199,7 @@ void Watch::renderContent(unsigned int shader, const glm::mat4& screenMatrix, do
     glUniform3fv(glGetUniformLocation(shader, "uMaterial.kA"), 1, glm::value_ptr(glm::vec3(0.8f)));
     glUniform3fv(glGetUniformLocation(shader, "uMaterial.kS"), 1, glm::value_ptr(glm::vec3(0.1f)));
     glUniform1f(glGetUniformLocation(shader, "uMaterial.shine"), 4.0f);
+    RenderStats::get().countUniforms(6);
 
     // Draw circular background
     static unsigned int bgVAO = 0;
@@ -145,59 +226,60 @@ void Watch::renderContent(unsigned int shader, const glm::mat4& screenMatrix, do
     }
     glBindVertexArray(bgVAO);
     glDrawArrays(GL_TRIANGLES, 0, bgVertexCount);
+    RenderStats::get().countDraw(bgVertexCount / 3);
     glBindVertexArray(0);
 
-    if (currentScreen != WATCH_SCREEN_CLOCK) {
-        renderQuad(shader, arrowTexture, -0.14f * s, 0.0f, 0.04f * s, 0.04f * s, screenMatrix, true);
+    if (display.screen != WATCH_SCREEN_CLOCK) {
+        renderIcon(shader, arrowIcon, transforms[prevArrowNode]);
     }
-    if (currentScreen != WATCH_SCREEN_BATTERY) {
-        renderQuad(shader, arrowTexture, 0.14f * s, 0.0f, 0.04f * s, 0.04f * s, screenMatrix, false);
+    if (display.screen != WATCH_SCREEN_BATTERY) {
+        renderIcon(shader, arrowIcon, transforms[nextArrowNode]);
     }
 
-    switch (currentScreen) {
+    switch (display.screen) {
         case WATCH_SCREEN_CLOCK:
-            renderClockScreen(shader, screenMatrix);
+            renderClockScreen(shader, screenMatrix, display);
             break;
         case WATCH_SCREEN_HEART_RATE:
-            renderHeartRateScreen(shader, screenMatrix, currentTime);
+            renderHeartRateScreen(shader, screenMatrix, display);
             break;
         case WATCH_SCREEN_BATTERY:
-            renderBatteryScreen(shader, screenMatrix);
+            renderBatteryScreen(shader, screenMatrix, display);
             break;
     }
 }
 
-void Watch::renderClockScreen(unsigned int shader, const glm::mat4& parentModel) const {
+void Watch::renderClockScreen(unsigned int shader, const glm::mat4& parentModel, const WatchDisplay& display) const {
     float s = contentScale;
     float scale = 0.045f * s;
     float totalWidth = (6 * 0.6f + 2 * 0.3f) * scale;
-    digitRenderer->drawTime(hours, minutes, seconds, -totalWidth/2.0f, -0.02f * s, scale, glm::vec3(0.1f), shader, parentModel);
+    digitRenderer->drawTime(display.hours, display.minutes, display.seconds, -totalWidth/2.0f, -0.02f * s, scale, glm::vec3(0.1f), shader, parentModel);
 }
 
-void Watch::renderHeartRateScreen(unsigned int shader, const glm::mat4& parentModel, double currentTime) const {
+void Watch::renderHeartRateScreen(unsigned int shader, const glm::mat4& parentModel, const WatchDisplay& display) const {
     float s = contentScale;
 
-    renderECG(shader, 0.0f, -0.05f * s, 0.22f * s, 0.08f * s, parentModel);
+    renderECG(shader, 0.0f, -0.05f * s, 0.22f * s, 0.08f * s, parentModel, display);
 
     float scale = 0.035f * s;
-    digitRenderer->drawNumber(heartRate, -0.06f * s, 0.08f * s, scale, glm::vec3(0.8f, 0.0f, 0.0f), shader, parentModel);
+    digitRenderer->drawNumber(display.heartRate, -0.06f * s, 0.08f * s, scale, glm::vec3(0.8f, 0.0f, 0.0f), shader, parentModel);
 
-    if (heartRate > 200) {
-        renderQuad(shader, warningTexture, 0.0f, 0.0f, 0.3f * s, 0.3f * s, parentModel);
+    if (display.heartRate > 200) {
+        renderQuad(shader, warningIcon, 0.0f, 0.0f, 0.3f * s, 0.3f * s, parentModel);
     }
 }
 
-void Watch::renderBatteryScreen(unsigned int shader, const glm::mat4& parentModel) const {
+void Watch::renderBatteryScreen(unsigned int shader, const glm::mat4& parentModel, const WatchDisplay& display) const {
     float s = contentScale;
 
     // Battery icon
-    renderQuad(shader, batteryTexture, 0.0f, 0.0f, 0.16f * s, 0.09f * s, parentModel);
+    renderQuad(shader, batteryIcon, 0.0f, 0.0f, 0.16f * s, 0.09f * s, parentModel);
 
     // Battery bar
-    float barWidth = 0.13f * s * (batteryPercent / 100.0f);
+    float barWidth = 0.13f * s * (display.batteryPercent / 100.0f);
     glm::vec3 barColor(0.0f, 0.8f, 0.0f);
-    if (batteryPercent < 20) barColor = glm::vec3(0.9f, 0.8f, 0.0f);
-    if (batteryPercent < 10) barColor = glm::vec3(0.9f, 0.0f, 0.0f);
+    if (display.batteryPercent < 20) barColor = glm::vec3(0.9f, 0.8f, 0.0f);
+    if (display.batteryPercent < 10) barColor = glm::vec3(0.9f, 0.0f, 0.0f);
 
     glm::mat4 model = parentModel;
     model = glm::translate(model, glm::vec3(-0.065f * s + barWidth/2.0f, 0.0f, 0.02f));
@@ -207,6 +289,7 @@ void Watch::renderBatteryScreen(unsigned int shader, const glm::mat4& parentMode
     glUniform1i(glGetUniformLocation(shader, "uUseTexture"), 0);
     glUniform3fv(glGetUniformLocation(shader, "uMaterial.kD"), 1, glm::value_ptr(barColor));
     glUniform3fv(glGetUniformLocation(shader, "uMaterial.kA"), 1, glm::value_ptr(barColor));
+    RenderStats::get().countUniforms(4);
 
     static unsigned int rectVAO = 0;
     if (rectVAO == 0) {
@@ -229,104 +312,112 @@ void Watch::renderBatteryScreen(unsigned int shader, const glm::mat4& parentMode
     }
     glBindVertexArray(rectVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
+    RenderStats::get().countDraw(2);
     glBindVertexArray(0);
 
     // Percentage text
     float scale = 0.035f * s;
-    digitRenderer->drawNumber(batteryPercent, -0.025f * s, 0.07f * s, scale, glm::vec3(0.1f), shader, parentModel);
+    digitRenderer->drawNumber(display.batteryPercent, -0.025f * s, 0.07f * s, scale, glm::vec3(0.1f), shader, parentModel);
     digitRenderer->drawPercent(0.04f * s, 0.07f * s, scale, glm::vec3(0.1f), shader, parentModel);
 }
 
-void Watch::renderQuad(unsigned int shader, unsigned int texture, float x, float y, float w, float h, const glm::mat4& parentModel, bool flipX) const {
+void Watch::buildIconQuads() {
+    // One quad per atlas region so icons are addressed by draw range
+    std::vector<float> vertices;
+    for (int i = 0; i < uiAtlas->getRegionCount(); i++) {
+        const TextureAtlas::Region& r = uiAtlas->getRegion(i);
+        float quad[] = {
+            -0.5f, -0.5f, 0.0f, r.uvMin.x, r.uvMin.y,
+             0.5f, -0.5f, 0.0f, r.uvMax.x, r.uvMin.y,
+             0.5f,  0.5f, 0.0f, r.uvMax.x, r.uvMax.y,
+            -0.5f, -0.5f, 0.0f, r.uvMin.x, r.uvMin.y,
+             0.5f,  0.5f, 0.0f, r.uvMax.x, r.uvMax.y,
+            -0.5f,  0.5f, 0.0f, r.uvMin.x, r.uvMax.y
+        };
+        vertices.insert(vertices.end(), quad, quad + 30);
+    }
+    if (vertices.empty()) return;
+
+    glGenVertexArrays(1, &iconVAO);
+    glGenBuffers(1, &iconVBO);
+    glBindVertexArray(iconVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, iconVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+}
+
+void Watch::bindTexture(unsigned int shader, unsigned int texture) const {
+    if (texture == boundTexture) return;
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glUniform1i(glGetUniformLocation(shader, "uTexture"), 0);
+    RenderStats::get().countUniforms();
+    boundTexture = texture;
+}
+
+void Watch::renderQuad(unsigned int shader, int icon, float x, float y, float w, float h, const glm::mat4& parentModel) const {
     glm::mat4 model = parentModel;
     model = glm::translate(model, glm::vec3(x, y, 0.01f));
     model = glm::scale(model, glm::vec3(w, h, 1.0f));
-    if (flipX) model = glm::scale(model, glm::vec3(-1.0f, 1.0f, 1.0f));
+    renderIcon(shader, icon, model);
+}
+
+void Watch::renderIcon(unsigned int shader, int icon, const glm::mat4& model) const {
+    if (icon < 0 || iconVAO == 0) return;
 
     glUniformMatrix4fv(glGetUniformLocation(shader, "uM"), 1, GL_FALSE, glm::value_ptr(model));
     glUniform1i(glGetUniformLocation(shader, "uUseTexture"), 1);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glUniform1i(glGetUniformLocation(shader, "uTexture"), 0);
+    bindTexture(shader, uiAtlas->getTexture());
     glUniform3fv(glGetUniformLocation(shader, "uMaterial.kD"), 1, glm::value_ptr(glm::vec3(0.3f)));
     glUniform3fv(glGetUniformLocation(shader, "uMaterial.kA"), 1, glm::value_ptr(glm::vec3(0.4f)));
+    RenderStats::get().countUniforms(4);
 
-    static unsigned int quadVAO = 0;
-    if (quadVAO == 0) {
-        float vertices[] = {
-            -0.5f, -0.5f, 0.0f, 0.0f, 0.0f,
-             0.5f, -0.5f, 0.0f, 1.0f, 0.0f,
-             0.5f,  0.5f, 0.0f, 1.0f, 1.0f,
-            -0.5f, -0.5f, 0.0f, 0.0f, 0.0f,
-             0.5f,  0.5f, 0.0f, 1.0f, 1.0f,
-            -0.5f,  0.5f, 0.0f, 0.0f, 1.0f
-        };
-        unsigned int quadVBO;
-        glGenVertexArrays(1, &quadVAO);
-        glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-    }
-
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glBindVertexArray(iconVAO);
+    glDrawArrays(GL_TRIANGLES, icon * 6, 6);
+    RenderStats::get().countDraw(2);
     glBindVertexArray(0);
 }
 
-void Watch::renderECG(unsigned int shader, float x, float y, float w, float h, const glm::mat4& parentModel) const {
-    float texScale = 2.0f + ((heartRate - 60.0f) / 150.0f) * 2.0f;
-    texScale = std::max(1.5f, std::min(4.0f, texScale));
-    float heightScale = 1.0f + ((heartRate - 70.0f) / 150.0f) * 0.5f;
-    heightScale = std::max(1.0f, std::min(1.5f, heightScale));
+void Watch::renderECG(unsigned int shader, float x, float y, float w, float h, const glm::mat4& parentModel, const WatchDisplay& display) const {
+    int window = (int)(ECG_WINDOW_SECONDS * ecg.getSampleRate());
+    ecgWindow.resize(window);
+    int count = ecg.copyWindow(display.ecgEnd, window, ecgWindow.data());
+    if (count < 2 || ecgVAO == 0) return;
 
     glm::mat4 model = parentModel;
     model = glm::translate(model, glm::vec3(x, y, 0.01f));
-    model = glm::scale(model, glm::vec3(w, h * heightScale, 1.0f));
+    model = glm::scale(model, glm::vec3(w, h, 1.0f));
 
     glUniformMatrix4fv(glGetUniformLocation(shader, "uM"), 1, GL_FALSE, glm::value_ptr(model));
-    glUniform1i(glGetUniformLocation(shader, "uUseTexture"), 1);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, ecgTexture);
-    glUniform1i(glGetUniformLocation(shader, "uTexture"), 0);
+    glUniform1i(glGetUniformLocation(shader, "uUseTexture"), 0);
     glUniform3fv(glGetUniformLocation(shader, "uMaterial.kD"), 1, glm::value_ptr(glm::vec3(0.0f, 0.8f, 0.0f)));
     glUniform3fv(glGetUniformLocation(shader, "uMaterial.kA"), 1, glm::value_ptr(glm::vec3(0.0f, 0.5f, 0.0f)));
+    RenderStats::get().countUniforms(4);
 
-    float u0 = ecgScrollOffset;
-    float u1 = ecgScrollOffset + texScale;
-
-    float vertices[] = {
-        -0.5f, -0.5f, 0.0f, u0, 0.0f,
-         0.5f, -0.5f, 0.0f, u1, 0.0f,
-         0.5f,  0.5f, 0.0f, u1, 1.0f,
-        -0.5f, -0.5f, 0.0f, u0, 0.0f,
-         0.5f,  0.5f, 0.0f, u1, 1.0f,
-        -0.5f,  0.5f, 0.0f, u0, 1.0f
-    };
-
-    static unsigned int ecgVAO = 0, ecgVBO = 0;
-    if (ecgVAO == 0) {
-        glGenVertexArrays(1, &ecgVAO);
-        glGenBuffers(1, &ecgVBO);
-        glBindVertexArray(ecgVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, ecgVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_DYNAMIC_DRAW);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-    } else {
-        glBindVertexArray(ecgVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, ecgVBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-    }
-
+    // Orphan last frame's strip and write the new one straight into the mapping;
+    // the newest sample sits at the right edge whether or not the window is full
     glBindVertexArray(ecgVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glBindBuffer(GL_ARRAY_BUFFER, ecgVBO);
+    GLsizeiptr bytes = (GLsizeiptr)count * 3 * sizeof(float);
+    glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    float* vertices = (float*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (vertices) {
+        float dx = 1.0f / (float)(window - 1);
+        float x0 = 0.5f - (float)(count - 1) * dx;
+        float yScale = 1.0f / (ECG_MAX_MV - ECG_MIN_MV);
+        for (int i = 0; i < count; i++) {
+            vertices[i * 3 + 0] = x0 + (float)i * dx;
+            vertices[i * 3 + 1] = (ecgWindow[i] - ECG_MIN_MV) * yScale - 0.5f;
+            vertices[i * 3 + 2] = 0.0f;
+        }
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glDrawArrays(GL_LINE_STRIP, 0, count);
+        RenderStats::get().countDraw(0);
+    }
     glBindVertexArray(0);
 }
 
@@ -340,12 +431,41 @@ void Watch::prevScreen() {
     else if (currentScreen == WATCH_SCREEN_BATTERY) currentScreen = WATCH_SCREEN_HEART_RATE;
 }
 
-glm::vec3 Watch::getScreenPosition(const glm::mat4& handMatrix) const {
-    glm::mat4 watchM = handMatrix;
-    watchM = glm::translate(watchM, watchOffset);
-    return glm::vec3(watchM * glm::vec4(0.0f, 0.1f, -0.02f, 1.0f));
+void Watch::attachTransforms(TransformHierarchy& transforms, int handNode) {
+    glm::mat4 watchLocal = glm::translate(glm::mat4(1.0f), watchOffset);
+    watchLocal = glm::rotate(watchLocal, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    watchLocal = glm::rotate(watchLocal, glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    watchLocal = glm::scale(watchLocal, glm::vec3(0.35f));
+    watchNode = transforms.addNode(handNode, watchLocal);
+    screenNode = transforms.addNode(watchNode, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.021f)));
+
+    // Arrow icon quads, the previous one mirrored
+    float s = contentScale;
+    glm::mat4 prevArrow = glm::translate(glm::mat4(1.0f), glm::vec3(-ARROW_OFFSET * s, 0.0f, 0.01f));
+    prevArrowNode = transforms.addNode(screenNode, glm::scale(prevArrow, glm::vec3(-0.04f * s, 0.04f * s, 1.0f)));
+    glm::mat4 nextArrow = glm::translate(glm::mat4(1.0f), glm::vec3(ARROW_OFFSET * s, 0.0f, 0.01f));
+    nextArrowNode = transforms.addNode(screenNode, glm::scale(nextArrow, glm::vec3(0.04f * s, 0.04f * s, 1.0f)));
+
+    // The watch light sits just above the face, unrotated
+    lightNode = transforms.addNode(handNode, glm::translate(glm::mat4(1.0f), watchOffset + glm::vec3(0.0f, 0.1f, -0.02f)));
+}
+
+glm::vec3 Watch::getLightPosition(const std::vector<glm::mat4>& transforms) const {
+    if (lightNode < 0 || lightNode >= (int)transforms.size()) return glm::vec3(0.0f);
+    return glm::vec3(transforms[lightNode][3]);
 }
 
-void Watch::updateArrowPositions(const glm::mat4& view, const glm::mat4& proj, int screenWidth, int screenHeight) {
-    // deprecated
+WatchWidget Watch::widgetAt(const glm::vec2& uv) const {
+    // The disc maps uv (0.5, 0.5) to its center, in the units content is drawn in
+    glm::vec2 local = (uv - glm::vec2(0.5f)) * SCREEN_SIZE;
+    float s = contentScale;
+    if (currentScreen != WATCH_SCREEN_CLOCK &&
+        glm::length(local - glm::vec2(-ARROW_OFFSET * s, 0.0f)) < ARROW_HIT_RADIUS * s) {
+        return WATCH_WIDGET_PREV_ARROW;
+    }
+    if (currentScreen != WATCH_SCREEN_BATTERY &&
+        glm::length(local - glm::vec2(ARROW_OFFSET * s, 0.0f)) < ARROW_HIT_RADIUS * s) {
+        return WATCH_WIDGET_NEXT_ARROW;
+    }
+    return WATCH_WIDGET_NONE;
 }